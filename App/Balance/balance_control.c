@@ -2,7 +2,15 @@
 #include "Balance/balance_control.h"
 #include "gpio.h"
 #include "tim.h"
-#include <math.h>
+#include "Sensor/inv_mpu_dmp_motion_driver.h"
+#include "Math/fast_math.h"
+#include "System/profiler.h"
+#include "System/flash_store.h"
+#include "Balance/motor_calib.h"
+#include "Sensor/battery.h"
+#include "Comm/telemetry.h"
+#include "System/param.h"
+#include "System/timebase.h"
 
 PID_HandleTypeDef balance_pid;
 float current_pitch = 0.0f;
@@ -14,55 +22,194 @@ float target_yaw = 0.0f;
 int16_t encoder_speed_left = 0;
 int16_t encoder_speed_right = 0;
 
-// 新增：电机最小启动PWM阈值（根据实际电机特性调整，通常15-30）
+// 新增：电机最小启动PWM阈值（根据实际电机特性调整，通常15-30），运行中可用参数motor.min_start修改
 #define MIN_START_PWM 30.0f
+float min_start_pwm = MIN_START_PWM;
 
-// MPU6050中断服务函数（PB14触发）
+// 启动时等待姿态稳定：连续100ms的样本俯仰角波动小于SETTLE_SPAN_DEG
+#define SETTLE_WINDOW_MS    100
+#define SETTLE_SPAN_DEG     1.0f
+#define SETTLE_TIMEOUT_MS   1000    // 原先固定等待的时间，作为上限
+
+// IMU标定：平均的样本数和等待样本的上限
+#define CALIB_SAMPLES       100
+#define CALIB_TIMEOUT_MS    3000
+
+// 实测采样间隔的有效范围（相对名义周期），超出则按名义周期计算
+#define DT_MIN_RATIO        0.25f
+#define DT_MAX_RATIO        8.0f
+#define STALE_PERIODS       5U      // 超过几个名义周期没有新样本，电机输出清零
+#define RATE_RESTART_TRIES  3       // 切换速率后重开异步读取失败时，重新初始化传感器的次数
+
+static float last_valid_pitch = 0.0f;   // 5度突变检测的参考值
+static volatile float dmp_pitch;        // 未经突变检测的最新俯仰角
+static volatile uint32_t dmp_samples;   // 收到的含四元数的包数
+static Balance_BootInfoTypeDef boot_info;
+static MPU6050_ModeTypeDef sensor_mode = BALANCE_SENSOR_MODE;
+static uint16_t sensor_rate = BALANCE_SENSOR_HZ;
+static MPU6050_DMP_ProfileTypeDef dmp_profile = BALANCE_DMP_PROFILE;
+static volatile uint64_t sample_us;     // 最新有效样本的INT边沿时刻
+static uint64_t last_sample_us;         // 上一次控制所用样本的时刻，0=无
+static uint64_t last_output_us;         // 最近一次按样本写电机输出的时刻，0=输出已清零
+static uint32_t dt_min_us, dt_nominal_us, dt_max_us;
+static Balance_CalibTypeDef calib;
+static volatile int8_t calib_request = -1;  // 主循环待执行的标定方式，-1=无
+static int calib_result = 1;                // 最近一次标定结果，1=未标定/进行中
+static volatile uint32_t rate_request;      // 主循环待执行的速率切换：(rate_hz << 16) | lpf_hz，0=无
+static int rate_result;                     // 最近一次速率切换结果，1=进行中
+static int (*volatile flash_request)(void); // 主循环待执行的flash写入，NULL=无
+static int flash_result;                    // 最近一次flash写入结果，1=进行中
+
+// MPU6050中断服务函数（PB14触发）：只启动DMA读取，不在中断里阻塞
+// 编码器A相上升沿（PA0/PB6）：只记录M/T测速的时间戳
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
   if (GPIO_Pin == GPIO_PIN_14) {
+    PROF_BEGIN(PROF_STAGE_LATENCY);
+    PROF_BEGIN(PROF_STAGE_EXTI);
     HAL_GPIO_TogglePin(GPIOC, GPIO_PIN_13);
-    float roll, yaw;
-    // 连续2次读取一致才认为有效（抗突发噪声）
-    static float last_valid_pitch = 0.0f;
-    if (MPU6050_DMP_Get_Date(&current_pitch, &roll, &yaw) == 0) {
-      // 角度突变检测（超过5度认为异常，用上次有效值）
-      if (fabs(current_pitch - last_valid_pitch) < 5.0f) {
-        last_valid_pitch = current_pitch;
-        data_ready = 1;
-      }
-    }
+    MPU6050_DMP_Start_Read();
     __HAL_GPIO_EXTI_CLEAR_IT(GPIO_PIN_14);
+    PROF_END(PROF_STAGE_EXTI);
+  } else if (GPIO_Pin == ENCODER_LEFT_EDGE_PIN) {
+    Encoder_Edge_IRQHandler(ENCODER_LEFT);
+  } else if (GPIO_Pin == ENCODER_RIGHT_EDGE_PIN) {
+    Encoder_Edge_IRQHandler(ENCODER_RIGHT);
+  }
+}
+
+// DMP数据包DMA读取并解析完成（DMA中断中调用）
+void MPU6050_DMP_DataReadyCallback(const MPU6050_DataTypeDef *data) {
+  if (!(data->sensors & (INV_WXYZ_QUAT | MPU6050_SENSOR_ATTITUDE))) {
+    return;
+  }
+  dmp_pitch = data->pitch;
+  dmp_samples++;
+  current_pitch = data->pitch;
+  // 角度突变检测（超过5度认为异常，用上次有效值）
+  if (fast_fabsf(current_pitch - last_valid_pitch) < 5.0f) {
+    last_valid_pitch = current_pitch;
+    sample_us = data->timestamp;
+    data_ready = 1;
   }
 }
 
 // 新增：电机PWM启动阈值处理函数
 float Motor_Start_Threshold(float pwm) {
   // 当PWM绝对值大于0但小于启动阈值时，提升到阈值
-  if (fabs(pwm) > 0 && fabs(pwm) < MIN_START_PWM) {
-    return (pwm > 0) ? MIN_START_PWM : -MIN_START_PWM;
+  if (fast_fabsf(pwm) > 0 && fast_fabsf(pwm) < min_start_pwm) {
+    return (pwm > 0) ? min_start_pwm : -min_start_pwm;
   }
   return pwm; // 其他情况保持原PWM值
 }
 
+// 编码器速度（计数/秒）限幅到int16
+static inline int16_t speed_to_i16(int32_t v) {
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return (int16_t)v;
+}
+
+// 浮点值按比例换算为int16遥测字段（限幅）
+static inline int16_t scale_to_i16(float v, float scale) {
+    return speed_to_i16((int32_t)(v * scale));
+}
+
+// Q16系数 × Q16值（Q32）换算为0.01单位的int16
+static inline int16_t q32_to_centi(int64_t v) {
+    return speed_to_i16((int32_t)((v * 100) >> 32));
+}
+
+// 打包一条遥测记录交给DMA（只在Telemetry_Due时调用，浮点换算不进每个控制周期）
+// PID三项按当前引擎的状态重算，单位为输出百分比
+static void telemetry_send(uint64_t t, float pitch, int32_t duty_a, int32_t duty_b,
+                           Battery_StateTypeDef battery) {
+    const PID_HandleTypeDef *pid = &balance_pid;
+    Telemetry_ControlTypeDef rec;
+
+    rec.t_us = (uint32_t)t;
+    rec.pitch = scale_to_i16(pitch, 100.0f);
+    if (pid->engine == PID_ENGINE_FIXED) {
+        const PID_FixedTypeDef *fx = &pid->fx;
+        int32_t error = fx->target - fx->last_current;
+        if (error < fx->deadband && error > -fx->deadband) {
+            error = 0;
+        }
+        // 微分项作用在测量值上，diff_filtered = -角速度
+        rec.rate = speed_to_i16((int32_t)(((int64_t)-fx->diff_filtered * 10) >> 16));
+        rec.p = q32_to_centi((int64_t)fx->kp * error);
+        rec.i = q32_to_centi((int64_t)fx->ki * fx->integral);
+        rec.d = q32_to_centi((int64_t)fx->kd * fx->diff_filtered);
+    } else {
+        rec.rate = scale_to_i16(-pid->diff_filtered, 10.0f);
+        rec.p = scale_to_i16(pid->kp * pid->error, 100.0f);
+        rec.i = scale_to_i16(pid->ki * pid->integral, 100.0f);
+        rec.d = scale_to_i16(pid->kd * pid->diff_filtered, 100.0f);
+    }
+    rec.duty_a = (int16_t)duty_a;
+    rec.duty_b = (int16_t)duty_b;
+    rec.enc_left = Encoder_Get_History(ENCODER_LEFT, 0);
+    rec.enc_right = Encoder_Get_History(ENCODER_RIGHT, 0);
+    rec.vbat_mv = Battery_Get_Voltage();
+    rec.flags = (uint8_t)(battery & TELEMETRY_FLAG_BATTERY);
+    if (pid->engine == PID_ENGINE_FIXED) {
+        rec.flags |= TELEMETRY_FLAG_FIXED;
+    }
+    if (TB6612_Has_Friction()) {
+        rec.flags |= TELEMETRY_FLAG_FRICTION;
+    }
+    Telemetry_Send(&rec);
+}
+
+// 按当前姿态样本速率更新控制环的所有时间常数：名义Ts（浮点和定点）、实测dt的有效范围
+// 每次控制按实测样本间隔更新Ts，名义周期只作兜底；dt从下一个样本重新开始计
+static void control_timing_update(void) {
+    dt_nominal_us = 1000000U / MPU6050_Get_Rate();
+    dt_min_us = (uint32_t)(dt_nominal_us * DT_MIN_RATIO);
+    dt_max_us = (uint32_t)(dt_nominal_us * DT_MAX_RATIO);
+    PID_Set_Dt(&balance_pid, dt_nominal_us);
+    PID_Set_Dt(&speed_pid, dt_nominal_us);
+    Encoder_Set_Tick_Rate(MPU6050_Get_Rate());
+    last_sample_us = 0;
+}
+
 // PID参数初始化
 void PID_Init(void) {
     // 平衡PID参数（需根据实际调试调整）
     balance_pid.kp = 8.0f;    // 比例系数
     balance_pid.ki = 0.03f;    // 积分系数
-    balance_pid.kd = 0.3f;    // 微分系数
+    balance_pid.kd = 1.0f;    // 微分系数
     balance_pid.target = 10.0f; // 目标角度（平衡位置，需校准）
     balance_pid.error = 0.0f;
     balance_pid.last_err = 0.0f;
     balance_pid.integral = 0.0f;
-    balance_pid.max_out = 80.0f;  // 最大输出（小于PWM_MAX=100）
+    balance_pid.max_out = 80.0f;  // 最大输出（百分比，小于100%）
     balance_pid.min_out = -80.0f; // 最小输出
     // 新增参数初始化
-    balance_pid.Ts = 0.01f;   // 采样周期（假设MPU中断10ms一次）
     balance_pid.alpha = 0.7f; // 微分滤波系数
     balance_pid.deadband = 0.5f; // 死区0.3度（根据传感器精度调整）
     balance_pid.last_current = 0.0f;
     balance_pid.diff_filtered = 0.0f;
-
+    // 速度环参数：输入为两轮平均速度（计数/秒），输出百分比从平衡环输出中减去
+    // 只用比例项：车轮向前跑时把平衡环输出压小，车身随之后仰把速度拉回，消除单角度环的漂移
+    // 参数经SIL在各种噪声、延迟、标定组合下验证（见Sim/CMakeLists.txt）
+    speed_pid.kp = 0.03f;     // 每1000计数/秒 对应 3%输出
+    speed_pid.ki = 0.0f;
+    speed_pid.kd = 0.0f;
+    speed_pid.target = 0.0f;  // 目标速度（计数/秒）
+    speed_pid.error = 0.0f;
+    speed_pid.last_err = 0.0f;
+    speed_pid.integral = 0.0f;
+    speed_pid.max_out = 50.0f;  // 限幅：不超过平衡环输出范围，避免速度环压过平衡环
+    speed_pid.min_out = -50.0f;
+    speed_pid.alpha = 0.0f;
+    speed_pid.deadband = 0.0f;
+    speed_pid.last_current = 0.0f;
+    speed_pid.diff_filtered = 0.0f;
+    // 采样周期（每个姿态样本控制一次）
+    control_timing_update();
+    // 选择计算引擎（同时换算定点参数）
+    PID_SetEngine(&balance_pid, BALANCE_PID_ENGINE);
+    PID_SetEngine(&speed_pid, BALANCE_PID_ENGINE);
 }
 
 // MPU6050中断初始化（PB14）
@@ -73,35 +220,347 @@ void MPU6050_Interrupt_Init(void) {
     HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 0);
 }
 
+// 等待DMP姿态输出稳定（代替固定延时），稳定后的角度作为突变检测的初始参考
+// 已加载标定时零偏无需收敛，两个一致的样本即可
+static void Balance_Wait_Settled(void) {
+    uint32_t start = HAL_GetTick();
+    uint32_t seen = dmp_samples;
+    uint32_t need = (uint32_t)MPU6050_Get_Rate() * SETTLE_WINDOW_MS / 1000U;
+    uint32_t stable = 0;
+    float lo = 0.0f, hi = 0.0f;
+
+    if (boot_info.calibrated || need < 2) need = 2;
+    while (stable < need) {
+        if (HAL_GetTick() - start >= SETTLE_TIMEOUT_MS) {
+            boot_info.settle_timeout = 1;
+            break;
+        }
+        MPU6050_DMP_Process();
+        if (dmp_samples == seen) {
+            continue;
+        }
+        seen = dmp_samples;
+        float p = dmp_pitch;
+        if (stable == 0 || p < lo) lo = p;
+        if (stable == 0 || p > hi) hi = p;
+        stable = (hi - lo < SETTLE_SPAN_DEG) ? stable + 1 : 0;
+    }
+
+    __disable_irq();
+    last_valid_pitch = dmp_pitch;
+    data_ready = 0;
+    last_sample_us = 0;
+    __enable_irq();
+}
+
+// 把标定零偏写入传感器（DMP或互补滤波）
+static int calib_apply(const Balance_CalibTypeDef *cal) {
+    long gyro[3], accel[3];
+
+    if (!(cal->flags & BALANCE_CALIB_GYRO)) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        gyro[i] = cal->gyro_bias[i];
+        accel[i] = cal->accel_bias[i];
+    }
+    return MPU6050_Set_Bias(gyro, (cal->flags & BALANCE_CALIB_ACCEL) ? accel : NULL);
+}
+
+// 平均接下来samples个姿态样本的俯仰角
+static int average_pitch(uint16_t samples, float *pitch) {
+    uint32_t start = HAL_GetTick();
+    uint32_t seen = dmp_samples;
+    float sum = 0.0f;
+    uint16_t n = 0;
+
+    while (n < samples) {
+        if (HAL_GetTick() - start >= CALIB_TIMEOUT_MS) {
+            return -1;
+        }
+        MPU6050_DMP_Process();
+        if (dmp_samples == seen) {
+            continue;
+        }
+        seen = dmp_samples;
+        sum += dmp_pitch;
+        n++;
+    }
+    *pitch = sum / samples;
+    return 0;
+}
+
+/**
+ * @brief  测量IMU零偏（和机械平衡角）并保存到flash，阻塞约2秒，期间电机停转
+ * @param  mode: BALANCE_CALIB_AT_BALANCE 扶在平衡点静止；BALANCE_CALIB_LEVEL 水平静止放置；
+ *               BALANCE_CALIB_FRICTION 车轮离地标定电机摩擦（约10秒）
+ * @retval 0=成功，-1=等待姿态样本超时，-2=读取/写入传感器失败，-3=写flash失败，
+ *         电机标定失败见ERROR_MOTOR_CALIB_*
+ * @note   在主循环中调用（蓝牙指令通过Balance_Request_Calibration转到主循环）
+ */
+int Balance_Calibrate(Balance_CalibModeTypeDef mode) {
+    Balance_CalibTypeDef cal = calib;
+    long gyro[3], accel[3];
+    int ret;
+
+    TB6612_HardStop(TB6612_MOTOR_A);
+    TB6612_HardStop(TB6612_MOTOR_B);
+
+    if (mode == BALANCE_CALIB_FRICTION) {
+        ret = Motor_Calib_Run();
+        // 标定期间的样本不参与控制
+        __disable_irq();
+        data_ready = 0;
+        last_sample_us = 0;
+        __enable_irq();
+        return ret;
+    }
+    if (mode == BALANCE_CALIB_AT_BALANCE) {
+        if (average_pitch(CALIB_SAMPLES, &cal.balance_angle)) {
+            return -1;
+        }
+        cal.flags |= BALANCE_CALIB_ANGLE;
+    }
+
+    if ((ret = MPU6050_DMP_Async_Disable()) != 0) {
+        MPU6050_DMP_Async_Enable();
+        return -2;
+    }
+    ret = MPU6050_Measure_Bias(CALIB_SAMPLES, gyro, (mode == BALANCE_CALIB_LEVEL) ? accel : NULL);
+    if (ret == 0) {
+        for (uint8_t i = 0; i < 3; i++) {
+            cal.gyro_bias[i] = (int32_t)gyro[i];
+            if (mode == BALANCE_CALIB_LEVEL) {
+                cal.accel_bias[i] = (int32_t)accel[i];
+            }
+        }
+        cal.flags |= BALANCE_CALIB_GYRO;
+        if (mode == BALANCE_CALIB_LEVEL) {
+            cal.flags |= BALANCE_CALIB_ACCEL;
+        }
+        ret = calib_apply(&cal);
+    }
+    if (MPU6050_DMP_Async_Enable() != 0 || ret != 0) {
+        return -2;
+    }
+    if (Flash_Store_Write(FLASH_TAG_IMU_CALIB, &cal, sizeof(cal)) != 0) {
+        return -3;
+    }
+    calib = cal;
+
+    if (cal.flags & BALANCE_CALIB_ANGLE) {
+        balance_pid.target = cal.balance_angle;
+        PID_Fixed_Sync(&balance_pid);
+    }
+    // 标定期间的样本不参与控制，重新取突变检测参考和dt起点
+    __disable_irq();
+    last_valid_pitch = dmp_pitch;
+    data_ready = 0;
+    last_sample_us = 0;
+    __enable_irq();
+    return 0;
+}
+
+/**
+ * @brief  请求在主循环中执行标定（可在中断中调用，结果见Balance_Get_Calib）
+ */
+void Balance_Request_Calibration(Balance_CalibModeTypeDef mode) {
+    calib_result = 1;
+    calib_request = (int8_t)mode;
+}
+
+/**
+ * @brief  获取当前标定数据
+ * @param  cal: 输出，可为NULL
+ * @retval 最近一次标定结果：0=成功，1=未标定或进行中，负数见Balance_Calibrate
+ */
+int Balance_Get_Calib(Balance_CalibTypeDef *cal) {
+    if (cal != NULL) {
+        *cal = calib;
+    }
+    return calib_result;
+}
+
+/**
+ * @brief  请求在主循环中停下电机执行一次flash写入（可在中断中调用，结果见Balance_Get_Flash_Write）
+ * @param  write: 写入函数，返回0=成功，其余为错误码
+ * @note   擦写flash时CPU取指停顿几十毫秒，控制跟不上，不能在控制运行中直接写
+ */
+void Balance_Request_Flash_Write(int (*write)(void)) {
+    flash_result = 1;
+    flash_request = write;
+}
+
+/**
+ * @brief  最近一次Balance_Request_Flash_Write的结果：0=成功，1=进行中，其余为写入函数的返回值
+ */
+int Balance_Get_Flash_Write(void) {
+    return flash_result;
+}
+
+/**
+ * @brief  选择姿态来源和控制频率（在Balance_Init之前调用）
+ * @param  mode: MPU6050_MODE_DMP 或 MPU6050_MODE_RAW
+ * @param  rate_hz: 采样率，DMP模式<=200，RAW模式<=1000
+ */
+void Balance_Set_Sensor_Mode(MPU6050_ModeTypeDef mode, uint16_t rate_hz) {
+    sensor_mode = mode;
+    sensor_rate = rate_hz;
+}
+
+// 异步读取开不起来时没有任何样本：等一会儿重新初始化传感器、写回标定零偏再开
+static int sensor_restart(void) {
+    boot_info.async_retries++;
+    HAL_Delay(500);
+    if (MPU6050_Init(sensor_mode, sensor_rate) == 0 && (calib.flags & BALANCE_CALIB_GYRO)) {
+        calib_apply(&calib);
+    }
+    return MPU6050_DMP_Async_Enable();
+}
+
+/**
+ * @brief  运行中切换姿态样本和控制环频率（阻塞约数毫秒，期间电机保持上一次输出）
+ * @param  rate_hz: 采样率，DMP模式<=200（取200Hz的整数分频），RAW模式<=1000
+ * @param  lpf_hz: 数字低通截止频率，0=自动
+ * @retval 0=成功，其余为MPU6050的ERROR_*错误码（失败时恢复原速率）；
+ *         ERROR_DMP_STATE=异步读取重开失败，电机已停，重新初始化传感器RATE_RESTART_TRIES次仍不行
+ * @note   在主循环中调用（蓝牙指令通过Balance_Request_Rate转到主循环）
+ */
+int Balance_Set_Rate(uint16_t rate_hz, uint16_t lpf_hz) {
+    uint16_t old_rate = MPU6050_Get_Rate();
+    int ret;
+
+    if ((ret = MPU6050_DMP_Async_Disable()) != 0) {
+        // 总线已恢复，原速率不变，重新开启异步读取
+        MPU6050_DMP_Async_Enable();
+        return ret;
+    }
+    ret = MPU6050_Set_Rate(rate_hz, lpf_hz);
+    if (ret != 0) {
+        MPU6050_Set_Rate(old_rate, 0);
+    }
+    // 异步读取已关闭，没有样本回调；传感器速率和控制时间常数一起切换
+    __disable_irq();
+    sensor_rate = MPU6050_Get_Rate();
+    control_timing_update();
+    data_ready = 0;
+    __enable_irq();
+    if (MPU6050_DMP_Async_Enable() != 0) {
+        // 没有样本就没有反馈，先停电机，再同Balance_Init一样重新初始化传感器
+        TB6612_SetOutputs(0, 0);
+        last_output_us = 0;
+        int tries = 0;
+        while (sensor_restart() != 0) {
+            if (++tries >= RATE_RESTART_TRIES) {
+                return ERROR_DMP_STATE;
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief  请求在主循环中切换速率（可在中断中调用，结果见Balance_Get_Rate）
+ */
+void Balance_Request_Rate(uint16_t rate_hz, uint16_t lpf_hz) {
+    rate_result = 1;
+    rate_request = ((uint32_t)rate_hz << 16) | lpf_hz;
+}
+
+/**
+ * @brief  获取当前速率
+ * @param  rate_hz: 输出姿态样本/控制频率，可为NULL
+ * @param  lpf_hz: 输出数字低通截止频率，可为NULL
+ * @retval 最近一次切换结果：0=成功，1=进行中，负数见Balance_Set_Rate
+ */
+int Balance_Get_Rate(uint16_t *rate_hz, uint16_t *lpf_hz) {
+    if (rate_hz != NULL) {
+        *rate_hz = MPU6050_Get_Rate();
+    }
+    if (lpf_hz != NULL) {
+        *lpf_hz = MPU6050_Get_Lpf();
+    }
+    return rate_result;
+}
+
+/**
+ * @brief  选择DMP功能配置（在Balance_Init之前调用，调试手势等功能时用FULL）
+ * @param  profile: MPU6050_DMP_PROFILE_*
+ */
+void Balance_Set_Dmp_Profile(MPU6050_DMP_ProfileTypeDef profile) {
+    dmp_profile = profile;
+}
+
 // 系统初始化（传感器+电机）
 void Balance_Init(void) {
     // 初始化电机
     TB6612_Init();
+    Encoder_Init();
+    Motor_Calib_Load();
+    Battery_Init();
 
-    // 初始化MPU6050 DMP
-    while (MPU6050_DMP_init() != 0) {
+    // 初始化MPU6050（DMP或原始数据+互补滤波）
+    MPU6050_DMP_Set_Profile(dmp_profile);
+    while (MPU6050_Init(sensor_mode, sensor_rate) != 0) {
         // 初始化失败可添加指示灯提示
         HAL_Delay(500);
     }
+    boot_info.dmp_ready_ms = HAL_GetTick();
+    boot_info.dmp_init_ms = MPU6050_DMP_Get_Boot_Info()->init_ms;
+    boot_info.dmp_warm = MPU6050_DMP_Get_Boot_Info()->warm;
+
+    // 加载flash中的IMU标定，零偏直接写入传感器，省去上电后的零偏收敛
+    if (Flash_Store_Read(FLASH_TAG_IMU_CALIB, &calib, sizeof(calib)) == (int)sizeof(calib) &&
+        calib_apply(&calib) == 0) {
+        boot_info.calibrated = (calib.flags & BALANCE_CALIB_GYRO) ? 1 : 0;
+        calib_result = 0;
+    } else {
+        calib = (Balance_CalibTypeDef){0};
+    }
 
-    // 初始化中断和PID
+    // 平衡只用俯仰角，roll/yaw不再计算
+    MPU6050_DMP_Set_Euler_Mask(MPU6050_EULER_PITCH);
+    // 开启DMA异步读取，再打开INT中断；失败（DMP未使能或包长度与功能配置不符）时
+    // 没有任何样本，同初始化一样重新初始化传感器再试，次数记入启动信息
+    if (MPU6050_DMP_Async_Enable() != 0) {
+        while (sensor_restart() != 0) {
+        }
+    }
     MPU6050_Interrupt_Init();
     PID_Init();
+    if (calib.flags & BALANCE_CALIB_ANGLE) {
+        balance_pid.target = calib.balance_angle;
+        PID_Fixed_Sync(&balance_pid);
+    }
 
     // 等待传感器稳定
-    HAL_Delay(1000);
+    Balance_Wait_Settled();
+    boot_info.settled_ms = HAL_GetTick();
+}
+
+/**
+ * @brief  获取启动计时
+ */
+const Balance_BootInfoTypeDef *Balance_Get_Boot_Info(void) {
+    return &boot_info;
 }
 
 // PID计算函数
 float PID_Calculate(PID_HandleTypeDef *pid, float current) {
+  if (pid->engine == PID_ENGINE_FIXED) {
+    int32_t out = PID_Calculate_Q16(pid, PID_FLOAT_TO_Q16(current));
+    pid->output = PID_Q16_TO_FLOAT(out);
+    return pid->output;
+  }
+
   // 1. 计算误差（带死区处理，小误差不响应）
   pid->error = pid->target - current;
-  if (fabs(pid->error) < pid->deadband) {
+  if (fast_fabsf(pid->error) < pid->deadband) {
     pid->error = 0.0f;
   }
 
   // 2. 积分项优化（抗积分饱和）
-  if (fabs(pid->error) < 5.0f) {  // 积分分离条件不变
+  if (fast_fabsf(pid->error) < 5.0f) {  // 积分分离条件不变
     // 仅当输出未达到限幅时累加积分（防止饱和）
     if (pid->output < pid->max_out && pid->output > pid->min_out) {
       // 积分 *= 采样时间，使KI参数与采样频率无关
@@ -139,35 +598,285 @@ float PID_Calculate(PID_HandleTypeDef *pid, float current) {
   return pid->output;
 }
 
+/**
+ * @brief  按实测采样间隔更新Ts（每次计算前调用，不做完整的定点参数换算）
+ * @param  pid: PID句柄
+ * @param  dt_us: 采样间隔（微秒），不小于32us（1/Ts的Q16换算）
+ */
+void PID_Set_Dt(PID_HandleTypeDef *pid, uint32_t dt_us) {
+  pid->Ts = dt_us * 1e-6f;
+  // Q16: ts = dt_us * 65536 / 1e6，65536/1e6 ≈ 4295/65536
+  pid->fx.ts = (int32_t)(((uint64_t)dt_us * 4295U) >> 16);
+  // Q16: 1/Ts = 65536e6 / dt_us = (4096e6 / dt_us) << 4，全程32位
+  pid->fx.inv_ts = (int32_t)((4096000000U / dt_us) << 4);
+}
+
+// Q16.16乘法（M3上为一条SMULL）
+static inline int32_t q16_mul(int32_t a, int32_t b) {
+  return (int32_t)(((int64_t)a * b) >> 16);
+}
+
+static inline int32_t q16_clamp(int64_t x, int32_t min, int32_t max) {
+  if (x > max) return max;
+  if (x < min) return min;
+  return (int32_t)x;
+}
+
+// 积分分离阈值（5度，与浮点版本一致）
+#define PID_Q16_INTEGRAL_SEP  (5 * PID_Q16_ONE)
+
+/**
+ * @brief  浮点参数换算为定点参数（修改kp/ki/kd/target等之后调用）
+ * @param  pid: PID句柄
+ */
+void PID_Fixed_Sync(PID_HandleTypeDef *pid) {
+  PID_FixedTypeDef *fx = &pid->fx;
+  fx->kp = PID_FLOAT_TO_Q16(pid->kp);
+  fx->ki = PID_FLOAT_TO_Q16(pid->ki);
+  fx->kd = PID_FLOAT_TO_Q16(pid->kd);
+  fx->target = PID_FLOAT_TO_Q16(pid->target);
+  fx->deadband = PID_FLOAT_TO_Q16(pid->deadband);
+  fx->max_out = PID_FLOAT_TO_Q16(pid->max_out);
+  fx->min_out = PID_FLOAT_TO_Q16(pid->min_out);
+  fx->ts = PID_FLOAT_TO_Q16(pid->Ts);
+  fx->inv_ts = (pid->Ts > 0.0f) ? PID_FLOAT_TO_Q16(1.0f / pid->Ts) : 0;
+  fx->alpha = PID_FLOAT_TO_Q16(pid->alpha);
+  // 积分限幅在这里算好，避免计算时做除法
+  if (pid->ki > 0.0f) {
+    float max_integral = pid->max_out / pid->ki;
+    float min_integral = pid->min_out / pid->ki;
+    fx->max_integral = (max_integral < 32767.0f) ? PID_FLOAT_TO_Q16(max_integral) : INT32_MAX;
+    fx->min_integral = (min_integral > -32767.0f) ? PID_FLOAT_TO_Q16(min_integral) : INT32_MIN;
+  } else {
+    fx->max_integral = INT32_MAX;
+    fx->min_integral = INT32_MIN;
+  }
+}
+
+/**
+ * @brief  切换PID计算引擎，运行状态随之换算，不会产生输出跳变
+ * @param  pid: PID句柄
+ * @param  engine: PID_ENGINE_FLOAT 或 PID_ENGINE_FIXED
+ */
+void PID_SetEngine(PID_HandleTypeDef *pid, PID_EngineTypeDef engine) {
+  PID_FixedTypeDef *fx = &pid->fx;
+  PID_Fixed_Sync(pid);
+  if (engine == PID_ENGINE_FIXED) {
+    fx->integral = PID_FLOAT_TO_Q16(pid->integral);
+    fx->last_current = PID_FLOAT_TO_Q16(pid->last_current);
+    fx->diff_filtered = PID_FLOAT_TO_Q16(pid->diff_filtered);
+    fx->output = PID_FLOAT_TO_Q16(pid->output);
+  } else if (pid->engine == PID_ENGINE_FIXED) {
+    pid->integral = PID_Q16_TO_FLOAT(fx->integral);
+    pid->last_current = PID_Q16_TO_FLOAT(fx->last_current);
+    pid->diff_filtered = PID_Q16_TO_FLOAT(fx->diff_filtered);
+    pid->output = PID_Q16_TO_FLOAT(fx->output);
+  }
+  pid->engine = engine;
+}
+
+/**
+ * @brief  定点PID计算（死区、积分分离、抗饱和、测量值微分滤波与浮点版本相同）
+ * @param  pid: PID句柄（使用pid->fx中的定点参数）
+ * @param  current: 当前测量值（Q16.16）
+ * @retval 输出（Q16.16）
+ */
+int32_t PID_Calculate_Q16(PID_HandleTypeDef *pid, int32_t current) {
+  PID_FixedTypeDef *fx = &pid->fx;
+
+  // 1. 误差与死区
+  int32_t error = fx->target - current;
+  int32_t abs_err = (error < 0) ? -error : error;
+  if (abs_err < fx->deadband) {
+    error = 0;
+    abs_err = 0;
+  }
+
+  // 2. 积分分离 + 抗饱和
+  if (abs_err < PID_Q16_INTEGRAL_SEP) {
+    if (fx->output < fx->max_out && fx->output > fx->min_out) {
+      fx->integral = q16_clamp((int64_t)fx->integral + q16_mul(error, fx->ts),
+                               fx->min_integral, fx->max_integral);
+    }
+  } else {
+    fx->integral = 0;
+  }
+
+  // 3. 测量值微分 + 一阶低通
+  int32_t current_diff = q16_mul(current - fx->last_current, fx->inv_ts);
+  fx->diff_filtered = q16_mul(fx->alpha, fx->diff_filtered) -
+                      q16_mul(PID_Q16_ONE - fx->alpha, current_diff);
+
+  // 4/5. 输出并限幅（64位累加，避免中间溢出）
+  int64_t out = (int64_t)fx->kp * error +
+                (int64_t)fx->ki * fx->integral +
+                (int64_t)fx->kd * fx->diff_filtered;
+  fx->output = q16_clamp(out >> 16, fx->min_out, fx->max_out);
+
+  // 6. 保存历史数据
+  fx->last_current = current;
+  return fx->output;
+}
+
+/**
+ * @brief  读取PID当前的误差、积分和滤波后微分（定点引擎时从定点状态换算，浮点字段不逐周期回写）
+ * @param  pid: PID句柄
+ * @param  error: 输出误差（死区处理后），可为NULL
+ * @param  integral: 输出积分值，可为NULL
+ * @param  diff_filtered: 输出滤波后的微分，可为NULL
+ */
+void PID_Get_State(const PID_HandleTypeDef *pid, float *error, float *integral, float *diff_filtered) {
+  const PID_FixedTypeDef *fx = &pid->fx;
+
+  if (pid->engine != PID_ENGINE_FIXED) {
+    if (error != NULL) *error = pid->error;
+    if (integral != NULL) *integral = pid->integral;
+    if (diff_filtered != NULL) *diff_filtered = pid->diff_filtered;
+    return;
+  }
+  if (error != NULL) {
+    int32_t e = fx->target - fx->last_current;
+    *error = (e < fx->deadband && e > -fx->deadband) ? 0.0f : PID_Q16_TO_FLOAT(e);
+  }
+  if (integral != NULL) *integral = PID_Q16_TO_FLOAT(fx->integral);
+  if (diff_filtered != NULL) *diff_filtered = PID_Q16_TO_FLOAT(fx->diff_filtered);
+}
+
+/**
+ * @brief  用DWT周期计数器对比浮点/定点PID单次计算耗时
+ * @param  iterations: 每种引擎的计算次数
+ * @param  float_cycles: 浮点版本平均周期数
+ * @param  fixed_cycles: 定点版本平均周期数
+ * @note   使用balance_pid参数的副本，不影响控制环；两种引擎都经PID_Calculate，
+ *         定点版本包含控制环实际付出的输入/输出浮点换算
+ */
+void PID_Benchmark(uint32_t iterations, uint32_t *float_cycles, uint32_t *fixed_cycles) {
+  static const float inputs[8] = {10.2f, 9.1f, 12.7f, 3.5f, 10.0f, 14.9f, 8.4f, 10.6f};
+  PID_HandleTypeDef pid;
+  uint32_t start;
+  uint32_t i;
+
+  if (iterations == 0) iterations = 1;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  pid = balance_pid;
+  PID_SetEngine(&pid, PID_ENGINE_FLOAT);
+  start = DWT->CYCCNT;
+  for (i = 0; i < iterations; i++) {
+    PID_Calculate(&pid, inputs[i & 7]);
+  }
+  *float_cycles = (DWT->CYCCNT - start) / iterations;
+
+  pid = balance_pid;
+  PID_SetEngine(&pid, PID_ENGINE_FIXED);
+  start = DWT->CYCCNT;
+  for (i = 0; i < iterations; i++) {
+    PID_Calculate(&pid, inputs[i & 7]);
+  }
+  *fixed_cycles = (DWT->CYCCNT - start) / iterations;
+}
+
 // 平衡控制主函数
 void Balance_Control(void) {
+    // 暂存的参数修改在两次控制之间一起生效
+    Param_Commit();
+    if (rate_request != 0) {
+        uint32_t req = rate_request;
+        rate_request = 0;
+        rate_result = Balance_Set_Rate((uint16_t)(req >> 16), (uint16_t)req);
+        return;
+    }
+    if (calib_request >= 0) {
+        Balance_CalibModeTypeDef mode = (Balance_CalibModeTypeDef)calib_request;
+        calib_request = -1;
+        calib_result = Balance_Calibrate(mode);
+        return;
+    }
+    if (flash_request != NULL) {
+        int (*write)(void) = flash_request;
+        flash_request = NULL;
+        // 写入期间没有控制，先停电机；写完后的样本重新取dt起点
+        TB6612_SetOutputs(0, 0);
+        last_output_us = 0;
+        flash_result = write();
+        __disable_irq();
+        data_ready = 0;
+        last_sample_us = 0;
+        __enable_irq();
+        return;
+    }
     if (data_ready) {  // 有新的角度数据时进行控制
+        __disable_irq();
         data_ready = 0;  // 清除标志
+        float pitch = current_pitch;
+        uint64_t t = sample_us;
+        __enable_irq();
+
+        // 用相邻样本的INT时间戳作为本次的dt，首个样本或间隔异常时用名义周期
+        uint32_t dt_us = dt_nominal_us;
+        if (last_sample_us != 0) {
+            uint64_t dt = t - last_sample_us;
+            if (dt >= dt_min_us && dt <= dt_max_us) {
+                dt_us = (uint32_t)dt;
+            }
+        }
+        last_sample_us = t;
+        PID_Set_Dt(&balance_pid, dt_us);
+        PID_Set_Dt(&speed_pid, dt_us);
+
+        // 编码器随控制节拍采样，测速窗口与姿态样本对齐，速度取M/T结果
+        Encoder_Tick();
+        encoder_speed_left = speed_to_i16(Encoder_Get_Speed(ENCODER_LEFT));
+        encoder_speed_right = speed_to_i16(Encoder_Get_Speed(ENCODER_RIGHT));
 
         // 计算平衡PID输出
-        float balance_output = PID_Calculate(&balance_pid, current_pitch);
-
-        // 应用电机启动阈值优化
-        float optimized_output = Motor_Start_Threshold(balance_output);
-        int16_t motor_speed = (int16_t)optimized_output;
-
-        // 设置电机方向和速度
-        if (motor_speed > 0) {
-            // 输出为正：小车向前倾，需要后轮向前转维持平衡
-            TB6612_SetDirection(TB6612_MOTOR_A, TB6612_FORWARD);
-            TB6612_SetDirection(TB6612_MOTOR_B, TB6612_FORWARD);
-            TB6612_SetSpeed(TB6612_MOTOR_A, motor_speed);
-            TB6612_SetSpeed(TB6612_MOTOR_B, motor_speed);
-        } else if (motor_speed < 0) {
-            // 输出为负：小车向后倾，需要后轮向后转维持平衡
-            TB6612_SetDirection(TB6612_MOTOR_A, TB6612_BACKWARD);
-            TB6612_SetDirection(TB6612_MOTOR_B, TB6612_BACKWARD);
-            TB6612_SetSpeed(TB6612_MOTOR_A, -motor_speed);
-            TB6612_SetSpeed(TB6612_MOTOR_B, -motor_speed);
+        PROF_BEGIN(PROF_STAGE_PID);
+        float balance_output = PID_Calculate(&balance_pid, pitch);
+        // 速度环：取两轮窗口平均速度（比M/T单拍结果平滑），输出从平衡环中减去后按平衡环范围限幅
+        float speed = 0.5f * (float)(Encoder_Get_Speed_Avg(ENCODER_LEFT) + Encoder_Get_Speed_Avg(ENCODER_RIGHT));
+        balance_output -= PID_Calculate(&speed_pid, speed);
+        if (balance_output > balance_pid.max_out) balance_output = balance_pid.max_out;
+        if (balance_output < balance_pid.min_out) balance_output = balance_pid.min_out;
+        PROF_END(PROF_STAGE_PID);
+
+        // 电池电压：输出级按 额定/实际 电压放大占空比，低压断电后电机停转
+        Battery_StateTypeDef battery = Battery_Update();
+        TB6612_Set_Supply(battery == BATTERY_ABSENT ? 0 : Battery_Get_Voltage());
+
+        // 设置电机方向和占空比：输出为正时小车前倾，车轮向前转维持平衡；为0时停止
+        // 按百分比直接换算成TIM1比较值，两路一次写入、同一PWM周期生效
+        // 有摩擦标定时按每路电机、每个方向的阈值补偿，否则用统一的启动阈值
+        PROF_BEGIN(PROF_STAGE_MOTOR);
+        int32_t duty_a, duty_b;
+        if (TB6612_Has_Friction()) {
+            int32_t duty = TB6612_PercentToDuty(balance_output);
+            duty_a = TB6612_Friction_Compensate(TB6612_MOTOR_A, duty, Encoder_Get_Speed(MOTOR_CALIB_ENC_A));
+            duty_b = TB6612_Friction_Compensate(TB6612_MOTOR_B, duty, Encoder_Get_Speed(MOTOR_CALIB_ENC_B));
         } else {
-            // 输出为0：停止电机
-            TB6612_HardStop(TB6612_MOTOR_A);
-            TB6612_HardStop(TB6612_MOTOR_B);
+            duty_a = duty_b = TB6612_PercentToDuty(Motor_Start_Threshold(balance_output));
+        }
+        if (battery == BATTERY_CUTOFF) {
+            duty_a = duty_b = 0;
+        }
+        TB6612_SetOutputs(duty_a, duty_b);
+        last_output_us = Timebase_Now_Us();
+        PROF_END(PROF_STAGE_MOTOR);
+        PROF_END(PROF_STAGE_LATENCY);
+
+        // 二进制遥测：按设定帧率分频，只打包交给DMA，不等待发送
+        if (Telemetry_Due(MPU6050_Get_Rate())) {
+            telemetry_send(t, pitch, duty_a, duty_b, battery);
+        }
+
+        if (boot_info.first_cycle_ms == 0) {
+            boot_info.first_cycle_ms = HAL_GetTick();
         }
+    } else if (last_output_us != 0 &&
+               Timebase_Now_Us() - last_output_us > (uint64_t)dt_nominal_us * STALE_PERIODS) {
+        // 看门狗：样本断了几个周期（传感器停了、总线卡死），不能按旧输出一直转
+        TB6612_SetOutputs(0, 0);
+        last_output_us = 0;
     }
 }
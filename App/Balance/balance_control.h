@@ -11,6 +11,48 @@
 #include "encoder.h"
 
 extern float current_pitch;
+
+// 平衡环默认使用的PID引擎（PID_ENGINE_FLOAT / PID_ENGINE_FIXED）
+#define BALANCE_PID_ENGINE  PID_ENGINE_FLOAT
+
+// 姿态来源（MPU6050_MODE_DMP / MPU6050_MODE_RAW）及其上电速率，控制环与之同频
+// 运行中可用Balance_Set_Rate切换（蓝牙指令rate）
+#define BALANCE_SENSOR_MODE MPU6050_MODE_DMP
+#define BALANCE_SENSOR_HZ   ((BALANCE_SENSOR_MODE == MPU6050_MODE_RAW) ? MPU6050_RAW_DEFAULT_HZ : DEFAULT_MPU_HZ)
+// DMP模式下的功能配置：平衡只需要四元数，不要手势和原始加速度
+#define BALANCE_DMP_PROFILE MPU6050_DMP_PROFILE_BALANCE
+
+// Q16.16定点格式转换
+#define PID_Q16_ONE         65536
+#define PID_FLOAT_TO_Q16(x) ((int32_t)((x) * 65536.0f))
+#define PID_Q16_TO_FLOAT(x) ((float)(x) * (1.0f / 65536.0f))
+
+// PID计算引擎
+typedef enum {
+  PID_ENGINE_FLOAT = 0,   // 软件浮点
+  PID_ENGINE_FIXED        // Q16.16定点（M3无FPU，速度更快）
+} PID_EngineTypeDef;
+
+// 定点PID参数与状态（Q16.16，由浮点参数换算，见PID_Fixed_Sync）
+typedef struct {
+  int32_t kp;
+  int32_t ki;
+  int32_t kd;
+  int32_t target;
+  int32_t deadband;
+  int32_t max_out;
+  int32_t min_out;
+  int32_t ts;             // 采样周期
+  int32_t inv_ts;         // 1/Ts，避免除法
+  int32_t alpha;          // 微分滤波系数
+  int32_t max_integral;   // 积分限幅 = max_out / ki
+  int32_t min_integral;
+  int32_t integral;
+  int32_t last_current;
+  int32_t diff_filtered;
+  int32_t output;
+} PID_FixedTypeDef;
+
 // PID参数结构体
 typedef struct {
   float kp;       // 比例系数
@@ -25,28 +67,82 @@ typedef struct {
   float min_out;  // 最小输出限制
 
   // 新增优化参数
-  float Ts;               // 采样时间（秒），用于标准化参数
+  float Ts;               // 采样时间（秒），平衡环每次按实测间隔更新（PID_Set_Dt）
   float last_current;     // 上一次测量值，用于微分计算
   float diff_filtered;    // 滤波后的微分值，抑制噪声
   float alpha;            // 微分滤波系数（0~1，推荐0.6~0.8）
   float deadband;         // 死区阈值（误差小于此值时不响应，减少抖动）
+
+  PID_EngineTypeDef engine; // 计算引擎
+  PID_FixedTypeDef fx;      // 定点引擎状态
 } PID_HandleTypeDef;
 
+// 启动计时（均为距复位的毫秒数，见Balance_Get_Boot_Info）
+typedef struct {
+  uint32_t dmp_ready_ms;    // MPU6050 DMP初始化完成
+  uint32_t settled_ms;      // 姿态输出稳定，允许控制
+  uint32_t first_cycle_ms;  // 第一次平衡控制输出，0=尚未开始
+  uint32_t dmp_init_ms;     // 其中MPU6050_DMP_init本身的耗时
+  uint8_t dmp_warm;         // 1=复用了芯片中的DMP固件
+  uint8_t settle_timeout;   // 1=等待稳定超时
+  uint8_t calibrated;       // 1=从flash加载了IMU标定，跳过了稳定等待
+  uint8_t async_retries;    // 开启DMA异步读取失败、重新初始化传感器的次数
+} Balance_BootInfoTypeDef;
+
+// IMU标定记录（flash标签FLASH_TAG_IMU_CALIB）
+#define BALANCE_CALIB_GYRO      0x01    // gyro_bias有效
+#define BALANCE_CALIB_ACCEL     0x02    // accel_bias有效（水平放置标定）
+#define BALANCE_CALIB_ANGLE     0x04    // balance_angle有效（平衡点标定）
+
+typedef struct {
+  int32_t gyro_bias[3];     // 陀螺仪零偏（度/秒，Q16，传感器坐标系）
+  int32_t accel_bias[3];    // 加速度计零偏（g，Q16）
+  float balance_angle;      // 机械平衡角（度），上电后作为balance_pid.target
+  uint32_t flags;           // BALANCE_CALIB_*
+} Balance_CalibTypeDef;
+
+// 标定方式
+typedef enum {
+  BALANCE_CALIB_AT_BALANCE = 0, // 扶在平衡点静止：陀螺零偏 + 机械平衡角
+  BALANCE_CALIB_LEVEL,          // 芯片水平静止放置：陀螺 + 加速度计零偏
+  BALANCE_CALIB_FRICTION        // 车轮离地：电机起转/维持阈值（见motor_calib.h）
+} Balance_CalibModeTypeDef;
+
 // 全局变量声明
 
 extern PID_HandleTypeDef balance_pid;
+extern PID_HandleTypeDef speed_pid;       // 速度环（两轮平均速度，输出从平衡环输出中减去）
+extern PID_HandleTypeDef turn_pid;        // 转向环（尚未接入控制，参数可调）
+extern float min_start_pwm;               // 电机最小启动输出（百分比，无摩擦标定时使用）
 extern float current_pitch;  // 当前俯仰角
 extern uint8_t data_ready;   // 数据就绪标志
 extern float target_speed;                // 目标速度
 extern float target_yaw;                  // 目标偏航角
-extern int16_t encoder_speed_left;        // 左编码器速度
-extern int16_t encoder_speed_right;       // 右编码器速度
+extern int16_t encoder_speed_left;        // 左编码器速度（计数/秒，每个控制节拍更新）
+extern int16_t encoder_speed_right;       // 右编码器速度（计数/秒，每个控制节拍更新）
 // 函数声明
 void PID_Init(void);
 void Balance_Init(void);
+void Balance_Set_Sensor_Mode(MPU6050_ModeTypeDef mode, uint16_t rate_hz);
+void Balance_Set_Dmp_Profile(MPU6050_DMP_ProfileTypeDef profile);
+int Balance_Set_Rate(uint16_t rate_hz, uint16_t lpf_hz);
+void Balance_Request_Rate(uint16_t rate_hz, uint16_t lpf_hz);
+int Balance_Get_Rate(uint16_t *rate_hz, uint16_t *lpf_hz);
 float PID_Calculate(PID_HandleTypeDef *pid, float current);
+int32_t PID_Calculate_Q16(PID_HandleTypeDef *pid, int32_t current);
+void PID_Fixed_Sync(PID_HandleTypeDef *pid);
+void PID_SetEngine(PID_HandleTypeDef *pid, PID_EngineTypeDef engine);
+void PID_Set_Dt(PID_HandleTypeDef *pid, uint32_t dt_us);
+void PID_Get_State(const PID_HandleTypeDef *pid, float *error, float *integral, float *diff_filtered);
+void PID_Benchmark(uint32_t iterations, uint32_t *float_cycles, uint32_t *fixed_cycles);
 void Balance_Control(void);
 void MPU6050_Interrupt_Init(void);
+const Balance_BootInfoTypeDef *Balance_Get_Boot_Info(void);
+int Balance_Calibrate(Balance_CalibModeTypeDef mode);
+void Balance_Request_Calibration(Balance_CalibModeTypeDef mode);
+int Balance_Get_Calib(Balance_CalibTypeDef *cal);
+void Balance_Request_Flash_Write(int (*write)(void));
+int Balance_Get_Flash_Write(void);
 
 
 #endif //TWIGO_BALANCE_CONTROL_H
\ No newline at end of file
@@ -1,59 +1,217 @@
 #include "encoder.h"
 #include "tim.h"
 
-// 编码器计数变量
-static int32_t encoder_count[ENCODER_NUM] = {0};
+// 左编码器TIM2，右编码器TIM4（TIM3是100Hz基准定时器）
+static TIM_TypeDef *const encoder_tim[ENCODER_NUM] = { TIM2, TIM4 };
+static const int8_t encoder_dir[ENCODER_NUM] = { ENCODER_LEFT_DIR, ENCODER_RIGHT_DIR };
+static GPIO_TypeDef *const encoder_b_port[ENCODER_NUM] = { ENCODER_LEFT_B_PORT, ENCODER_RIGHT_B_PORT };
+static const uint16_t encoder_b_pin[ENCODER_NUM] = { ENCODER_LEFT_B_PIN, ENCODER_RIGHT_B_PIN };
+
+static Encoder_StateTypeDef encoder_state[ENCODER_NUM];
+static int32_t history[ENCODER_NUM][ENCODER_HISTORY];   // 每个节拍结束时的位置
+static uint8_t history_head;                            // 最新一拍的下标
+static uint8_t window_ticks = 1;
+static int32_t speed_scale = 0;                         // 计数/窗口 -> 计数/秒，Q8
+
+// 最近一个A相上升沿（EXTI中断写，节拍里关中断成组读取）
+static volatile struct {
+    uint32_t cyc;
+    uint16_t cnt;
+    uint16_t seq;
+    int8_t dir;
+} edge[ENCODER_NUM];
+
+// 节拍间计数差：16位无符号相减再转有符号，只要两拍之间不超过±32767计数就不会丢
+static inline int32_t encoder_delta(Encoder_TypeDef e, uint16_t cnt) {
+    return (int16_t)(uint16_t)(cnt - encoder_state[e].last_cnt) * encoder_dir[e];
+}
 
 // 初始化编码器
 void Encoder_Init(void) {
-    // 启动编码器定时器（假设左编码器用TIM2，右编码器用TIM3）
+    GPIO_InitTypeDef gpio = {0};
+
     HAL_TIM_Encoder_Start(&htim2, TIM_CHANNEL_ALL);  // 左编码器
     HAL_TIM_Encoder_Start(&htim4, TIM_CHANNEL_ALL);  // 右编码器
 
+    // A相引脚保持输入（定时器照常计数），另外打开上升沿EXTI做M/T测时
+    gpio.Mode = GPIO_MODE_IT_RISING;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Pin = ENCODER_LEFT_EDGE_PIN;
+    HAL_GPIO_Init(GPIOA, &gpio);
+    gpio.Pin = ENCODER_RIGHT_EDGE_PIN;
+    HAL_GPIO_Init(GPIOB, &gpio);
+
     // 清零计数
     Encoder_Clear_Count(ENCODER_LEFT);
     Encoder_Clear_Count(ENCODER_RIGHT);
+
+    HAL_NVIC_SetPriority(EXTI0_IRQn, ENCODER_EDGE_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+    HAL_NVIC_SetPriority(EXTI9_5_IRQn, ENCODER_EDGE_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
 }
 
-// 获取编码器计数
-int32_t Encoder_Get_Count(Encoder_TypeDef encoder) {
-    if (encoder >= ENCODER_NUM) return 0;
+/**
+ * @brief  设置控制节拍频率（Encoder_Tick的调用频率），据此换算测速窗口
+ * @param  tick_hz: 节拍频率，控制环与姿态样本同频
+ */
+void Encoder_Set_Tick_Rate(uint16_t tick_hz) {
+    uint32_t n = (uint32_t)tick_hz * ENCODER_SPEED_WINDOW_MS / 1000U;
+
+    if (n < 1) n = 1;
+    if (n > ENCODER_HISTORY - 1) n = ENCODER_HISTORY - 1;
+    __disable_irq();
+    window_ticks = (uint8_t)n;
+    speed_scale = (int32_t)(((uint32_t)tick_hz << 8) / n);
+    __enable_irq();
+}
+
+/**
+ * @brief  A相上升沿中断：记录时间戳、B相判出的方向和计数值（在EXTI中断中调用）
+ * @note   A相超前B相时定时器加计数，此时上升沿处B相为低
+ */
+void Encoder_Edge_IRQHandler(Encoder_TypeDef encoder) {
+    uint32_t cyc = DWT->CYCCNT;
+
+    // EXTI没有输入滤波，上升沿上的抖动会连续触发，只认第一个
+    if (cyc - edge[encoder].cyc < SystemCoreClock / 1000000U * ENCODER_EDGE_MIN_US) return;
+    edge[encoder].cyc = cyc;
+    edge[encoder].dir = (encoder_b_port[encoder]->IDR & encoder_b_pin[encoder]) ? -1 : 1;
+    edge[encoder].cnt = (uint16_t)encoder_tim[encoder]->CNT;
+    edge[encoder].seq++;
+}
+
+// 两个同方向A相上升沿处在同一个正交相位，真实计数差一定是4的整数倍；
+// 中断里读到的CNT差最多偏±1（输入滤波延迟、中断延迟），取最近的4的倍数
+static inline int32_t encoder_edge_counts(int32_t raw) {
+    return (raw + (raw >= 0 ? ENCODER_EDGE_COUNTS / 2 : -ENCODER_EDGE_COUNTS / 2)) /
+           ENCODER_EDGE_COUNTS * ENCODER_EDGE_COUNTS;
+}
+
+// M/T测速：本拍有新边沿时，用它和上一个参考边沿之间的计数差除以精确的时间差；
+// 计数差由边沿序列得出（见encoder_edge_counts），两边沿方向相反说明中间换过向、速度过零，记0
+// 没有新边沿时真实速度不会超过一个边沿间隔/距上个边沿的时间，按此上限衰减
+static void encoder_mt_update(Encoder_TypeDef e, Encoder_StateTypeDef *s,
+                              int32_t delta, uint32_t now) {
+    uint32_t cyc, elapsed;
+    uint16_t cnt, seq;
+    int8_t dir;
+
+    __disable_irq();
+    cyc = edge[e].cyc;
+    cnt = edge[e].cnt;
+    seq = edge[e].seq;
+    dir = edge[e].dir;
+    __enable_irq();
+
+    if (seq != s->mt_seq) {
+        if (s->mt_valid && dir != s->mt_dir) {
+            s->speed = 0;
+        } else if (s->mt_valid) {
+            int32_t counts = encoder_edge_counts((int16_t)(uint16_t)(cnt - s->mt_cnt)) * encoder_dir[e];
+            elapsed = cyc - s->mt_cyc;
+            s->speed = elapsed ? (int32_t)((int64_t)counts * SystemCoreClock / elapsed) : 0;
+        }
+        s->mt_cnt = cnt;
+        s->mt_cyc = cyc;
+        s->mt_seq = seq;
+        s->mt_dir = dir;
+        s->mt_valid = 1;
+        return;
+    }
 
-    switch (encoder) {
-        case ENCODER_LEFT:
-            encoder_count[encoder] = (int16_t)TIM2->CNT;
-            break;
-        case ENCODER_RIGHT:
-            encoder_count[encoder] = (int16_t)TIM3->CNT;
-            break;
-        default:
-            break;
+    // 计数走过了整个边沿间隔却没有边沿中断（中断被屏蔽/丢失），退回窗口平均速度
+    if (delta >= ENCODER_EDGE_COUNTS || delta <= -ENCODER_EDGE_COUNTS) {
+        s->speed = s->speed_avg;
+        s->mt_valid = 0;
+        return;
     }
 
-    return encoder_count[encoder];
+    elapsed = now - s->mt_cyc;
+    if (!s->mt_valid || elapsed > SystemCoreClock / 1000U * ENCODER_MT_TIMEOUT_MS) {
+        s->speed = 0;
+        s->mt_valid = 0;
+    } else {
+        int32_t bound = (int32_t)(ENCODER_EDGE_COUNTS * SystemCoreClock / elapsed);
+        if (s->speed > bound) s->speed = bound;
+        if (s->speed < -bound) s->speed = -bound;
+    }
 }
 
-// 清零编码器计数
-void Encoder_Clear_Count(Encoder_TypeDef encoder) {
-    if (encoder >= ENCODER_NUM) return;
+/**
+ * @brief  控制节拍：累计位置、写入历史、更新窗口平均速度和M/T速度（每个控制周期调用一次）
+ * @note   有新边沿时做一次64位除法，其余都是加减乘
+ */
+void Encoder_Tick(void) {
+    uint8_t head = (history_head + 1) & (ENCODER_HISTORY - 1);
+    uint8_t tail = (head - window_ticks) & (ENCODER_HISTORY - 1);
+    uint32_t now = DWT->CYCCNT;
 
-    switch (encoder) {
-        case ENCODER_LEFT:
-            TIM2->CNT = 0;
-            break;
-        case ENCODER_RIGHT:
-            TIM3->CNT = 0;
-            break;
-        default:
-            break;
+    for (uint8_t e = 0; e < ENCODER_NUM; e++) {
+        Encoder_StateTypeDef *s = &encoder_state[e];
+        uint16_t cnt = (uint16_t)encoder_tim[e]->CNT;
+        int32_t delta = encoder_delta((Encoder_TypeDef)e, cnt);
+        s->position += delta;
+        s->last_cnt = cnt;
+        history[e][head] = s->position;
+        s->speed_avg = ((s->position - history[e][tail]) * speed_scale) >> 8;
+        encoder_mt_update((Encoder_TypeDef)e, s, delta, now);
     }
+    history_head = head;
+}
+
+/**
+ * @brief  获取累计位置（计数），含上一节拍之后的增量
+ */
+int32_t Encoder_Get_Count(Encoder_TypeDef encoder) {
+    int32_t pos;
+
+    if (encoder >= ENCODER_NUM) return 0;
+    __disable_irq();
+    pos = encoder_state[encoder].position +
+          encoder_delta(encoder, (uint16_t)encoder_tim[encoder]->CNT);
+    __enable_irq();
+    return pos;
 }
 
-// 编码器定时器中断回调函数（如果需要）
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
-    if (htim->Instance == TIM2) {
-        // 左编码器溢出处理（如果需要）
-    } else if (htim->Instance == TIM3) {
-        // 右编码器溢出处理（如果需要）
+/**
+ * @brief  获取M/T速度（计数/秒，前进为正），低速下分辨率远高于窗口计数
+ */
+int32_t Encoder_Get_Speed(Encoder_TypeDef encoder) {
+    if (encoder >= ENCODER_NUM) return 0;
+    return encoder_state[encoder].speed;
+}
+
+/**
+ * @brief  获取最近一个测速窗口的平均速度（计数/秒，前进为正）
+ */
+int32_t Encoder_Get_Speed_Avg(Encoder_TypeDef encoder) {
+    if (encoder >= ENCODER_NUM) return 0;
+    return encoder_state[encoder].speed_avg;
+}
+
+/**
+ * @brief  获取ticks_ago个节拍之前的位置（0=最近一拍）
+ * @param  ticks_ago: 0 ~ ENCODER_HISTORY-1
+ */
+int32_t Encoder_Get_History(Encoder_TypeDef encoder, uint8_t ticks_ago) {
+    if (encoder >= ENCODER_NUM || ticks_ago >= ENCODER_HISTORY) return 0;
+    return history[encoder][(history_head - ticks_ago) & (ENCODER_HISTORY - 1)];
+}
+
+// 清零编码器计数（位置、历史和速度一起清零）
+void Encoder_Clear_Count(Encoder_TypeDef encoder) {
+    if (encoder >= ENCODER_NUM) return;
+
+    __disable_irq();
+    encoder_state[encoder].position = 0;
+    encoder_state[encoder].speed = 0;
+    encoder_state[encoder].speed_avg = 0;
+    encoder_state[encoder].last_cnt = (uint16_t)encoder_tim[encoder]->CNT;
+    encoder_state[encoder].mt_seq = edge[encoder].seq;
+    encoder_state[encoder].mt_valid = 0;
+    for (uint8_t i = 0; i < ENCODER_HISTORY; i++) {
+        history[encoder][i] = 0;
     }
+    __enable_irq();
 }
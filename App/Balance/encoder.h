@@ -10,9 +10,52 @@ typedef enum {
     ENCODER_NUM
 } Encoder_TypeDef;
 
+// 安装方向：轮子前进时计数减小的一侧改为-1
+#define ENCODER_LEFT_DIR        1
+#define ENCODER_RIGHT_DIR       1
+
+// TIM2/TIM4为TI12编码器模式（A、B两相的上升/下降沿都计数，每线4个计数），
+// 输入滤波IC1Filter/IC2Filter=10（fDTS/16采样连续5次，约1.1us）在CubeMX中配置
+#define ENCODER_HISTORY         16  // 每轮位置历史（控制节拍数，2的幂）
+#define ENCODER_SPEED_WINDOW_MS 40  // 测速窗口，按节拍频率换算成节拍数（至少1拍，至多HISTORY-1拍）
+
+// M/T测速：A相上升沿进EXTI，记录DWT时间戳、计数值和边沿时刻B相电平给出的方向
+// EXTI不经过定时器的输入滤波，中断延迟也不固定，读到的CNT会差±1；
+// 同方向边沿间的计数差按边沿序列取4的整数倍，不直接用CNT差
+// 速度 = 两个节拍内最后一个边沿之间的计数差 / 两边沿的时间差
+#define ENCODER_LEFT_EDGE_PIN   GPIO_PIN_0  // PA0 = TIM2_CH1，EXTI0
+#define ENCODER_RIGHT_EDGE_PIN  GPIO_PIN_6  // PB6 = TIM4_CH1，EXTI9_5
+#define ENCODER_LEFT_B_PORT     GPIOA
+#define ENCODER_LEFT_B_PIN      GPIO_PIN_1  // PA1 = TIM2_CH2
+#define ENCODER_RIGHT_B_PORT    GPIOB
+#define ENCODER_RIGHT_B_PIN     GPIO_PIN_7  // PB7 = TIM4_CH2
+#define ENCODER_EDGE_IRQ_PRIO   2           // 低于MPU INT/DMA和TIM3
+#define ENCODER_EDGE_COUNTS     4           // 相邻两个同方向A相上升沿之间的计数
+#define ENCODER_EDGE_MIN_US     20          // 距上个边沿不足此时间视为抖动（满速边沿间隔约600us）
+#define ENCODER_MT_TIMEOUT_MS   200         // 超过此时间没有边沿视为静止
+
+// 单个编码器的状态（在控制节拍中更新）
+typedef struct {
+    int32_t position;       // 累计位置（计数），16位计数器回绕不丢数
+    int32_t speed;          // M/T速度（计数/秒）
+    int32_t speed_avg;      // 窗口平均速度（计数/秒）
+    uint16_t last_cnt;      // 上一节拍的计数器值
+    uint16_t mt_cnt;        // M/T参考边沿时读到的计数器值
+    uint32_t mt_cyc;        // M/T参考边沿的DWT时间戳
+    uint16_t mt_seq;        // 已处理的边沿序号
+    int8_t mt_dir;          // 参考边沿的方向（B相判出）
+    uint8_t mt_valid;       // 参考边沿有效
+} Encoder_StateTypeDef;
+
 // 函数声明
 void Encoder_Init(void);
+void Encoder_Set_Tick_Rate(uint16_t tick_hz);
+void Encoder_Tick(void);
+void Encoder_Edge_IRQHandler(Encoder_TypeDef encoder);
 int32_t Encoder_Get_Count(Encoder_TypeDef encoder);
+int32_t Encoder_Get_Speed(Encoder_TypeDef encoder);
+int32_t Encoder_Get_Speed_Avg(Encoder_TypeDef encoder);
+int32_t Encoder_Get_History(Encoder_TypeDef encoder, uint8_t ticks_ago);
 void Encoder_Clear_Count(Encoder_TypeDef encoder);
 
 #endif // ENCODER_H
@@ -0,0 +1,140 @@
+#include "Balance/motor_calib.h"
+#include "Sensor/battery.h"
+#include "System/flash_store.h"
+
+static Motor_CalibTypeDef calib;
+
+// 标定期间没有控制节拍，由标定循环推进编码器（保证16位计数不回绕丢数）
+static int32_t enc_count(Encoder_TypeDef enc) {
+  Encoder_Tick();
+  return Encoder_Get_Count(enc);
+}
+
+// 等待车轮停稳：连续一个判停窗口几乎不动
+static int wait_still(Encoder_TypeDef enc) {
+  uint32_t start = HAL_GetTick();
+  int32_t pos = enc_count(enc);
+
+  do {
+    int32_t last = pos;
+    HAL_Delay(MOTOR_CALIB_STILL_MS);
+    pos = enc_count(enc);
+    if (pos - last <= MOTOR_CALIB_STILL_COUNTS && last - pos <= MOTOR_CALIB_STILL_COUNTS) {
+      return 0;
+    }
+  } while (HAL_GetTick() - start < MOTOR_CALIB_SETTLE_MS);
+  return ERROR_MOTOR_CALIB_SETTLE;
+}
+
+// 按额定电压下的比较值输出：和TB6612_SetOutputs一样乘 额定/实际 电压（scale，Q12），
+// 搜索步长对应的电压不随电池电量变化，测得的阈值直接就是额定电压下的值
+static void set_nominal(TB6612_MotorTypeDef motor, int32_t duty, int32_t scale) {
+  TB6612_SetDuty(motor, duty * scale / TB6612_SUPPLY_SCALE_ONE);
+}
+
+// 标定一路电机的一个方向
+static int calib_one(TB6612_MotorTypeDef motor, Encoder_TypeDef enc, uint8_t dir, int32_t scale,
+                     uint16_t *start, uint16_t *keep) {
+  int32_t sign = dir ? -1 : 1;
+  int32_t max = (int32_t)(TB6612_PWM_MAX * MOTOR_CALIB_MAX_PERCENT / 100U);
+  int32_t duty, moving, pos0, moved;
+  int ret;
+
+  ret = wait_still(enc);
+  if (ret != 0) return ret;
+
+  // 起转：静止开始逐步加大，累计转过MOVE_COUNTS为止
+  pos0 = enc_count(enc);
+  for (duty = MOTOR_CALIB_STEP;; duty += MOTOR_CALIB_STEP) {
+    if (duty > max) {
+      TB6612_HardStop(motor);
+      return ERROR_MOTOR_CALIB_NO_MOVE;
+    }
+    set_nominal(motor, sign * duty, scale);
+    HAL_Delay(MOTOR_CALIB_STEP_MS);
+    moved = (enc_count(enc) - pos0) * sign;
+    if (moved <= -MOTOR_CALIB_MOVE_COUNTS) {
+      TB6612_HardStop(motor);
+      return ERROR_MOTOR_CALIB_DIR;
+    }
+    if (moved >= MOTOR_CALIB_MOVE_COUNTS) break;
+  }
+  *start = (uint16_t)duty;
+
+  // 维持：转动中逐步减小，记录最后一个判停窗口内仍在转的值
+  for (moving = duty; duty > 0; duty -= MOTOR_CALIB_STEP) {
+    set_nominal(motor, sign * duty, scale);
+    pos0 = enc_count(enc);
+    HAL_Delay(MOTOR_CALIB_STILL_MS);
+    if ((enc_count(enc) - pos0) * sign <= MOTOR_CALIB_STILL_COUNTS) break;
+    moving = duty;
+  }
+  *keep = (uint16_t)moving;
+  TB6612_HardStop(motor);
+  return 0;
+}
+
+/**
+ * @brief  从flash加载电机摩擦标定并装入TB6612补偿表（上电时调用）
+ * @retval 0=已加载，1=没有标定记录
+ */
+int Motor_Calib_Load(void) {
+  if (Flash_Store_Read(FLASH_TAG_MOTOR_CALIB, &calib, sizeof(calib)) != (int)sizeof(calib) ||
+      !(calib.flags & MOTOR_CALIB_VALID)) {
+    calib = (Motor_CalibTypeDef){0};
+    return 1;
+  }
+  TB6612_Set_Friction(TB6612_MOTOR_A, &calib.motor[TB6612_MOTOR_A]);
+  TB6612_Set_Friction(TB6612_MOTOR_B, &calib.motor[TB6612_MOTOR_B]);
+  return 0;
+}
+
+/**
+ * @brief  执行电机摩擦标定（车轮离地，阻塞约10秒，在主循环中调用）
+ * @retval 0=成功并已保存，负数为ERROR_MOTOR_CALIB_*；失败时保留原补偿表
+ */
+int Motor_Calib_Run(void) {
+  static const Encoder_TypeDef enc[2] = { MOTOR_CALIB_ENC_A, MOTOR_CALIB_ENC_B };
+  Motor_CalibTypeDef cal = {0};
+  Battery_StateTypeDef battery;
+  int32_t scale;
+  int ret = 0;
+
+  // 标定时的电池电压，按控制环同样的方式得到补偿系数
+  battery = Battery_Update();
+  TB6612_Set_Supply(battery == BATTERY_ABSENT ? 0 : Battery_Get_Voltage());
+  scale = TB6612_Get_Supply_Scale();
+
+  TB6612_HardStop(TB6612_MOTOR_A);
+  TB6612_HardStop(TB6612_MOTOR_B);
+  for (uint8_t m = 0; m < 2 && ret == 0; m++) {
+    for (uint8_t dir = 0; dir < 2 && ret == 0; dir++) {
+      ret = calib_one((TB6612_MotorTypeDef)m, enc[m], dir, scale,
+                      &cal.motor[m].start[dir], &cal.motor[m].keep[dir]);
+    }
+  }
+  TB6612_HardStop(TB6612_MOTOR_A);
+  TB6612_HardStop(TB6612_MOTOR_B);
+  if (ret != 0) return ret;
+
+  cal.flags = MOTOR_CALIB_VALID;
+  if (Flash_Store_Write(FLASH_TAG_MOTOR_CALIB, &cal, sizeof(cal)) != 0) {
+    return ERROR_MOTOR_CALIB_FLASH;
+  }
+  calib = cal;
+  TB6612_Set_Friction(TB6612_MOTOR_A, &calib.motor[TB6612_MOTOR_A]);
+  TB6612_Set_Friction(TB6612_MOTOR_B, &calib.motor[TB6612_MOTOR_B]);
+  return 0;
+}
+
+/**
+ * @brief  获取当前电机摩擦标定
+ * @param  cal: 输出，可为NULL
+ * @retval 0=有效，1=未标定
+ */
+int Motor_Calib_Get(Motor_CalibTypeDef *cal) {
+  if (cal != NULL) {
+    *cal = calib;
+  }
+  return (calib.flags & MOTOR_CALIB_VALID) ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+#ifndef TWIGO_MOTOR_CALIB_H
+#define TWIGO_MOTOR_CALIB_H
+
+#include "stm32f1xx_hal.h"
+#include "Motor/tb6612.h"
+#include "encoder.h"
+
+// 电机摩擦标定：车轮离地，每路电机每个方向从0逐步加大占空比直到编码器检测到转动（起转阈值），
+// 再逐步减小直到停转（最后一个仍能转动的值为维持阈值），结果存flash并装入TB6612补偿表
+// 四次共约10秒，期间阻塞主循环，不做平衡控制
+// 搜索和存储都用额定电压TB6612_SUPPLY_NOMINAL_MV下的比较值（输出时按标定时的电池电压补偿），
+// 运行时与控制输出一起经TB6612_SetOutputs按当前电压补偿，阈值不随标定时的电池电量变化
+#define MOTOR_CALIB_ENC_A           ENCODER_LEFT    // 电机A对应的编码器
+#define MOTOR_CALIB_ENC_B           ENCODER_RIGHT   // 电机B对应的编码器
+#define MOTOR_CALIB_STEP            9       // 每步增减的比较值（满量程3600时为0.25%）
+#define MOTOR_CALIB_STEP_MS         10      // 起转搜索每步保持时间
+#define MOTOR_CALIB_MOVE_COUNTS     8       // 累计转过此计数认为已起转
+#define MOTOR_CALIB_STILL_MS        50      // 判停窗口（维持搜索每步保持时间）
+#define MOTOR_CALIB_STILL_COUNTS    1       // 判停窗口内转过的计数不超过此值认为停转
+#define MOTOR_CALIB_SETTLE_MS       2000    // 开始前等待车轮停稳的上限
+#define MOTOR_CALIB_MAX_PERCENT     60      // 起转阈值上限，超过认为电机或编码器异常
+
+// 错误码接在Balance_Calibrate的-1~-3之后，经同一个标定结果上报
+#define ERROR_MOTOR_CALIB_NO_MOVE   -4      // 到上限仍未检测到转动（未接电机/编码器，或车轮着地）
+#define ERROR_MOTOR_CALIB_DIR       -5      // 编码器方向与电机方向相反（检查ENCODER_*_DIR）
+#define ERROR_MOTOR_CALIB_SETTLE    -6      // 车轮一直在转，无法开始
+#define ERROR_MOTOR_CALIB_FLASH     -7      // 写flash失败
+
+// 标定记录（flash标签FLASH_TAG_MOTOR_CALIB）
+#define MOTOR_CALIB_VALID           0x01
+
+typedef struct {
+  TB6612_FrictionTypeDef motor[2];  // [TB6612_MOTOR_A, TB6612_MOTOR_B]
+  uint32_t flags;                   // MOTOR_CALIB_*
+} Motor_CalibTypeDef;
+
+int Motor_Calib_Load(void);
+int Motor_Calib_Run(void);
+int Motor_Calib_Get(Motor_CalibTypeDef *cal);
+
+#endif //TWIGO_MOTOR_CALIB_H
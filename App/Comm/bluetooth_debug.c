@@ -2,18 +2,40 @@
 // Created by Falling_jasmine on 2025/8/25.
 //
 #include "Comm/hc05.h"
+#include "Comm/telemetry.h"
+#include "Comm/tx_ring.h"
 #include "Balance/balance_control.h"
+#include "Balance/motor_calib.h"
+#include "Sensor/battery.h"
 #include "Motor/tb6612.h"
+#include "System/profiler.h"
+#include "System/i2c_bus.h"
+#include "System/param.h"
+#include "i2c.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
-// 蓝牙接收缓冲区配置
-#define RX_BUF_SIZE 128
-static uint8_t rx_buf[RX_BUF_SIZE] = {0};
+// 蓝牙接收：DMA循环写入rx_dma，半满/全满/空闲线中断里把新字节拼成行，
+// 整行放进队列，解析和回复都在主循环中执行，不占用串口中断
+#define RX_BUF_SIZE 128     // 单条指令最大长度
+#define RX_DMA_SIZE 64      // DMA循环缓冲区（9600波特下约33ms写满半圈，460800波特下约0.7ms）
+#define RX_LINE_NUM 4       // 待解析指令队列（2的幂）
+static uint8_t rx_dma[RX_DMA_SIZE];
+static uint16_t rx_dma_pos;                     // 已处理到的DMA缓冲区位置
+static uint8_t rx_buf[RX_BUF_SIZE] = {0};       // 正在拼接的一行
 static uint16_t rx_len = 0;
-static uint8_t rx_temp;  // 中断接收临时变量
+static uint8_t rx_lines[RX_LINE_NUM][RX_BUF_SIZE];
+static uint16_t rx_line_len[RX_LINE_NUM];
+static volatile uint8_t line_head;              // 中断写入
+static volatile uint8_t line_tail;              // 主循环读出
+static uint8_t baud_reset_sent;                 // 发过baud reset，baud?时报告清除结果
+
+// list/dump输出较长，主循环每次在发送缓冲有空间时输出一行，不阻塞平衡控制
+#define PARAM_LINE_MAX  80U
+static uint8_t param_stream;                    // 0=无，CMD_PARAM_LIST/CMD_PARAM_DUMP
+static uint8_t param_next;                      // 下一个要输出的参数编号
 
 // 指令类型枚举
 typedef enum {
@@ -22,7 +44,30 @@ typedef enum {
     CMD_SET_P,
     CMD_SET_I,
     CMD_SET_D,
-    CMD_SET_TARGET
+    CMD_SET_TARGET,
+    CMD_SET_ENGINE,
+    CMD_BENCH,
+    CMD_PROF,
+    CMD_PROF_RESET,
+    CMD_BOOT,
+    CMD_CAL,
+    CMD_CAL_LEVEL,
+    CMD_CAL_MOTOR,
+    CMD_CAL_INFO,
+    CMD_I2C_INFO,
+    CMD_RATE,
+    CMD_RATE_INFO,
+    CMD_BAT_INFO,
+    CMD_BAT_RESET,
+    CMD_TELE,
+    CMD_TELE_INFO,
+    CMD_TX_INFO,
+    CMD_BAUD_INFO,
+    CMD_BAUD_RESET,
+    CMD_PARAM_GET,
+    CMD_PARAM_SET,
+    CMD_PARAM_LIST,
+    CMD_PARAM_DUMP
 } CmdType;
 
 // 解析指令类型
@@ -37,6 +82,52 @@ static CmdType get_cmd_type(const char *cmd) {
         return CMD_SET_D;
     } else if (strncmp(cmd, "T ", 2) == 0) {
         return CMD_SET_TARGET;
+    } else if (strncmp(cmd, "E ", 2) == 0) {
+        return CMD_SET_ENGINE;
+    } else if (strcmp(cmd, "bench") == 0) {
+        return CMD_BENCH;
+    } else if (strcmp(cmd, "prof") == 0) {
+        return CMD_PROF;
+    } else if (strcmp(cmd, "prof reset") == 0) {
+        return CMD_PROF_RESET;
+    } else if (strcmp(cmd, "boot") == 0) {
+        return CMD_BOOT;
+    } else if (strcmp(cmd, "cal") == 0) {
+        return CMD_CAL;
+    } else if (strcmp(cmd, "cal level") == 0) {
+        return CMD_CAL_LEVEL;
+    } else if (strcmp(cmd, "cal motor") == 0) {
+        return CMD_CAL_MOTOR;
+    } else if (strcmp(cmd, "cal?") == 0) {
+        return CMD_CAL_INFO;
+    } else if (strcmp(cmd, "i2c?") == 0) {
+        return CMD_I2C_INFO;
+    } else if (strcmp(cmd, "rate?") == 0) {
+        return CMD_RATE_INFO;
+    } else if (strcmp(cmd, "bat?") == 0) {
+        return CMD_BAT_INFO;
+    } else if (strcmp(cmd, "bat reset") == 0) {
+        return CMD_BAT_RESET;
+    } else if (strncmp(cmd, "rate ", 5) == 0) {
+        return CMD_RATE;
+    } else if (strcmp(cmd, "tx?") == 0) {
+        return CMD_TX_INFO;
+    } else if (strcmp(cmd, "baud?") == 0) {
+        return CMD_BAUD_INFO;
+    } else if (strcmp(cmd, "baud reset") == 0) {
+        return CMD_BAUD_RESET;
+    } else if (strncmp(cmd, "get ", 4) == 0) {
+        return CMD_PARAM_GET;
+    } else if (strncmp(cmd, "set ", 4) == 0) {
+        return CMD_PARAM_SET;
+    } else if (strcmp(cmd, "list") == 0) {
+        return CMD_PARAM_LIST;
+    } else if (strcmp(cmd, "dump") == 0) {
+        return CMD_PARAM_DUMP;
+    } else if (strcmp(cmd, "tele?") == 0) {
+        return CMD_TELE_INFO;
+    } else if (strncmp(cmd, "tele ", 5) == 0) {
+        return CMD_TELE;
     }
     return CMD_UNKNOWN;
 }
@@ -47,8 +138,12 @@ void HC05_SendString(const char *str) {
     HC05_SendData((uint8_t *)str, strlen(str));
 }
 
-// 处理参数设置指令
+// 处理参数设置指令（P/I/D/T经参数表暂存，下个控制周期生效）
 static void handle_param_set(CmdType type, const char *param_str) {
+    static const uint8_t param_id[] = {
+        [CMD_SET_P] = PARAM_BAL_KP, [CMD_SET_I] = PARAM_BAL_KI,
+        [CMD_SET_D] = PARAM_BAL_KD, [CMD_SET_TARGET] = PARAM_BAL_TARGET,
+    };
     float value;
     char reply[64];
 
@@ -61,20 +156,22 @@ static void handle_param_set(CmdType type, const char *param_str) {
     // 根据指令类型设置参数
     switch (type) {
         case CMD_SET_P:
-            balance_pid.kp = value;
-            snprintf(reply, sizeof(reply), "已设置P=%.2f\r\n", value);
-            break;
         case CMD_SET_I:
-            balance_pid.ki = value;
-            snprintf(reply, sizeof(reply), "已设置I=%.2f\r\n", value);
-            break;
         case CMD_SET_D:
-            balance_pid.kd = value;
-            snprintf(reply, sizeof(reply), "已设置D=%.2f\r\n", value);
+        case CMD_SET_TARGET: {
+            const Param_DescTypeDef *d = Param_Get_Desc(param_id[type]);
+            if (Param_Set(param_id[type], value) != 0) {
+                snprintf(reply, sizeof(reply), "%s超出范围[%g, %g]\r\n", d->name, d->min, d->max);
+            } else {
+                snprintf(reply, sizeof(reply), "已设置%s=%.2f\r\n", d->name, value);
+            }
             break;
-        case CMD_SET_TARGET:
-            balance_pid.target = value;
-            snprintf(reply, sizeof(reply), "已设置目标角度=%.1f\r\n", value);
+        }
+        case CMD_SET_ENGINE:
+            // 切换引擎要换算运行状态（同时同步定点参数），不经参数表
+            PID_SetEngine(&balance_pid, value != 0.0f ? PID_ENGINE_FIXED : PID_ENGINE_FLOAT);
+            snprintf(reply, sizeof(reply), "已切换PID引擎=%s\r\n",
+                     balance_pid.engine == PID_ENGINE_FIXED ? "定点" : "浮点");
             break;
         default:
             return;
@@ -84,19 +181,321 @@ static void handle_param_set(CmdType type, const char *param_str) {
 
 // 处理信息查询指令
 static void handle_get_info(void) {
-    char reply[128];
+    char reply[192];
+    float error, integral, diff;
+    // 定点引擎时浮点状态字段不逐周期更新，从定点状态读取
+    PID_Get_State(&balance_pid, &error, &integral, &diff);
     snprintf(reply, sizeof(reply),
             "当前状态:\r\n"
             "PID参数: Kp=%.2f, Ki=%.2f, Kd=%.2f\r\n"
+            "PID状态: 误差=%.2f, 积分=%.2f, 微分=%.1f\r\n"
             "角度: 目标=%.1f°, 当前=%.1f°\r\n"
             "电机速度: A=%d, B=%d\r\n",
             balance_pid.kp, balance_pid.ki, balance_pid.kd,
+            error, integral, diff,
             balance_pid.target, current_pitch,
             TB6612_GetCurrentSpeed(TB6612_MOTOR_A),
             TB6612_GetCurrentSpeed(TB6612_MOTOR_B));
     HC05_SendString(reply);
 }
 
+// 处理PID耗时测试指令
+static void handle_bench(void) {
+    char reply[64];
+    uint32_t float_cycles, fixed_cycles;
+    PID_Benchmark(1000, &float_cycles, &fixed_cycles);
+    snprintf(reply, sizeof(reply), "PID耗时(周期/次): 浮点=%lu, 定点=%lu\r\n",
+             (unsigned long)float_cycles, (unsigned long)fixed_cycles);
+    HC05_SendString(reply);
+}
+
+// 处理性能统计查询指令（单位：CPU周期，72周期=1us）
+static void handle_prof(void) {
+#if PROFILER_ENABLE
+    char reply[128];
+    const MPU6050_DMP_ProfileInfoTypeDef *dp = MPU6050_DMP_Get_Profile();
+    snprintf(reply, sizeof(reply), "DMP配置: %s, %u字节/包\r\n", dp->name, dp->packet_len);
+    HC05_SendString(reply);
+    for (uint8_t i = 0; i < PROF_STAGE_COUNT; i++) {
+        const Profiler_StatTypeDef *s = Profiler_Get_Stat((Profiler_StageTypeDef)i);
+        if (s->count == 0) {
+            continue;
+        }
+        int len = snprintf(reply, sizeof(reply), "%s n=%lu min=%lu avg=%lu max=%lu\r\n  hist:",
+                           Profiler_Get_Name((Profiler_StageTypeDef)i),
+                           (unsigned long)s->count, (unsigned long)s->min,
+                           (unsigned long)(s->sum / s->count), (unsigned long)s->max);
+        // 只输出非空的log2区间
+        for (uint8_t b = 0; b < PROFILER_HIST_BINS && len < (int)sizeof(reply) - 16; b++) {
+            if (s->hist[b]) {
+                len += snprintf(reply + len, sizeof(reply) - len, " %u:%lu",
+                                b, (unsigned long)s->hist[b]);
+            }
+        }
+        snprintf(reply + len, sizeof(reply) - len, "\r\n");
+        HC05_SendString(reply);
+    }
+#else
+    HC05_SendString("性能统计未编译(PROFILER_ENABLE=0)\r\n");
+#endif
+}
+
+// 处理启动计时查询指令（距复位的毫秒数）
+static void handle_boot(void) {
+    char reply[192];
+    const Balance_BootInfoTypeDef *b = Balance_Get_Boot_Info();
+    snprintf(reply, sizeof(reply),
+             "启动(%s%s): DMP就绪=%lums(初始化%lums), 姿态稳定=%lums%s, 首次控制=%lums, 异步读取重试=%u\r\n",
+             b->dmp_warm ? "热" : "冷", b->calibrated ? ",已标定" : "",
+             (unsigned long)b->dmp_ready_ms, (unsigned long)b->dmp_init_ms,
+             (unsigned long)b->settled_ms, b->settle_timeout ? "(超时)" : "",
+             (unsigned long)b->first_cycle_ms, b->async_retries);
+    HC05_SendString(reply);
+}
+
+// 处理标定结果查询指令
+static void handle_cal_info(void) {
+    char reply[192];
+    Balance_CalibTypeDef cal;
+    int result = Balance_Get_Calib(&cal);
+    if (result != 0) {
+        snprintf(reply, sizeof(reply), "标定: %s\r\n",
+                 result > 0 ? "未标定或进行中" : "失败");
+        HC05_SendString(reply);
+        if (result > 0) {
+            return;
+        }
+    }
+    snprintf(reply, sizeof(reply),
+             "标定: 平衡角=%.2f°%s, 陀螺零偏=%.3f/%.3f/%.3f°/s%s\r\n",
+             cal.balance_angle, (cal.flags & BALANCE_CALIB_ANGLE) ? "" : "(无)",
+             cal.gyro_bias[0] / 65536.0f, cal.gyro_bias[1] / 65536.0f, cal.gyro_bias[2] / 65536.0f,
+             (cal.flags & BALANCE_CALIB_ACCEL) ? ", 含加速度计" : "");
+    HC05_SendString(reply);
+
+    Motor_CalibTypeDef mc;
+    if (Motor_Calib_Get(&mc) == 0) {
+        snprintf(reply, sizeof(reply),
+                 "电机: A起转%u/%u 维持%u/%u, B起转%u/%u 维持%u/%u (正/反, 满量程%lu)\r\n",
+                 mc.motor[0].start[0], mc.motor[0].start[1], mc.motor[0].keep[0], mc.motor[0].keep[1],
+                 mc.motor[1].start[0], mc.motor[1].start[1], mc.motor[1].keep[0], mc.motor[1].keep[1],
+                 (unsigned long)TB6612_PWM_MAX);
+    } else {
+        snprintf(reply, sizeof(reply), "电机: 未标定摩擦，使用统一启动阈值\r\n");
+    }
+    HC05_SendString(reply);
+}
+
+// 处理I2C总线统计查询指令
+static void handle_i2c_info(void) {
+    static I2C_HandleTypeDef *const bus[] = { &hi2c1, &hi2c2 };
+    char reply[192];
+    for (uint8_t i = 0; i < sizeof(bus) / sizeof(bus[0]); i++) {
+        const I2C_Bus_StatsTypeDef *s = I2C_Bus_Get_Stats(bus[i]);
+        if (s == NULL) {
+            continue;
+        }
+        snprintf(reply, sizeof(reply),
+                 "I2C%u: 传输=%lu 无应答=%lu 错误=%lu 超时=%lu 忙=%lu 恢复=%lu(失败%lu, 补时钟%lu) "
+                 "恢复耗时=%lu/%luus\r\n",
+                 i + 1, (unsigned long)s->transfers, (unsigned long)s->nacks,
+                 (unsigned long)s->errors, (unsigned long)s->timeouts, (unsigned long)s->busy,
+                 (unsigned long)s->recoveries, (unsigned long)s->recover_fails,
+                 (unsigned long)s->clock_pulses, (unsigned long)s->last_recover_us,
+                 (unsigned long)s->max_recover_us);
+        HC05_SendString(reply);
+    }
+}
+
+// 处理速率切换指令：rate <Hz> [低通Hz]
+static void handle_rate_set(const char *param_str) {
+    char *end;
+    long rate = strtol(param_str, &end, 10);
+    long lpf = strtol(end, NULL, 10);
+    if (end == param_str || rate < MPU6050_MIN_HZ || rate > MPU6050_RAW_MAX_HZ || lpf < 0 || lpf > 188) {
+        HC05_SendString("参数格式错误，用法: rate <Hz(20~1000)> [低通Hz]\r\n");
+        return;
+    }
+    // 切换要关闭DMA读取并写传感器寄存器，交给主循环执行
+    Balance_Request_Rate((uint16_t)rate, (uint16_t)lpf);
+    HC05_SendString("开始切换速率，发送 rate? 查看\r\n");
+}
+
+// 处理电池查询指令
+static void handle_bat_info(void) {
+    static const char *const state_name[] = { "未接电池", "正常", "低电量", "低压断电" };
+    char reply[96];
+    uint16_t scale = TB6612_Get_Supply_Scale();
+    snprintf(reply, sizeof(reply), "电池: %u.%02uV, %s, 占空比补偿x%u.%02u\r\n",
+             Battery_Get_Voltage() / 1000U, (Battery_Get_Voltage() % 1000U) / 10U,
+             state_name[Battery_Get_State()],
+             scale / TB6612_SUPPLY_SCALE_ONE, (scale % TB6612_SUPPLY_SCALE_ONE) * 100U / TB6612_SUPPLY_SCALE_ONE);
+    HC05_SendString(reply);
+}
+
+// 处理速率查询指令
+static void handle_rate_info(void) {
+    char reply[96];
+    uint16_t rate, lpf;
+    int result = Balance_Get_Rate(&rate, &lpf);
+    snprintf(reply, sizeof(reply), "速率: %uHz, 低通=%uHz, 控制周期=%luus%s\r\n",
+             rate, lpf, 1000000UL / rate,
+             result > 0 ? "(切换中)" : (result < 0 ? "(上次切换失败)" : ""));
+    HC05_SendString(reply);
+}
+
+// 处理遥测开关指令：tele <Hz>，0=关闭
+static void handle_tele_set(const char *param_str) {
+    char reply[160];
+    char *end;
+    long rate = strtol(param_str, &end, 10);
+    if (end == param_str || rate < 0 || rate > 1000) {
+        HC05_SendString("参数格式错误，用法: tele <Hz>，0=关闭\r\n");
+        return;
+    }
+    if (rate == 0) {
+        Telemetry_Set_Rate(0);
+        HC05_SendString("遥测已关闭\r\n");
+        return;
+    }
+    // 先回复再打开，避免文本和第一帧挤在一起
+    snprintf(reply, sizeof(reply), "遥测: %ldHz, 每帧%u字节(COBS+CRC16), %lu波特下最多%u帧/秒，超出的帧丢弃\r\n",
+             rate, (unsigned)TELEMETRY_FRAME_MAX, (unsigned long)hc05_huart->Init.BaudRate,
+             Telemetry_Get_Link_Max());
+    HC05_SendString(reply);
+    Telemetry_Set_Rate((uint16_t)rate);
+}
+
+// 处理遥测统计查询指令
+static void handle_tele_info(void) {
+    char reply[96];
+    const Telemetry_StatsTypeDef *s = Telemetry_Get_Stats();
+    snprintf(reply, sizeof(reply), "遥测: %uHz(链路上限%u), 已发送=%lu 丢弃=%lu\r\n",
+             Telemetry_Get_Rate(), Telemetry_Get_Link_Max(),
+             (unsigned long)s->sent, (unsigned long)s->dropped);
+    HC05_SendString(reply);
+}
+
+// 处理发送缓冲统计查询指令
+static void handle_tx_info(void) {
+    char reply[128];
+    const Tx_Ring_StatsTypeDef *s = Tx_Ring_Get_Stats();
+    snprintf(reply, sizeof(reply), "发送缓冲(%s): 待发=%u/%u 最高=%u 写入=%lu 丢弃=%lu字节 DMA错误=%lu\r\n",
+             TX_RING_POLICY == TX_RING_DROP_OLDEST ? "挤掉旧数据" : "丢弃新数据",
+             Tx_Ring_Used(), (unsigned)TX_RING_SIZE, s->high_water,
+             (unsigned long)s->written, (unsigned long)s->dropped, (unsigned long)s->dma_errors);
+    HC05_SendString(reply);
+}
+
+// 处理串口波特率查询指令
+static void handle_baud_info(void) {
+    char reply[160];
+    const HC05_LinkInfoTypeDef *l = HC05_Get_Link_Info();
+    if (baud_reset_sent) {
+        int result = Balance_Get_Flash_Write();
+        HC05_SendString(result > 0 ? "波特率记录: 清除中\r\n" :
+                        (result == 0 ? "波特率记录: 已清除，下次上电重新探测\r\n" : "波特率记录: 清除失败\r\n"));
+    }
+    if (l->no_at) {
+        snprintf(reply, sizeof(reply), "波特率: %lu, 上次探测模块无应答，沿用记录未发AT('baud reset'后重新探测)\r\n",
+                 (unsigned long)hc05_huart->Init.BaudRate);
+    } else if (l->found_baud == 0) {
+        snprintf(reply, sizeof(reply), "波特率: %lu, 启动时模块无应答(已被连接?)，未协商\r\n",
+                 (unsigned long)hc05_huart->Init.BaudRate);
+    } else {
+        snprintf(reply, sizeof(reply), "波特率: %lu, %s%lu, 升级失败%u次, 耗时%lums\r\n",
+                 (unsigned long)hc05_huart->Init.BaudRate,
+                 l->from_cache ? "使用缓存" : "探测到模块@", (unsigned long)l->found_baud,
+                 l->failed, (unsigned long)l->elapsed_ms);
+    }
+    HC05_SendString(reply);
+}
+
+// 参数名或编号转换为编号，-1=没有该参数
+static int param_lookup(const char *token) {
+    char *end;
+    if (*token >= '0' && *token <= '9') {
+        long id = strtol(token, &end, 10);
+        return (*end == '\0' && id < PARAM_COUNT) ? (int)id : -1;
+    }
+    return Param_Find(token);
+}
+
+// 处理参数读取指令：get <名称|编号>
+static void handle_param_get(char *param_str) {
+    char reply[PARAM_LINE_MAX];
+    char *token = strtok(param_str, " ");
+    int id = token ? param_lookup(token) : -1;
+    float value;
+    if (id < 0) {
+        HC05_SendString("没有该参数，发送 list 查看\r\n");
+        return;
+    }
+    Param_Get((uint8_t)id, &value);
+    snprintf(reply, sizeof(reply), "%d %s=%g\r\n", id, Param_Get_Desc((uint8_t)id)->name, value);
+    HC05_SendString(reply);
+}
+
+// 处理参数修改指令：set <名称|编号> <值> [<名称|编号> <值> ...]
+// 先检查全部参数，全部合法才暂存，同一条指令的修改在同一个控制周期生效
+static void handle_param_set_multi(char *param_str) {
+    uint8_t ids[8];
+    float values[8];
+    uint8_t n = 0;
+    char reply[PARAM_LINE_MAX];
+    char *token, *end;
+
+    for (token = strtok(param_str, " "); token != NULL; token = strtok(NULL, " ")) {
+        int id = param_lookup(token);
+        char *value_str = strtok(NULL, " ");
+        if (id < 0 || value_str == NULL || n >= sizeof(ids)) {
+            snprintf(reply, sizeof(reply), "参数错误: %s，用法: set <名称|编号> <值> ...(最多8个)\r\n", token);
+            HC05_SendString(reply);
+            return;
+        }
+        const Param_DescTypeDef *d = Param_Get_Desc((uint8_t)id);
+        float value = strtof(value_str, &end);
+        if (end == value_str || *end != '\0' || !(value >= d->min && value <= d->max)) {
+            snprintf(reply, sizeof(reply), "%s=%s 超出范围[%g, %g]，未修改\r\n", d->name, value_str, d->min, d->max);
+            HC05_SendString(reply);
+            return;
+        }
+        ids[n] = (uint8_t)id;
+        values[n++] = value;
+    }
+    if (n == 0) {
+        HC05_SendString("用法: set <名称|编号> <值> ...\r\n");
+        return;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        Param_Set(ids[i], values[i]);
+    }
+    snprintf(reply, sizeof(reply), "已暂存%u个参数，下个控制周期一起生效\r\n", n);
+    HC05_SendString(reply);
+}
+
+// list/dump输出一行：list为 编号 名称=值 [下限, 上限]，dump为可直接发回的set指令
+static void param_stream_step(void) {
+    char line[PARAM_LINE_MAX];
+    const Param_DescTypeDef *d;
+    float value;
+
+    if (param_stream == 0 || Tx_Ring_Used() + PARAM_LINE_MAX > TX_RING_SIZE) {
+        return;
+    }
+    d = Param_Get_Desc(param_next);
+    Param_Get(param_next, &value);
+    if (param_stream == CMD_PARAM_LIST) {
+        snprintf(line, sizeof(line), "%2u %s=%g [%g, %g]\r\n", param_next, d->name, value, d->min, d->max);
+    } else {
+        snprintf(line, sizeof(line), "set %s %g\r\n", d->name, value);
+    }
+    HC05_SendString(line);
+    if (++param_next >= PARAM_COUNT) {
+        param_stream = 0;
+    }
+}
+
 // 解析蓝牙指令主函数
 static void ParseBluetoothCommand(uint8_t *rx_buf, uint16_t rx_len) {
     // 移除末尾换行符
@@ -132,56 +531,186 @@ static void ParseBluetoothCommand(uint8_t *rx_buf, uint16_t rx_len) {
         case CMD_SET_I:
         case CMD_SET_D:
         case CMD_SET_TARGET:
+        case CMD_SET_ENGINE:
             handle_param_set(cmd, (char*)rx_buf + 2);  // 跳过指令前缀
             break;
+        case CMD_BENCH:
+            handle_bench();
+            break;
+        case CMD_PROF:
+            handle_prof();
+            break;
+        case CMD_PROF_RESET:
+#if PROFILER_ENABLE
+            Profiler_Reset();
+#endif
+            HC05_SendString("性能统计已清零\r\n");
+            break;
+        case CMD_BOOT:
+            handle_boot();
+            break;
+        case CMD_CAL:
+            // 标定阻塞约2秒，交给主循环执行
+            Balance_Request_Calibration(BALANCE_CALIB_AT_BALANCE);
+            HC05_SendString("开始标定，请扶在平衡点保持静止，完成后发送 cal? 查看\r\n");
+            break;
+        case CMD_CAL_LEVEL:
+            Balance_Request_Calibration(BALANCE_CALIB_LEVEL);
+            HC05_SendString("开始标定，请水平静止放置，完成后发送 cal? 查看\r\n");
+            break;
+        case CMD_CAL_MOTOR:
+            // 两路电机依次正反转，约10秒
+            Balance_Request_Calibration(BALANCE_CALIB_FRICTION);
+            HC05_SendString("开始电机摩擦标定，请先把车轮架离地面，完成后发送 cal? 查看\r\n");
+            break;
+        case CMD_CAL_INFO:
+            handle_cal_info();
+            break;
+        case CMD_I2C_INFO:
+            handle_i2c_info();
+            break;
+        case CMD_RATE:
+            handle_rate_set((char*)rx_buf + 5);
+            break;
+        case CMD_RATE_INFO:
+            handle_rate_info();
+            break;
+        case CMD_BAT_INFO:
+            handle_bat_info();
+            break;
+        case CMD_BAT_RESET:
+            Battery_Clear_Cutoff();
+            HC05_SendString("已解除低压断电\r\n");
+            break;
+        case CMD_TELE:
+            handle_tele_set((char*)rx_buf + 5);
+            break;
+        case CMD_TELE_INFO:
+            handle_tele_info();
+            break;
+        case CMD_TX_INFO:
+            handle_tx_info();
+            break;
+        case CMD_BAUD_INFO:
+            handle_baud_info();
+            break;
+        case CMD_BAUD_RESET:
+            // 擦写flash会卡住控制，交给主循环停下电机再写
+            Balance_Request_Flash_Write(HC05_Clear_Baud_Cache);
+            baud_reset_sent = 1;
+            HC05_SendString("开始清除波特率记录（电机暂停），完成后发送 baud? 查看\r\n");
+            break;
+        case CMD_PARAM_GET:
+            handle_param_get((char*)rx_buf + 4);
+            break;
+        case CMD_PARAM_SET:
+            handle_param_set_multi((char*)rx_buf + 4);
+            break;
+        case CMD_PARAM_LIST:
+        case CMD_PARAM_DUMP:
+            param_stream = (uint8_t)cmd;
+            param_next = 0;
+            break;
         default:
             HC05_SendString("未知指令!\r\n支持的指令:\r\n"
                            "  get - 查看当前状态\r\n"
                            "  P <值> - 设置比例系数\r\n"
                            "  I <值> - 设置积分系数\r\n"
                            "  D <值> - 设置微分系数\r\n"
-                           "  T <值> - 设置目标角度\r\n");
+                           "  T <值> - 设置目标角度\r\n"
+                           "  E <0|1> - PID引擎(0浮点,1定点)\r\n"
+                           "  bench - PID耗时测试\r\n"
+                           "  prof [reset] - 热路径耗时统计\r\n"
+                           "  boot - 启动计时\r\n"
+                           "  cal [level] - IMU标定, cal motor - 电机摩擦标定, cal? - 查看\r\n"
+                           "  i2c? - I2C总线错误/恢复统计\r\n"
+                           "  rate <Hz> [低通Hz] - 切换采样/控制频率, rate? - 查看\r\n"
+                           "  bat? - 电池电压, bat reset - 换电池后解除低压断电\r\n"
+                           "  tele <Hz> - 二进制遥测(0关闭), tele? - 发送统计\r\n"
+                           "  tx? - 发送缓冲占用/丢弃统计, baud? - 串口波特率协商结果\r\n"
+                           "  baud reset - 下次上电重新探测波特率\r\n"
+                           "  get/set <参数> [值] - 读写参数, list - 参数表, dump - 导出\r\n");
             break;
     }
 }
 
-// 蓝牙数据接收回调函数
-void HC05_RxCallback(UART_HandleTypeDef *huart) {
-    // 过滤非蓝牙UART中断
+// 开启循环DMA接收（空闲线中断结束一次接收事件）
+static void rx_start(UART_HandleTypeDef *huart) {
+    rx_dma_pos = 0;
+    HAL_UARTEx_ReceiveToIdle_DMA(huart, rx_dma, RX_DMA_SIZE);
+}
+
+// 拼好的一行放入队列；队列满时丢弃（主循环长时间没处理）
+static void rx_push_line(void) {
+    uint8_t head = line_head;
+    if (((head + 1U) & (RX_LINE_NUM - 1U)) != line_tail) {
+        memcpy(rx_lines[head], rx_buf, rx_len);
+        rx_line_len[head] = rx_len;
+        line_head = (head + 1U) & (RX_LINE_NUM - 1U);
+    }
+    rx_len = 0;
+}
+
+// 接收事件（DMA半满/全满或空闲线）：pos为DMA在缓冲区中写到的位置
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t pos) {
     if (huart != hc05_huart) {
         return;
     }
-
-    // 处理接收字符
-    if (rx_temp == '\r' || rx_temp == '\n') {
-        // 收到换行符且缓冲区有数据时解析
-        if (rx_len > 0) {
-            ParseBluetoothCommand(rx_buf, rx_len);
-            // 重置缓冲区
-            rx_len = 0;
-            memset(rx_buf, 0, RX_BUF_SIZE);
-        }
-    } else {
-        // 普通字符存入缓冲区(预留结束符空间)
-        if (rx_len < RX_BUF_SIZE - 1) {
-            rx_buf[rx_len++] = rx_temp;
+    // 全满事件写到了缓冲区末尾，等同于回到开头（半满事件保证不会一次绕过整圈）
+    if (pos >= RX_DMA_SIZE) {
+        pos = 0;
+    }
+    while (rx_dma_pos != pos) {
+        uint8_t c = rx_dma[rx_dma_pos];
+        rx_dma_pos = (rx_dma_pos + 1U) % RX_DMA_SIZE;
+        if (c == '\r' || c == '\n') {
+            // 收到换行符且缓冲区有数据时入队
+            if (rx_len > 0) {
+                rx_push_line();
+            }
         } else {
-            // 缓冲区满时强制解析
-            ParseBluetoothCommand(rx_buf, rx_len);
-            rx_len = 0;
-            memset(rx_buf, 0, RX_BUF_SIZE);
+            rx_buf[rx_len++] = c;
+            // 缓冲区满时强制入队（预留结束符空间）
+            if (rx_len >= RX_BUF_SIZE - 1) {
+                rx_push_line();
+            }
         }
     }
+}
+
+// 串口错误：发送DMA出错时丢掉当前块；溢出错误时HAL已停止接收，重新开启
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+    if (huart != hc05_huart) {
+        return;
+    }
+    Tx_Ring_ErrorCallback(huart);
+    if (huart->RxState == HAL_UART_STATE_READY) {
+        rx_len = 0;
+        rx_start(huart);
+    }
+}
 
-    // 重新开启接收中断
-    HAL_UART_Receive_IT(huart, &rx_temp, 1);
+/**
+ * @brief  解析一条已收到的指令并回复（主循环中调用，每次最多处理一条）
+ */
+void Bluetooth_Debug_Process(void) {
+    uint8_t tail = line_tail;
+    param_stream_step();
+    if (tail == line_head) {
+        return;
+    }
+    ParseBluetoothCommand(rx_lines[tail], rx_line_len[tail]);
+    line_tail = (tail + 1U) & (RX_LINE_NUM - 1U);
 }
 
 // 初始化蓝牙调试功能
 void Bluetooth_Debug_Init(UART_HandleTypeDef *huart) {
     HC05_Init(huart);
-    // 开启UART接收中断
-    HAL_UART_Receive_IT(huart, &rx_temp, 1);
+    // 协商用轮询收AT应答，要在开启DMA接收之前
+    HC05_Negotiate_Baud();
+    Telemetry_Init(huart);
+    // 开启循环DMA接收
+    rx_start(huart);
     // 发送初始化提示
     HC05_SendString("蓝牙调试功能已启动\r\n");
     HC05_SendString("请发送以下指令:\r\n"
@@ -189,5 +718,16 @@ void Bluetooth_Debug_Init(UART_HandleTypeDef *huart) {
                    "  P <值> - 设置PID比例系数\r\n"
                    "  I <值> - 设置PID积分系数\r\n"
                    "  D <值> - 设置PID微分系数\r\n"
-                   "  T <值> - 设置目标平衡角度\r\n");
+                   "  T <值> - 设置目标平衡角度\r\n"
+                   "  E <0|1> - 切换PID引擎(0浮点,1定点)\r\n"
+                   "  bench - 对比浮点/定点PID耗时\r\n"
+                   "  prof - 查看热路径耗时统计(周期), prof reset - 清零\r\n"
+                   "  boot - 查看启动到首次平衡控制的耗时\r\n"
+                   "  cal - 扶在平衡点标定零偏和平衡角, cal level - 水平放置标定零偏\r\n"
+                   "  cal motor - 车轮离地标定电机起转/维持阈值\r\n"
+                   "  cal? - 查看标定结果\r\n"
+                   "  bat? - 查看电池电压和低压断电状态\r\n"
+                   "  tele <Hz> - 开启二进制遥测帧(0关闭), tele? - 查看发送/丢帧统计\r\n"
+                   "  get <参数>, set <参数> <值> ... - 按名称或编号读写参数(同一条指令同时生效)\r\n"
+                   "  list - 参数表和范围, dump - 导出为set指令\r\n");
 }
\ No newline at end of file
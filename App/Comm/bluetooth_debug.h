@@ -14,11 +14,10 @@
 void Bluetooth_Debug_Init(UART_HandleTypeDef *huart);
 
 /**
- * @brief 蓝牙接收数据回调处理函数
- * @param huart: 发生中断的UART句柄
- * @note 需要在UART中断服务程序中调用
+ * @brief 解析并执行一条已收到的指令
+ * @note 在主循环中调用，每次最多处理一条；串口中断里只拼行入队
  */
-void HC05_RxCallback(UART_HandleTypeDef *huart);
+void Bluetooth_Debug_Process(void);
 
 /**
  * @brief 通过蓝牙发送字符串通过蓝牙模块
@@ -1,4 +1,6 @@
 #include "hc05.h"
+#include "Comm/tx_ring.h"
+#include "System/flash_store.h"
 
 // 外部UART句柄引用
 UART_HandleTypeDef *hc05_huart;
@@ -19,6 +21,16 @@ static const struct {
     {460800,  "8"},
     {921600,  "9"},
 };
+#define BAUD_MAP_LEN    (sizeof(baud_rate_map) / sizeof(baud_rate_map[0]))
+
+static HC05_LinkInfoTypeDef link_info;
+
+// flash中的协商记录
+#define BAUD_REC_NO_AT  0x01U   // 上次探测时模块不应答AT
+typedef struct {
+    uint32_t baud;
+    uint32_t flags;
+} HC05_BaudRecordTypeDef;
 /**
  * @brief  向HC05发送数据
  * @param  huart: UART句柄
@@ -35,17 +47,18 @@ static const struct {
 void HC05_Init(UART_HandleTypeDef *huart) {
   hc05_huart = huart;
   __HAL_UART_FLUSH_DRREGISTER(huart);
+  Tx_Ring_Init(huart);
 }
 
 
 /**
- * @brief  发送数据通过蓝牙模块
+ * @brief  发送数据通过蓝牙模块：写入发送环形缓冲后立即返回，由DMA发出（任务和中断中都可调用）
  * @param  data: 要发送的数据
  * @param  len: 数据长度
- * @retval 状态: HC05_OK成功, HC05_ERROR失败
+ * @retval 状态: HC05_OK成功, HC05_ERROR缓冲区满、有数据被丢弃（见Tx_Ring_Get_Stats）
  */
 HC05_StatusTypeDef HC05_SendData(uint8_t *data, uint16_t len) {
-  if (HAL_UART_Transmit(hc05_huart, data, len, 100) == HAL_OK) {
+  if (Tx_Ring_Write(data, len) == len) {
     return HC05_OK;
   }
   return HC05_ERROR;
@@ -66,6 +79,29 @@ HC05_StatusTypeDef HC05_ReceiveData(uint8_t *data, uint16_t max_len, uint32_t ti
 }
 
 
+// 接收AT应答：收到第一个字节后，超过HC05_AT_GAP_MS没有新字节即认为应答结束
+// （应答长度不定，不能等满整个缓冲区）；串口正在DMA接收时直接返回0
+static uint16_t at_receive(char *response, uint16_t max_len, uint32_t timeout) {
+    uint32_t start = HAL_GetTick();
+    uint16_t n = 0;
+
+    while (n < max_len) {
+        uint32_t wait = HC05_AT_GAP_MS;
+        if (n == 0) {
+            uint32_t elapsed = HAL_GetTick() - start;
+            if (elapsed >= timeout) {
+                break;
+            }
+            wait = timeout - elapsed;
+        }
+        if (HAL_UART_Receive(hc05_huart, (uint8_t*)&response[n], 1, wait) != HAL_OK) {
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
 /**
  * @brief  发送AT指令并获取响应
  * @param  cmd: AT指令
@@ -82,13 +118,14 @@ HC05_StatusTypeDef HC05_SendATCommand(const char *cmd, char *response, uint16_t
     // 清空响应缓冲区
     memset(response, 0, resp_len);
 
-    // 发送AT指令
-    if (HAL_UART_Transmit(hc05_huart, (uint8_t*)cmd, strlen(cmd), 1000) != HAL_OK) {
+    // 丢掉残留的接收字节，发送AT指令，等它（和之前排队的输出）发完再收回复
+    __HAL_UART_FLUSH_DRREGISTER(hc05_huart);
+    if (HC05_SendData((uint8_t*)cmd, strlen(cmd)) != HC05_OK || Tx_Ring_Flush(1000) != 0) {
         return HC05_ERROR;
     }
 
     // 等待响应
-    if (HAL_UART_Receive(hc05_huart, (uint8_t*)response, resp_len-1, timeout) != HAL_OK) {
+    if (at_receive(response, resp_len - 1, timeout) == 0) {
         return HC05_TIMEOUT;
     }
 
@@ -213,3 +250,173 @@ HC05_StatusTypeDef HC05_Reset(void) {
     char response[32];
     return HC05_SendATCommand("AT+RESET\r\n", response, sizeof(response), 2000);
 }
+
+// 波特率在映射表中的序号，-1=不支持
+static int8_t baud_index(uint32_t baud) {
+    for (uint8_t i = 0; i < BAUD_MAP_LEN; i++) {
+        if (baud_rate_map[i].baud == baud) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+// 切换本机串口波特率（先等发送缓冲发完）
+static int uart_set_baud(uint32_t baud) {
+    if (Tx_Ring_Flush(1000) != 0) {
+        return -1;
+    }
+    hc05_huart->Init.BaudRate = baud;
+    if (HAL_UART_Init(hc05_huart) != HAL_OK) {
+        return -1;
+    }
+    __HAL_UART_FLUSH_DRREGISTER(hc05_huart);
+    link_info.baud = baud;
+    return 0;
+}
+
+// 当前波特率下模块连续应答count次AT
+static uint8_t at_verify(uint8_t count) {
+    char response[16];
+
+    while (count--) {
+        if (HC05_SendATCommand("AT\r\n", response, sizeof(response), HC05_AT_PING_MS) != HC05_OK) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 逐个波特率探测模块：先试出厂默认，再从高到低
+// 返回模块应答的波特率（串口停在该波特率），0=都没有应答
+static uint32_t probe_baud(void) {
+    if (uart_set_baud(HC05_BAUD_DEFAULT) == 0 && at_verify(1)) {
+        return HC05_BAUD_DEFAULT;
+    }
+    for (int8_t i = BAUD_MAP_LEN - 1; i >= 0; i--) {
+        uint32_t baud = baud_rate_map[i].baud;
+        if (baud != HC05_BAUD_DEFAULT && uart_set_baud(baud) == 0 && at_verify(1)) {
+            return baud;
+        }
+    }
+    return 0;
+}
+
+// 把模块和串口从from升到to并验证
+// 返回 0=成功，1=模块拒绝或验证失败、已回到from，-1=和模块失去联系
+static int try_upgrade(uint32_t from, uint32_t to) {
+    // 应答丢了但模块还在原波特率，说明没有切换
+    if (HC05_SetBaudRate(to) != HC05_OK && at_verify(1)) {
+        return 1;
+    }
+    HAL_Delay(HC05_BAUD_SWITCH_MS);
+    if (uart_set_baud(to) == 0 && at_verify(HC05_BAUD_VERIFY)) {
+        return 0;
+    }
+    // 新波特率不可靠：在新波特率下尽量把模块改回去
+    link_info.failed++;
+    HC05_SetBaudRate(from);
+    HAL_Delay(HC05_BAUD_SWITCH_MS);
+    if (uart_set_baud(from) == 0 && at_verify(1)) {
+        return 1;
+    }
+    return -1;
+}
+
+/**
+ * @brief  启动时协商串口波特率（HC05_Init之后、开启DMA接收之前调用，阻塞几十毫秒到数秒）
+ * @retval 状态: HC05_OK成功, HC05_TIMEOUT模块无应答或已记录为不应答（沿用缓存或出厂波特率）,
+ *         HC05_ERROR升级中失去联系且重新探测不到（回到出厂波特率）
+ */
+HC05_StatusTypeDef HC05_Negotiate_Baud(void) {
+    uint32_t start = HAL_GetTick();
+    HC05_BaudRecordTypeDef rec = {0};
+    uint32_t cached;
+    uint32_t baud;
+    HC05_StatusTypeDef status = HC05_OK;
+
+    if (hc05_huart == NULL) {
+        return HC05_ERROR;
+    }
+    link_info = (HC05_LinkInfoTypeDef){0};
+    link_info.baud = hc05_huart->Init.BaudRate;
+    if (Flash_Store_Read(FLASH_TAG_HC05_BAUD, &rec, sizeof(rec)) != (int)sizeof(rec) ||
+        baud_index(rec.baud) < 0) {
+        rec = (HC05_BaudRecordTypeDef){0};
+    }
+    cached = rec.baud;
+
+    // 上次模块不应答AT：直接用记录的波特率，不再发AT（否则会被透传给已连接的手机）
+    if (cached != 0 && (rec.flags & BAUD_REC_NO_AT)) {
+        uart_set_baud(cached);
+        link_info.from_cache = 1;
+        link_info.no_at = 1;
+        link_info.elapsed_ms = HAL_GetTick() - start;
+        return HC05_TIMEOUT;
+    }
+
+    // 缓存的波特率能应答就直接使用，跳过探测和升级
+    if (cached != 0 && uart_set_baud(cached) == 0 && at_verify(1)) {
+        link_info.from_cache = 1;
+        link_info.found_baud = cached;
+        link_info.elapsed_ms = HAL_GetTick() - start;
+        return HC05_OK;
+    }
+
+    baud = probe_baud();
+    link_info.found_baud = baud;
+    if (baud == 0) {
+        rec.baud = cached != 0 ? cached : HC05_BAUD_DEFAULT;
+        rec.flags = BAUD_REC_NO_AT;
+        uart_set_baud(rec.baud);
+        Flash_Store_Write(FLASH_TAG_HC05_BAUD, &rec, sizeof(rec));
+        link_info.elapsed_ms = HAL_GetTick() - start;
+        return HC05_TIMEOUT;
+    }
+
+    // 从上限往下尝试，第一个验证通过的就是结果
+    for (int8_t i = BAUD_MAP_LEN - 1; i >= 0 && baud_rate_map[i].baud > baud; i--) {
+        if (baud_rate_map[i].baud > HC05_BAUD_MAX) {
+            continue;
+        }
+        int ret = try_upgrade(baud, baud_rate_map[i].baud);
+        if (ret == 0) {
+            baud = baud_rate_map[i].baud;
+            break;
+        }
+        if (ret < 0) {
+            // 不知道模块停在哪个波特率，重新探测，不再升级
+            baud = probe_baud();
+            if (baud == 0) {
+                uart_set_baud(HC05_BAUD_DEFAULT);
+                status = HC05_ERROR;
+            }
+            break;
+        }
+    }
+
+    if (baud != 0) {
+        // 内容没变时Flash_Store_Write不会擦写
+        rec.baud = baud;
+        rec.flags = 0;
+        Flash_Store_Write(FLASH_TAG_HC05_BAUD, &rec, sizeof(rec));
+    }
+    link_info.elapsed_ms = HAL_GetTick() - start;
+    return status;
+}
+
+/**
+ * @brief  清除缓存的协商结果，下次上电重新完整探测（模块切到AT模式或更换模块后使用）
+ * @retval 0=成功，其余为ERROR_FLASH_*错误码
+ */
+int HC05_Clear_Baud_Cache(void) {
+    HC05_BaudRecordTypeDef rec = {0};
+    return Flash_Store_Write(FLASH_TAG_HC05_BAUD, &rec, sizeof(rec));
+}
+
+/**
+ * @brief  获取上次波特率协商的结果
+ */
+const HC05_LinkInfoTypeDef *HC05_Get_Link_Info(void) {
+    return &link_info;
+}
@@ -28,6 +28,28 @@ typedef enum {
   HC05_NOT_CONNECTED
 } HC05_StatusTypeDef;
 
+// 启动时波特率协商：先用flash里缓存的波特率发一次AT确认，对不上再逐个波特率探测模块，
+// 然后从HC05_BAUD_MAX往下尝试把模块和串口一起升上去，新波特率下连续应答
+// HC05_BAUD_VERIFY次才算可靠，否则把模块改回原波特率；结果写入flash，下次上电直接使用
+// 模块不在AT模式或已被手机连接时AT指令会被透传、收不到应答，此时沿用缓存（或默认）波特率，
+// 并把“无应答”记入flash：之后上电直接使用该波特率、不再发AT，直到HC05_Clear_Baud_Cache
+#define HC05_BAUD_DEFAULT   9600U   // 模块出厂波特率，与CubeMX中USART2一致
+#define HC05_BAUD_MAX       460800U // 升级上限（USART2在36MHz下误差0.16%）
+#define HC05_BAUD_VERIFY    4U      // 新波特率下要求连续应答的次数
+#define HC05_AT_PING_MS     100U    // 探测时等待AT应答的时间
+#define HC05_AT_GAP_MS      20U     // 应答字节间隔超过该时间视为应答结束
+#define HC05_BAUD_SWITCH_MS 100U    // 模块应答改波特率后切换所需时间
+
+// 协商结果
+typedef struct {
+  uint32_t baud;          // 当前串口波特率
+  uint32_t found_baud;    // 探测到模块时的波特率，0=未应答
+  uint8_t from_cache;     // 1=直接使用了缓存波特率，跳过了探测
+  uint8_t no_at;          // 1=缓存记录模块不应答AT，本次没有发AT
+  uint8_t failed;         // 升级失败（验证不通过）的次数
+  uint32_t elapsed_ms;    // 协商耗时
+} HC05_LinkInfoTypeDef;
+
 // 函数声明
 void HC05_Init(UART_HandleTypeDef *huart);
 HC05_StatusTypeDef HC05_SendData(uint8_t *data, uint16_t len);
@@ -39,4 +61,7 @@ HC05_StatusTypeDef HC05_SetPin(const char *pin);
 HC05_StatusTypeDef HC05_SetBaudRate(uint32_t baud_rate);
 HC05_StatusTypeDef HC05_SetRole(uint8_t role);
 HC05_StatusTypeDef HC05_Reset(void);
+HC05_StatusTypeDef HC05_Negotiate_Baud(void);
+const HC05_LinkInfoTypeDef *HC05_Get_Link_Info(void);
+int HC05_Clear_Baud_Cache(void);
 #endif //TWIGO_HC05_H
\ No newline at end of file
@@ -26,8 +26,10 @@
 #include <math.h>
 #include <stdlib.h>
 #include <pin_definitions.h>
+#include "System/i2c_bus.h"
 // OLED器件地址
 #define OLED_ADDRESS 0x78
+#define OLED_SEND_TIMEOUT_MS 50
 
 // OLED参数
 #define OLED_PAGE 8            // OLED页数
@@ -48,7 +50,8 @@ uint8_t OLED_GRAM[OLED_PAGE][OLED_COLUMN];
  */
 void OLED_Send(uint8_t *data, uint8_t len)
 {
-  HAL_I2C_Master_Transmit(&hi2c1, OLED_ADDRESS, data, len, HAL_MAX_DELAY);
+  // 255字节@100kHz约23ms；总线卡死时由总线层恢复，不再无限等待
+  I2C_Bus_Transmit(&hi2c1, OLED_ADDRESS, data, len, OLED_SEND_TIMEOUT_MS);
 }
 
 /**
@@ -0,0 +1,90 @@
+#include "Comm/telemetry.h"
+#include "Math/crc16.h"
+#include "Comm/tx_ring.h"
+#include <string.h>
+
+static UART_HandleTypeDef *tele_huart;
+static uint16_t rate_hz;                // 0=关闭
+static uint32_t due_acc;                // 分频累加器
+static uint8_t seq;
+static Telemetry_StatsTypeDef stats;
+
+/**
+ * @brief  绑定遥测使用的串口（与蓝牙调试同一个UART，经Tx_Ring发送），默认关闭
+ */
+void Telemetry_Init(UART_HandleTypeDef *huart) {
+  tele_huart = huart;
+  rate_hz = 0;
+}
+
+/**
+ * @brief  设置遥测帧率
+ * @param  hz: 每秒帧数，0=关闭；超过控制频率时每个控制周期一帧
+ */
+void Telemetry_Set_Rate(uint16_t hz) {
+  rate_hz = hz;
+  due_acc = 0;
+}
+
+uint16_t Telemetry_Get_Rate(void) {
+  return rate_hz;
+}
+
+/**
+ * @brief  当前波特率下链路每秒最多能发的帧数（每字节10位）
+ */
+uint16_t Telemetry_Get_Link_Max(void) {
+  if (tele_huart == NULL) return 0;
+  return (uint16_t)(tele_huart->Init.BaudRate / 10U / TELEMETRY_FRAME_MAX);
+}
+
+/**
+ * @brief  本控制周期是否该发一帧（小数分频，每个控制周期调用一次）
+ * @param  control_hz: 控制频率
+ * @retval 1=该发，调用者再去打包记录，避免每个周期都做浮点换算
+ */
+uint8_t Telemetry_Due(uint16_t control_hz) {
+  if (rate_hz == 0 || tele_huart == NULL || control_hz == 0) return 0;
+  due_acc += rate_hz;
+  if (due_acc < control_hz) return 0;
+  due_acc = (due_acc >= 2U * control_hz) ? 0 : due_acc - control_hz;
+  return 1;
+}
+
+/**
+ * @brief  打包一条记录写入发送缓冲，立即返回（主循环中调用）
+ * @param  rec: 记录，type和seq由这里填写
+ */
+void Telemetry_Send(Telemetry_ControlTypeDef *rec) {
+  uint8_t raw[sizeof(Telemetry_ControlTypeDef) + 2U];
+  uint8_t frame[TELEMETRY_FRAME_MAX];
+  uint16_t crc, len;
+
+  if (tele_huart == NULL) return;
+  rec->type = TELEMETRY_TYPE_CONTROL;
+  rec->seq = seq++;
+  if (Tx_Ring_Used() + TELEMETRY_FRAME_MAX > TELEMETRY_TX_BACKLOG) {
+    stats.dropped++;
+    return;
+  }
+  memcpy(raw, rec, sizeof(*rec));
+  crc = crc16_update(CRC16_INIT, raw, sizeof(*rec));
+  raw[sizeof(*rec)] = (uint8_t)crc;
+  raw[sizeof(*rec) + 1U] = (uint8_t)(crc >> 8);
+
+  frame[0] = 0x00;
+  len = (uint16_t)(cobs_encode(raw, sizeof(raw), frame + 1) + 2U);
+  frame[len - 1U] = 0x00;
+  if (Tx_Ring_Write(frame, len) == len) {
+    stats.sent++;
+  } else {
+    stats.dropped++;
+  }
+}
+
+/**
+ * @brief  获取发送统计
+ */
+const Telemetry_StatsTypeDef *Telemetry_Get_Stats(void) {
+  return &stats;
+}
@@ -0,0 +1,53 @@
+#ifndef TWIGO_TELEMETRY_H
+#define TWIGO_TELEMETRY_H
+
+#include "stm32f1xx_hal.h"
+#include "Math/cobs.h"
+
+// 二进制遥测：控制周期里把状态打包成定长记录，加CRC16后COBS编码，写入串口发送环形缓冲由DMA发出，
+// 不占CPU等待；帧格式 0x00 | COBS(记录 + CRC16小端) | 0x00，
+// 前后都有分隔符，和文本回复混在同一串口里时也能各自分开
+// 发送缓冲里积压超过TELEMETRY_TX_BACKLOG时整帧丢弃：链路跑不满时不积累延迟，也给文本回复留出空间
+#define TELEMETRY_TYPE_CONTROL  0x01    // 控制周期记录
+
+// 记录flags
+#define TELEMETRY_FLAG_BATTERY  0x03    // 低2位：Battery_StateTypeDef
+#define TELEMETRY_FLAG_FIXED    0x04    // 平衡环使用定点PID引擎
+#define TELEMETRY_FLAG_FRICTION 0x08    // 使用了电机摩擦标定补偿
+
+// 控制周期记录（小端，31字节）
+typedef struct __attribute__((packed)) {
+  uint8_t type;         // TELEMETRY_TYPE_CONTROL
+  uint8_t seq;          // 每生成一条记录加1，接收端据此统计丢帧
+  uint32_t t_us;        // 姿态样本INT时刻（us，约71分钟回绕）
+  int16_t pitch;        // 俯仰角，0.01°
+  int16_t rate;         // 俯仰角速度（PID微分项滤波后），0.1°/s
+  int16_t p;            // PID比例项，0.01%
+  int16_t i;            // PID积分项，0.01%
+  int16_t d;            // PID微分项，0.01%
+  int16_t duty_a;       // 电机A比较值（带符号，电压补偿前）
+  int16_t duty_b;       // 电机B比较值
+  int32_t enc_left;     // 左编码器累计计数
+  int32_t enc_right;    // 右编码器累计计数
+  uint16_t vbat_mv;     // 电池电压
+  uint8_t flags;        // TELEMETRY_FLAG_*
+} Telemetry_ControlTypeDef;
+
+#define TELEMETRY_FRAME_MAX     (COBS_MAX_ENCODED(sizeof(Telemetry_ControlTypeDef) + 2U) + 2U)
+#define TELEMETRY_TX_BACKLOG    (2U * TELEMETRY_FRAME_MAX)  // 入队后发送缓冲的积压上限
+
+// 统计
+typedef struct {
+  uint32_t sent;        // 写入发送缓冲的帧
+  uint32_t dropped;     // 发送缓冲积压过多而丢掉的帧
+} Telemetry_StatsTypeDef;
+
+void Telemetry_Init(UART_HandleTypeDef *huart);
+void Telemetry_Set_Rate(uint16_t hz);
+uint16_t Telemetry_Get_Rate(void);
+uint16_t Telemetry_Get_Link_Max(void);
+uint8_t Telemetry_Due(uint16_t control_hz);
+void Telemetry_Send(Telemetry_ControlTypeDef *rec);
+const Telemetry_StatsTypeDef *Telemetry_Get_Stats(void);
+
+#endif //TWIGO_TELEMETRY_H
@@ -0,0 +1,170 @@
+#include "Comm/tx_ring.h"
+#include <string.h>
+
+static UART_HandleTypeDef *tx_huart;
+static uint8_t ring[TX_RING_SIZE];
+static uint8_t chunk[TX_RING_CHUNK];    // 正在DMA发送的块
+static volatile uint16_t head;          // 写入位置（自由计数，取模用掩码）
+static volatile uint16_t tail;          // 下一块的起始位置
+static volatile uint8_t busy;           // DMA发送中（或正在取块）
+static volatile uint16_t claimed;       // 正在拷到发送块、尚未移出环形区的字节
+static Tx_Ring_StatsTypeDef stats;
+
+// 临界区：写入方可能在任务或中断中，和DMA完成中断之间只做下标更新和不超过一块的拷贝，
+// 关中断时间与写入长度无关
+#define TX_RING_LOCK()      uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define TX_RING_UNLOCK()    __set_PRIMASK(primask)
+
+// 取下一块交给DMA（不要在临界区内调用）
+// 临界区里只认领块（置busy、记下claimed），拷贝在临界区外做：写入方不会覆盖已认领的数据
+static void tx_kick(void) {
+  uint16_t start, n, first;
+
+  {
+    TX_RING_LOCK();
+    uint16_t used = (uint16_t)(head - tail);
+    if (busy || used == 0 || tx_huart == NULL) {
+      TX_RING_UNLOCK();
+      return;
+    }
+    n = used < TX_RING_CHUNK ? used : TX_RING_CHUNK;
+    start = tail;
+    busy = 1;
+    claimed = n;
+    TX_RING_UNLOCK();
+  }
+  first = (uint16_t)(TX_RING_SIZE - (start & (TX_RING_SIZE - 1U)));
+  if (first > n) first = n;
+  memcpy(chunk, &ring[start & (TX_RING_SIZE - 1U)], first);
+  memcpy(chunk + first, ring, n - first);
+  {
+    TX_RING_LOCK();
+    tail = (uint16_t)(start + n);
+    claimed = 0;
+    TX_RING_UNLOCK();
+  }
+  if (HAL_UART_Transmit_DMA(tx_huart, chunk, n) != HAL_OK) {
+    stats.dma_errors++;
+    busy = 0;
+  }
+}
+
+/**
+ * @brief  绑定发送用的串口（需已配置TX DMA），清空缓冲区
+ */
+void Tx_Ring_Init(UART_HandleTypeDef *huart) {
+  TX_RING_LOCK();
+  tx_huart = huart;
+  head = tail = 0;
+  busy = 0;
+  claimed = 0;
+  TX_RING_UNLOCK();
+}
+
+/**
+ * @brief  写入待发送数据，立即返回（任务和中断中都可调用）
+ * @param  data: 数据
+ * @param  len: 字节数
+ * @retval 实际写入的字节数；DROP_NEW时写不下的部分被丢弃
+ * @note   按TX_RING_CHUNK分段拷贝，每段单独进临界区；不同优先级的写入方同时写时
+ *         数据可能在段边界处交错
+ */
+uint16_t Tx_Ring_Write(const uint8_t *data, uint16_t len) {
+  uint16_t done = 0;
+  uint16_t skipped = 0;
+
+  if (tx_huart == NULL || len == 0) return 0;
+  if (TX_RING_POLICY == TX_RING_DROP_OLDEST && len > TX_RING_SIZE) {
+    // 比整个缓冲区还长，只留最后一段
+    skipped = (uint16_t)(len - TX_RING_SIZE);
+    data += skipped;
+    len = TX_RING_SIZE;
+  }
+  while (done < len) {
+    uint16_t n = (uint16_t)(len - done);
+    uint16_t used, space, first, pos;
+
+    if (n > TX_RING_CHUNK) n = TX_RING_CHUNK;
+    TX_RING_LOCK();
+    stats.dropped += skipped;
+    skipped = 0;
+    used = (uint16_t)(head - tail);
+    space = (uint16_t)(TX_RING_SIZE - used);
+    if (n > space) {
+      if (TX_RING_POLICY == TX_RING_DROP_OLDEST && claimed == 0) {
+        tail = (uint16_t)(tail + (n - space));
+        stats.dropped += n - space;
+        used = (uint16_t)(used - (n - space));
+      } else {
+        // DROP_NEW，或最早的数据正被拷去发送、挤不掉：余下的都丢弃
+        stats.dropped += (uint16_t)(len - done) - space;
+        len = (uint16_t)(done + space);
+        n = space;
+      }
+    }
+    pos = head & (TX_RING_SIZE - 1U);
+    first = (uint16_t)(TX_RING_SIZE - pos);
+    if (first > n) first = n;
+    memcpy(&ring[pos], data + done, first);
+    memcpy(ring, data + done + first, n - first);
+    head = (uint16_t)(head + n);
+    stats.written += n;
+    used = (uint16_t)(used + n);
+    if (used > stats.high_water) {
+      stats.high_water = used;
+    }
+    TX_RING_UNLOCK();
+    done = (uint16_t)(done + n);
+  }
+  tx_kick();
+  return done;
+}
+
+/**
+ * @brief  环形区中尚未交给DMA的字节数
+ */
+uint16_t Tx_Ring_Used(void) {
+  return (uint16_t)(head - tail);
+}
+
+/**
+ * @brief  等待全部数据发完（只能在任务上下文调用，如AT指令等回复之前）
+ * @param  timeout_ms: 超时时间
+ * @retval 0=已发完，-1=超时
+ */
+int Tx_Ring_Flush(uint32_t timeout_ms) {
+  uint32_t start = HAL_GetTick();
+
+  while (busy || head != tail) {
+    if (HAL_GetTick() - start >= timeout_ms) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief  获取发送统计
+ */
+const Tx_Ring_StatsTypeDef *Tx_Ring_Get_Stats(void) {
+  return &stats;
+}
+
+/**
+ * @brief  串口错误回调中调用：发送DMA出错时丢掉当前块，继续发后面的数据
+ */
+void Tx_Ring_ErrorCallback(UART_HandleTypeDef *huart) {
+  if (huart != tx_huart || !busy) return;
+  if ((huart->ErrorCode & HAL_UART_ERROR_DMA) && huart->gState == HAL_UART_STATE_READY) {
+    stats.dma_errors++;
+    busy = 0;
+    tx_kick();
+  }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  if (huart != tx_huart) return;
+  // 更高优先级的中断也可能在写入，tx_kick里认领下一块时进临界区
+  busy = 0;
+  tx_kick();
+}
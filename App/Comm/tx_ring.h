@@ -0,0 +1,35 @@
+#ifndef TWIGO_TX_RING_H
+#define TWIGO_TX_RING_H
+
+#include "stm32f1xx_hal.h"
+
+// 串口发送环形缓冲：任务和中断里都可以写入，写完立即返回；
+// DMA每次从环形区取一块拷到发送块缓冲区再发，环形区马上腾出空间，
+// 一块发完在完成中断里接着发下一块，直到缓冲区空
+#define TX_RING_SIZE        1024U   // 环形区字节数（2的幂），9600波特下约1秒的数据
+#define TX_RING_CHUNK       64U     // 每次DMA最多发送的字节
+
+// 写不下时的处理
+typedef enum {
+  TX_RING_DROP_NEW = 0,     // 丢弃写不下的新数据（已排队的输出保持完整）
+  TX_RING_DROP_OLDEST       // 挤掉最早排队、尚未发送的数据（总是保留最新输出）
+} Tx_Ring_PolicyTypeDef;
+
+#define TX_RING_POLICY      TX_RING_DROP_NEW
+
+// 统计
+typedef struct {
+  uint32_t written;         // 写入环形区的字节
+  uint32_t dropped;         // 丢弃的字节（按TX_RING_POLICY）
+  uint32_t dma_errors;      // DMA启动失败或传输出错（该块数据丢失）
+  uint16_t high_water;      // 环形区最高占用
+} Tx_Ring_StatsTypeDef;
+
+void Tx_Ring_Init(UART_HandleTypeDef *huart);
+uint16_t Tx_Ring_Write(const uint8_t *data, uint16_t len);
+uint16_t Tx_Ring_Used(void);
+int Tx_Ring_Flush(uint32_t timeout_ms);
+const Tx_Ring_StatsTypeDef *Tx_Ring_Get_Stats(void);
+void Tx_Ring_ErrorCallback(UART_HandleTypeDef *huart);
+
+#endif //TWIGO_TX_RING_H
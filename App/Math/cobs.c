@@ -0,0 +1,23 @@
+#include "Math/cobs.h"
+
+uint16_t cobs_encode(const uint8_t *src, uint16_t len, uint8_t *dst) {
+  uint16_t code_pos = 0;    // 当前段的长度字节位置
+  uint16_t out = 1;
+  uint8_t code = 1;         // 当前段长度+1
+
+  while (len--) {
+    uint8_t b = *src++;
+    if (b != 0) {
+      dst[out++] = b;
+      code++;
+    }
+    // 遇到0或段满254个非零字节时结束当前段
+    if (b == 0 || code == 0xFF) {
+      dst[code_pos] = code;
+      code_pos = out++;
+      code = 1;
+    }
+  }
+  dst[code_pos] = code;
+  return out;
+}
@@ -0,0 +1,19 @@
+#ifndef TWIGO_COBS_H
+#define TWIGO_COBS_H
+
+#include <stdint.h>
+
+// COBS（Consistent Overhead Byte Stuffing）：编码后数据中不含0x00，0x00留作帧分隔符，
+// 接收端从任意位置开始都能在下一个0x00处重新对齐；开销每254字节最多1字节
+#define COBS_MAX_ENCODED(len)   ((len) + (len) / 254U + 1U)
+
+/**
+ * @brief  COBS编码（不含结尾的0x00分隔符）
+ * @param  src: 原始数据
+ * @param  len: 原始字节数
+ * @param  dst: 输出缓冲区，至少COBS_MAX_ENCODED(len)字节，不能与src重叠
+ * @retval 编码后的字节数
+ */
+uint16_t cobs_encode(const uint8_t *src, uint16_t len, uint8_t *dst);
+
+#endif //TWIGO_COBS_H
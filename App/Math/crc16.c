@@ -0,0 +1,16 @@
+#include "Math/crc16.h"
+
+// 半字节查表：16项表只占32字节Flash，速度约为逐位计算的4倍
+static const uint16_t crc16_nibble[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t len) {
+  while (len--) {
+    uint8_t b = *data++;
+    crc = (uint16_t)((crc << 4) ^ crc16_nibble[(crc >> 12) ^ (b >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ crc16_nibble[(crc >> 12) ^ (b & 0x0F)]);
+  }
+  return crc;
+}
@@ -0,0 +1,18 @@
+#ifndef TWIGO_CRC16_H
+#define TWIGO_CRC16_H
+
+#include <stdint.h>
+
+// CRC-16/CCITT-FALSE：多项式0x1021，初值0xFFFF，不反转，无异或输出
+#define CRC16_INIT  0xFFFFu
+
+/**
+ * @brief  累加计算CRC16，可分段调用（首段传CRC16_INIT）
+ * @param  crc: 上一段的结果
+ * @param  data: 数据
+ * @param  len: 字节数
+ * @retval 新的CRC值
+ */
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t len);
+
+#endif //TWIGO_CRC16_H
@@ -0,0 +1,73 @@
+#include "Math/fast_math.h"
+#include <math.h>
+
+/**
+ * @brief  反正弦（Abramowitz & Stegun 4.4.45）
+ * @param  x: 输入，超出[-1,1]时截断
+ * @retval 弧度，误差 <= 7e-5 rad
+ */
+float fast_asinf(float x) {
+  float ax = fast_fabsf(x);
+  if (ax > 1.0f) ax = 1.0f;
+
+  float p = 1.5707288f + ax * (-0.2121144f + ax * (0.0742610f + ax * -0.0187293f));
+  float r = FAST_HALF_PI - sqrtf(1.0f - ax) * p;
+  return (x < 0.0f) ? -r : r;
+}
+
+/**
+ * @brief  四象限反正切（|z|<=1区间上的11阶极小化多项式）
+ * @param  y: 纵坐标
+ * @param  x: 横坐标
+ * @retval 弧度[-pi, pi]，误差 <= 2e-6 rad
+ */
+float fast_atan2f(float y, float x) {
+  float ax = fast_fabsf(x);
+  float ay = fast_fabsf(y);
+  if (ax == 0.0f && ay == 0.0f) {
+    return 0.0f;
+  }
+
+  // 折叠到|z|<=1，只做一次除法
+  uint8_t swap = ay > ax;
+  float z = swap ? (ax / ay) : (ay / ax);
+  float z2 = z * z;
+  float r = z * (0.99997726f + z2 * (-0.33262347f + z2 * (0.19354346f +
+            z2 * (-0.11643287f + z2 * (0.05265332f + z2 * -0.01172120f)))));
+
+  if (swap) r = FAST_HALF_PI - r;
+  if (x < 0.0f) r = FAST_PI - r;
+  return (y < 0.0f) ? -r : r;
+}
+
+/**
+ * @brief  定点四象限反正切（系数同fast_atan2f，Q15）
+ * @param  y: 纵坐标，|y| < 2^16
+ * @param  x: 横坐标，|x| < 2^16
+ * @retval Q16.16角度[-180, 180]（按FAST_RAD_TO_DEG换算）
+ */
+int32_t fast_atan2_deg_q16(int32_t y, int32_t x) {
+  int32_t ax = (x < 0) ? -x : x;
+  int32_t ay = (y < 0) ? -y : y;
+  if (ax == 0 && ay == 0) {
+    return 0;
+  }
+
+  // 折叠到|z|<=1，z为Q15
+  uint8_t swap = ay > ax;
+  int32_t z = swap ? ((ax << 15) / ay) : ((ay << 15) / ax);
+  int32_t z2 = (z * z) >> 15;
+  int32_t p = -384;
+  p = 1725 + ((p * z2) >> 15);
+  p = -3815 + ((p * z2) >> 15);
+  p = 6342 + ((p * z2) >> 15);
+  p = -10899 + ((p * z2) >> 15);
+  p = 32767 + ((p * z2) >> 15);
+  int32_t r = (p * z) >> 15;                  // 弧度，Q15
+
+  if (swap) r = 51472 - r;                    // pi/2
+  if (x < 0) r = 102944 - r;                  // pi
+  if (y < 0) r = -r;
+  // 弧度Q15 -> 角度Q16：乘以 FAST_RAD_TO_DEG * 2
+  return (int32_t)(((int64_t)r * (int32_t)(FAST_RAD_TO_DEG * 131072.0f)) >> 16);
+}
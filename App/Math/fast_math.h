@@ -0,0 +1,36 @@
+#ifndef TWIGO_FAST_MATH_H
+#define TWIGO_FAST_MATH_H
+
+#include <stdint.h>
+
+// 纯单精度快速数学函数（M3无FPU，避免double软件运算）
+#define FAST_PI         3.14159265f
+#define FAST_HALF_PI    1.57079633f
+#define FAST_RAD_TO_DEG 57.3f   // 与原姿态解算一致，平衡目标角度按此标定
+
+/**
+ * @brief  单精度绝对值（清符号位，无函数调用）
+ */
+static inline float fast_fabsf(float x) {
+  union { float f; uint32_t u; } v = { x };
+  v.u &= 0x7FFFFFFFu;
+  return v.f;
+}
+
+/**
+ * @brief  反正弦，输入限制在[-1,1]，最大误差约7e-5 rad
+ */
+float fast_asinf(float x);
+
+/**
+ * @brief  四象限反正切，最大误差约2e-6 rad
+ */
+float fast_atan2f(float y, float x);
+
+/**
+ * @brief  定点四象限反正切，输入为整数坐标（如加速度计LSB），
+ *         输出Q16.16角度（按FAST_RAD_TO_DEG换算），误差约0.01度
+ */
+int32_t fast_atan2_deg_q16(int32_t y, int32_t x);
+
+#endif //TWIGO_FAST_MATH_H
@@ -1,4 +1,5 @@
 #include "tb6612.h"
+#include "Math/fast_math.h"
 
 // 外部引用定时器句柄
 #define TB6612_PWM_TIM MOTOR_PWM_TIM
@@ -7,6 +8,20 @@
 uint16_t current_speed_a = 0;
 uint16_t current_speed_b = 0;
 
+// 后台斜坡（TIM1更新中断中推进）
+static volatile TB6612_RampTypeDef ramp[2];
+static uint16_t ramp_div_reload = 1;    // 每TB6612_RAMP_HZ一拍对应的PWM周期数
+static volatile uint16_t ramp_div = 1;
+
+// 电源电压补偿系数（Q12，TB6612_Set_Supply更新）
+static volatile uint16_t supply_scale = TB6612_SUPPLY_SCALE_ONE;
+
+// 摩擦补偿表（标定后由TB6612_Set_Friction装入）
+static TB6612_FrictionTypeDef friction[2];
+static uint8_t friction_valid[2];
+
+static void motor_apply(TB6612_MotorTypeDef motor, int32_t duty);
+
 /**
  * @brief  初始化TB6612电机驱动
  * @retval 无
@@ -23,6 +38,12 @@ void TB6612_Init(void) {
     // 设置初始速度为0
     TB6612_SetSpeed(TB6612_MOTOR_A, 0);
     TB6612_SetSpeed(TB6612_MOTOR_B, 0);
+
+    // 斜坡分频：PWM频率 / 斜坡频率，更新中断只在斜坡进行时打开
+    uint32_t pwm_hz = SystemCoreClock / (((TB6612_PWM_TIM)->Instance->PSC + 1U) * TB6612_PWM_MAX);
+    ramp_div_reload = (uint16_t)(pwm_hz > TB6612_RAMP_HZ ? pwm_hz / TB6612_RAMP_HZ : 1U);
+    HAL_NVIC_SetPriority(TIM1_UP_IRQn, TB6612_RAMP_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(TIM1_UP_IRQn);
 }
 
 /**
@@ -88,71 +109,174 @@ void TB6612_SetSpeed(TB6612_MotorTypeDef motor, uint16_t speed) {
 }
 
 /**
- * @brief  平滑加速
+ * @brief  设置带符号的占空比（方向+比较值一次完成）
+ * @param  motor: 电机编号
+ * @param  duty: 比较值 (-TB6612_PWM_MAX ~ TB6612_PWM_MAX)，正数正转，负数反转，0停止
+ * @retval 无
+ */
+void TB6612_SetDuty(TB6612_MotorTypeDef motor, int32_t duty) {
+    TB6612_Ramp_Cancel(motor);
+    motor_apply(motor, duty);
+}
+
+// 带符号输出（斜坡中断和TB6612_SetDuty共用，不影响斜坡状态）
+static void motor_apply(TB6612_MotorTypeDef motor, int32_t duty) {
+    int32_t max = (int32_t)TB6612_PWM_MAX;
+
+    if (duty > max) duty = max;
+    if (duty < -max) duty = -max;
+
+    if (duty > 0) {
+        TB6612_SetDirection(motor, TB6612_FORWARD);
+        TB6612_SetSpeed(motor, (uint16_t)duty);
+    } else if (duty < 0) {
+        TB6612_SetDirection(motor, TB6612_BACKWARD);
+        TB6612_SetSpeed(motor, (uint16_t)-duty);
+    } else {
+        TB6612_HardStop(motor);
+    }
+}
+
+/**
+ * @brief  按百分比设置输出，按定时器周期换算成比较值，保留全部占空比分辨率
+ * @param  motor: 电机编号
+ * @param  percent: 输出 (-100.0 ~ 100.0)，正数正转，负数反转
+ * @retval 无
+ */
+void TB6612_SetOutput(TB6612_MotorTypeDef motor, float percent) {
+    TB6612_SetDuty(motor, TB6612_PercentToDuty(percent));
+}
+
+/**
+ * @brief  百分比换算成带符号比较值（按定时器周期，四舍五入）
+ * @param  percent: 输出 (-100.0 ~ 100.0)
+ * @retval 比较值 (-TB6612_PWM_MAX ~ TB6612_PWM_MAX)，超出范围不限幅
+ */
+int32_t TB6612_PercentToDuty(float percent) {
+    float counts = percent * (float)TB6612_PWM_MAX * 0.01f;
+
+    // 四舍五入，避免截断在零附近产生不对称的死区
+    return (int32_t)(counts > 0.0f ? counts + 0.5f : counts - 0.5f);
+}
+
+// 一路电机的方向引脚：正数IN1=1，负数IN2=1，0两个都为0（停止）；返回BSRR值，*ccr为比较值
+static uint32_t dir_bits(int32_t duty, uint16_t in1, uint16_t in2, uint32_t *ccr) {
+    int32_t max = (int32_t)TB6612_PWM_MAX;
+
+    if (duty > max) duty = max;
+    if (duty < -max) duty = -max;
+    if (duty > 0) {
+        *ccr = (uint32_t)duty;
+        return in1 | ((uint32_t)in2 << 16);
+    }
+    if (duty < 0) {
+        *ccr = (uint32_t)-duty;
+        return in2 | ((uint32_t)in1 << 16);
+    }
+    *ccr = 0;
+    return (uint32_t)(in1 | in2) << 16;
+}
+
+/**
+ * @brief  同时设置两路电机的方向和占空比（每个控制周期调用一次）
+ * @param  duty_a: A路比较值 (-TB6612_PWM_MAX ~ TB6612_PWM_MAX)，正数正转，负数反转，0停止；
+ *                 为额定电压下的值，按TB6612_Set_Supply给出的电压补偿后输出
+ * @param  duty_b: B路比较值，同上
+ * @note   四个方向引脚一次BSRR写入，两个CCR紧接着写；引脚和比较值与当前相同时不写。
+ *         CCR开启了预装载（PWM通道默认），新占空比在下一个PWM周期开始时两路同时生效
+ * @retval 无
+ */
+void TB6612_SetOutputs(int32_t duty_a, int32_t duty_b) {
+    const uint32_t mask = TB6612_AIN1_PIN | TB6612_AIN2_PIN | TB6612_BIN1_PIN | TB6612_BIN2_PIN;
+    int32_t scale = supply_scale;
+    uint32_t ccr_a, ccr_b, bsrr;
+
+    // 按电池电压补偿（除法向零取整，正反转对称），限幅在dir_bits中
+    if (scale != TB6612_SUPPLY_SCALE_ONE) {
+        duty_a = duty_a * scale / TB6612_SUPPLY_SCALE_ONE;
+        duty_b = duty_b * scale / TB6612_SUPPLY_SCALE_ONE;
+    }
+    bsrr = dir_bits(duty_a, TB6612_AIN1_PIN, TB6612_AIN2_PIN, &ccr_a) |
+           dir_bits(duty_b, TB6612_BIN1_PIN, TB6612_BIN2_PIN, &ccr_b);
+
+    // 直接给定输出时取消后台斜坡，以最新指令为准
+    if (ramp[TB6612_MOTOR_A].active) TB6612_Ramp_Cancel(TB6612_MOTOR_A);
+    if (ramp[TB6612_MOTOR_B].active) TB6612_Ramp_Cancel(TB6612_MOTOR_B);
+
+    // BSRR低16位即置位后的引脚电平
+    if ((TB6612_DIR_PORT->ODR & mask) != (bsrr & mask)) {
+        TB6612_DIR_PORT->BSRR = bsrr;
+    }
+    if (__HAL_TIM_GET_COMPARE(TB6612_PWM_TIM, TB6612_PWMA_CHANNEL) != ccr_a) {
+        __HAL_TIM_SET_COMPARE(TB6612_PWM_TIM, TB6612_PWMA_CHANNEL, ccr_a);
+    }
+    if (__HAL_TIM_GET_COMPARE(TB6612_PWM_TIM, TB6612_PWMB_CHANNEL) != ccr_b) {
+        __HAL_TIM_SET_COMPARE(TB6612_PWM_TIM, TB6612_PWMB_CHANNEL, ccr_b);
+    }
+    current_speed_a = (uint16_t)ccr_a;
+    current_speed_b = (uint16_t)ccr_b;
+}
+
+// 当前方向：反转为-1，正转/停止为1
+static int32_t motor_dir(TB6612_MotorTypeDef motor) {
+    uint32_t odr = TB6612_DIR_PORT->ODR;
+
+    if (motor == TB6612_MOTOR_A) {
+        return ((odr & TB6612_AIN2_PIN) && !(odr & TB6612_AIN1_PIN)) ? -1 : 1;
+    }
+    return ((odr & TB6612_BIN2_PIN) && !(odr & TB6612_BIN1_PIN)) ? -1 : 1;
+}
+
+// 按旧接口的步长/步间隔设置斜坡变化率并启动斜坡，保持当前方向
+static void smooth_to(TB6612_MotorTypeDef motor, uint16_t target_speed,
+                      uint16_t step, uint32_t delay_ms) {
+    float max_slew = delay_ms ? (float)step * 1000.0f / (float)delay_ms : 0.0f;
+
+    TB6612_Ramp_Config(motor, max_slew, ramp[motor].jerk);
+    TB6612_Ramp_To(motor, motor_dir(motor) * (int32_t)target_speed);
+}
+
+/**
+ * @brief  平滑加速（后台斜坡，立即返回）
  * @param  motor: 电机编号
  * @param  target_speed: 目标速度
  * @param  step: 每次加速的步长
- * @param  delay_ms: 每步延迟时间(ms)
+ * @param  delay_ms: 每步间隔时间(ms)，换算成斜坡变化率step/delay_ms
  * @retval 无
  */
 void TB6612_SmoothAccelerate(TB6612_MotorTypeDef motor, uint16_t target_speed,
                              uint16_t step, uint32_t delay_ms) {
-    uint16_t current_speed = TB6612_GetCurrentSpeed(motor);
-
-    // 限制目标速度
-    if (target_speed > TB6612_PWM_MAX) {
-        target_speed = TB6612_PWM_MAX;
-    }
-
-    // 逐步加速
-    while (current_speed < target_speed) {
-        current_speed += step;
-        if (current_speed > target_speed) {
-            current_speed = target_speed;
-        }
-        TB6612_SetSpeed(motor, current_speed);
-        HAL_Delay(delay_ms);
+    // 只加速：目标低于当前速度时不动作
+    if (target_speed > TB6612_GetCurrentSpeed(motor)) {
+        smooth_to(motor, target_speed, step, delay_ms);
     }
 }
 
 /**
- * @brief  平滑减速
+ * @brief  平滑减速（后台斜坡，立即返回）
  * @param  motor: 电机编号
  * @param  target_speed: 目标速度
  * @param  step: 每次减速的步长
- * @param  delay_ms: 每步延迟时间(ms)
+ * @param  delay_ms: 每步间隔时间(ms)，换算成斜坡变化率step/delay_ms
  * @retval 无
  */
 void TB6612_SmoothDecelerate(TB6612_MotorTypeDef motor, uint16_t target_speed,
                              uint16_t step, uint32_t delay_ms) {
-    uint16_t current_speed = TB6612_GetCurrentSpeed(motor);
-
-    // 限制目标速度不能小于0
-    if (target_speed > TB6612_PWM_MAX) {
-        target_speed = 0;
-    }
-
-    // 逐步减速
-    while (current_speed > target_speed) {
-        current_speed -= step;
-        if (current_speed < target_speed) {
-            current_speed = target_speed;
-        }
-        TB6612_SetSpeed(motor, current_speed);
-        HAL_Delay(delay_ms);
+    // 只减速：目标高于当前速度时不动作
+    if (target_speed < TB6612_GetCurrentSpeed(motor)) {
+        smooth_to(motor, target_speed, step, delay_ms);
     }
 }
 
 /**
- * @brief  软停止(减速至停止)
+ * @brief  软停止(减速至停止，后台斜坡，立即返回)，到0后方向引脚置为停止
  * @param  motor: 电机编号
  * @param  step: 每次减速的步长
- * @param  delay_ms: 每步延迟时间(ms)
+ * @param  delay_ms: 每步间隔时间(ms)
  * @retval 无
  */
 void TB6612_SoftStop(TB6612_MotorTypeDef motor, uint16_t step, uint32_t delay_ms) {
-    TB6612_SmoothDecelerate(motor, 0, step, delay_ms);
-    TB6612_SetDirection(motor, TB6612_STOP);
+    smooth_to(motor, 0, step, delay_ms);
 }
 
 /**
@@ -192,3 +316,184 @@ uint16_t TB6612_GetCurrentSpeed(TB6612_MotorTypeDef motor) {
         return current_speed_b;
     }
 }
+
+/**
+ * @brief  配置斜坡限制
+ * @param  motor: 电机编号
+ * @param  max_slew: 占空比变化率上限（计数/秒，对应电机加速度），<=0时TB6612_Ramp_To立即到位
+ * @param  jerk: 变化率的变化上限（计数/秒^2），<=0不限制（梯形斜坡），>0为S形斜坡并提前减速
+ * @retval 无
+ */
+void TB6612_Ramp_Config(TB6612_MotorTypeDef motor, float max_slew, float jerk) {
+    __disable_irq();
+    ramp[motor].max_slew = max_slew;
+    ramp[motor].jerk = jerk;
+    __enable_irq();
+}
+
+/**
+ * @brief  启动斜坡：从当前输出按配置的限制变到目标值，立即返回（中断中推进）
+ * @param  motor: 电机编号
+ * @param  target_duty: 目标比较值 (-TB6612_PWM_MAX ~ TB6612_PWM_MAX)，正数正转，负数反转
+ * @retval 无
+ */
+void TB6612_Ramp_To(TB6612_MotorTypeDef motor, int32_t target_duty) {
+    volatile TB6612_RampTypeDef *r = &ramp[motor];
+    int32_t max = (int32_t)TB6612_PWM_MAX;
+
+    if (target_duty > max) target_duty = max;
+    if (target_duty < -max) target_duty = -max;
+    if (r->max_slew <= 0.0f) {
+        TB6612_SetDuty(motor, target_duty);
+        return;
+    }
+
+    __disable_irq();
+    // 进行中的斜坡保留当前输出和变化率，目标改变时连续过渡
+    if (!r->active) {
+        r->duty = (float)(motor_dir(motor) * (int32_t)TB6612_GetCurrentSpeed(motor));
+        r->slew = 0.0f;
+    }
+    r->target = (float)target_duty;
+    r->active = 1;
+    if (!__HAL_TIM_GET_IT_SOURCE(TB6612_PWM_TIM, TIM_IT_UPDATE)) {
+        ramp_div = ramp_div_reload;
+        __HAL_TIM_CLEAR_FLAG(TB6612_PWM_TIM, TIM_FLAG_UPDATE);
+        __HAL_TIM_ENABLE_IT(TB6612_PWM_TIM, TIM_IT_UPDATE);
+    }
+    __enable_irq();
+}
+
+/**
+ * @brief  取消斜坡，输出停在当前值
+ */
+void TB6612_Ramp_Cancel(TB6612_MotorTypeDef motor) {
+    __disable_irq();
+    ramp[motor].active = 0;
+    ramp[motor].slew = 0.0f;
+    __enable_irq();
+}
+
+/**
+ * @brief  斜坡是否还在进行
+ */
+uint8_t TB6612_Ramp_Busy(TB6612_MotorTypeDef motor) {
+    return ramp[motor].active;
+}
+
+// 推进一拍：变化率先受jerk限制，剩余距离不够按jerk减速到0时开始减速（v^2 > 2*j*|err|，不开方）
+static void ramp_step(TB6612_MotorTypeDef motor) {
+    volatile TB6612_RampTypeDef *r = &ramp[motor];
+    const float dt = 1.0f / (float)TB6612_RAMP_HZ;
+    float err = r->target - r->duty;
+    float dir = err > 0.0f ? 1.0f : -1.0f;
+    float step;
+
+    if (fast_fabsf(err) >= 0.5f) {
+        if (r->jerk > 0.0f) {
+            float dv = r->jerk * dt;
+            float goal = dir * r->max_slew;
+            if (r->slew * dir > 0.0f && r->slew * r->slew > 2.0f * r->jerk * fast_fabsf(err)) {
+                goal = 0.0f;
+            }
+            if (goal > r->slew + dv) r->slew += dv;
+            else if (goal < r->slew - dv) r->slew -= dv;
+            else r->slew = goal;
+        } else {
+            r->slew = dir * r->max_slew;
+        }
+        step = r->slew * dt;
+        // 本拍走不到目标：继续
+        if (step * dir < fast_fabsf(err)) {
+            r->duty += step;
+            motor_apply(motor, (int32_t)(r->duty > 0.0f ? r->duty + 0.5f : r->duty - 0.5f));
+            return;
+        }
+    }
+    r->duty = r->target;
+    r->slew = 0.0f;
+    r->active = 0;
+    motor_apply(motor, (int32_t)r->target);
+}
+
+/**
+ * @brief  TIM1更新中断（每个PWM周期）：分频后推进两路斜坡，都完成后关闭更新中断
+ */
+void TB6612_Ramp_IRQHandler(void) {
+    if (!__HAL_TIM_GET_FLAG(TB6612_PWM_TIM, TIM_FLAG_UPDATE)) return;
+    __HAL_TIM_CLEAR_FLAG(TB6612_PWM_TIM, TIM_FLAG_UPDATE);
+    if (--ramp_div) return;
+    ramp_div = ramp_div_reload;
+
+    if (ramp[TB6612_MOTOR_A].active) ramp_step(TB6612_MOTOR_A);
+    if (ramp[TB6612_MOTOR_B].active) ramp_step(TB6612_MOTOR_B);
+    if (!ramp[TB6612_MOTOR_A].active && !ramp[TB6612_MOTOR_B].active) {
+        __HAL_TIM_DISABLE_IT(TB6612_PWM_TIM, TIM_IT_UPDATE);
+    }
+}
+
+/**
+ * @brief  更新电源电压，TB6612_SetOutputs据此补偿占空比（每个控制周期调用）
+ * @param  supply_mv: 电池电压（mV），0=未知（不接电池/采样无效），不补偿
+ * @retval 无
+ */
+void TB6612_Set_Supply(uint16_t supply_mv) {
+    uint32_t scale = TB6612_SUPPLY_SCALE_ONE;
+
+    if (supply_mv != 0) {
+        scale = (TB6612_SUPPLY_NOMINAL_MV * TB6612_SUPPLY_SCALE_ONE + supply_mv / 2U) / supply_mv;
+        if (scale > TB6612_SUPPLY_SCALE_MAX) scale = TB6612_SUPPLY_SCALE_MAX;
+    }
+    supply_scale = (uint16_t)scale;
+}
+
+/**
+ * @brief  当前电源电压补偿系数（Q12，4096=不补偿）
+ */
+uint16_t TB6612_Get_Supply_Scale(void) {
+    return supply_scale;
+}
+
+/**
+ * @brief  装入一路电机的摩擦补偿表
+ * @param  motor: 电机编号
+ * @param  f: 起转/维持阈值，NULL=关闭该路补偿
+ * @retval 无
+ */
+void TB6612_Set_Friction(TB6612_MotorTypeDef motor, const TB6612_FrictionTypeDef *f) {
+    __disable_irq();
+    if (f != NULL) {
+        friction[motor] = *f;
+    }
+    friction_valid[motor] = (f != NULL);
+    __enable_irq();
+}
+
+/**
+ * @brief  两路电机是否都装入了摩擦补偿表
+ */
+uint8_t TB6612_Has_Friction(void) {
+    return friction_valid[TB6612_MOTOR_A] && friction_valid[TB6612_MOTOR_B];
+}
+
+/**
+ * @brief  摩擦补偿：把期望输出映射到实际比较值
+ * @param  motor: 电机编号
+ * @param  duty: 期望输出 (-TB6612_PWM_MAX ~ TB6612_PWM_MAX)，0保持为0
+ * @param  speed: 该路车轮当前速度（编码器，前进为正，只看符号）
+ * @retval 补偿后的比较值；该路未装入补偿表时原样返回
+ */
+int32_t TB6612_Friction_Compensate(TB6612_MotorTypeDef motor, int32_t duty, int32_t speed) {
+    int32_t max = (int32_t)TB6612_PWM_MAX;
+    uint8_t dir = duty < 0;
+    int32_t mag = dir ? -duty : duty;
+    int32_t th;
+
+    if (!friction_valid[motor] || duty == 0) return duty;
+    if (mag > max) mag = max;
+    // 已在同方向转动：只需克服动摩擦
+    th = ((duty > 0 && speed > 0) || (duty < 0 && speed < 0)) ?
+         friction[motor].keep[dir] : friction[motor].start[dir];
+    mag = th + mag * (max - th) / max;
+    return dir ? -mag : mag;
+}
@@ -39,12 +39,47 @@ typedef enum {
 // PWM配置 - 已按提供的配置修改
 #define TB6612_PWMA_CHANNEL MOTOR_PWMA_CHAN
 #define TB6612_PWMB_CHANNEL MOTOR_PWMB_CHAN
-#define TB6612_PWM_MAX      MOTOR_PWM_MAX
+// 四个方向引脚都在同一个端口，TB6612_SetOutputs用一次BSRR写入同时更新
+#define TB6612_DIR_PORT     MOTOR_AIN1_PORT
+
+// 满占空比对应的比较值，取自TIM1实际的自动重装载值（ARR+1），改CubeMX周期后无需同步修改
+#define TB6612_PWM_MAX      (__HAL_TIM_GET_AUTORELOAD(MOTOR_PWM_TIM) + 1U)
+
+// 后台斜坡：TIM1更新中断（PWM周期）分频到TB6612_RAMP_HZ推进，只在有斜坡进行时打开中断
+#define TB6612_RAMP_HZ          1000U   // 斜坡推进频率
+#define TB6612_RAMP_IRQ_PRIO    2       // 低于MPU INT/DMA和TIM3
+
+// 单路电机的斜坡状态（比较值单位，带符号）
+typedef struct {
+    float duty;         // 当前输出
+    float slew;         // 当前变化率（计数/秒）
+    float target;       // 目标输出
+    float max_slew;     // 变化率上限（计数/秒，对应电机加速度），<=0立即到位
+    float jerk;         // 变化率的变化上限（计数/秒^2），<=0不限制
+    uint8_t active;     // 斜坡进行中
+} TB6612_RampTypeDef;
+
+// 电源电压补偿：TB6612_SetOutputs的比较值乘以 额定电压/实际电压，电机得到的平均电压不随电池放电变化，
+// 控制环增益保持在额定电压下整定的值；实际电压由电池采样模块每个控制周期给出
+#define TB6612_SUPPLY_NOMINAL_MV    7400U   // 整定PID时的电池电压（2S锂电）
+#define TB6612_SUPPLY_SCALE_ONE     4096    // 补偿系数Q12
+#define TB6612_SUPPLY_SCALE_MAX     6144    // 补偿上限1.5倍（电压低于额定的2/3时不再加大）
+
+// 摩擦补偿表（每路电机一张，[0]=正转, [1]=反转）：非零输出从阈值起步，
+// 0~满量程线性映射到阈值~满量程；静止时用起转阈值，已在同方向转动时用较低的维持阈值
+typedef struct {
+    uint16_t start[2];  // 静摩擦：静止起转的最小比较值
+    uint16_t keep[2];   // 动摩擦：维持转动的最小比较值
+} TB6612_FrictionTypeDef;
 
 // 函数声明
 void TB6612_Init(void);
 void TB6612_SetDirection(TB6612_MotorTypeDef motor, TB6612_DirectionTypeDef direction);
 void TB6612_SetSpeed(TB6612_MotorTypeDef motor, uint16_t speed);
+void TB6612_SetDuty(TB6612_MotorTypeDef motor, int32_t duty);
+void TB6612_SetOutput(TB6612_MotorTypeDef motor, float percent);
+void TB6612_SetOutputs(int32_t duty_a, int32_t duty_b);
+int32_t TB6612_PercentToDuty(float percent);
 void TB6612_SmoothAccelerate(TB6612_MotorTypeDef motor, uint16_t target_speed,
                              uint16_t step, uint32_t delay_ms);
 void TB6612_SmoothDecelerate(TB6612_MotorTypeDef motor, uint16_t target_speed,
@@ -53,4 +88,14 @@ void TB6612_SoftStop(TB6612_MotorTypeDef motor, uint16_t step, uint32_t delay_ms
 void TB6612_HardStop(TB6612_MotorTypeDef motor);
 void TB6612_Brake(TB6612_MotorTypeDef motor);
 uint16_t TB6612_GetCurrentSpeed(TB6612_MotorTypeDef motor);
+void TB6612_Ramp_Config(TB6612_MotorTypeDef motor, float max_slew, float jerk);
+void TB6612_Ramp_To(TB6612_MotorTypeDef motor, int32_t target_duty);
+void TB6612_Ramp_Cancel(TB6612_MotorTypeDef motor);
+uint8_t TB6612_Ramp_Busy(TB6612_MotorTypeDef motor);
+void TB6612_Ramp_IRQHandler(void);
+void TB6612_Set_Supply(uint16_t supply_mv);
+uint16_t TB6612_Get_Supply_Scale(void);
+void TB6612_Set_Friction(TB6612_MotorTypeDef motor, const TB6612_FrictionTypeDef *f);
+uint8_t TB6612_Has_Friction(void);
+int32_t TB6612_Friction_Compensate(TB6612_MotorTypeDef motor, int32_t duty, int32_t speed);
 #endif //TWIGO_TB6612_H
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "Sensor/battery.h"
+#include "adc.h"
+
+// 缓冲区总和 -> mV 的系数（Q16），编译期算好，运行时只有一次乘法和移位
+#define BATTERY_MV_SCALE    ((uint32_t)((uint64_t)BATTERY_VREF_MV * (BATTERY_DIV_TOP + BATTERY_DIV_BOTTOM) * 65536U / \
+                                        ((uint64_t)BATTERY_DIV_BOTTOM * 4096U * BATTERY_ADC_LEN)))
+
+static volatile uint16_t adc_buf[BATTERY_ADC_LEN];  // DMA循环写入
+static uint8_t started;
+static int32_t filtered_q8;         // 滤波后的电压（mV，Q8），0=尚未取样
+static uint16_t voltage_mv;
+static uint32_t last_ms;
+static uint32_t low_since_ms;       // 开始低于断电阈值的时刻
+static uint8_t low_timing;
+static uint8_t present;             // 见过一次不低于BATTERY_PRESENT_MV的电压后锁定
+static Battery_StateTypeDef state = BATTERY_ABSENT;
+
+/**
+ * @brief  校准ADC并启动连续转换+DMA循环采样（MX_ADC1_Init之后调用）
+ * @retval 0=成功，-1=ADC启动失败（之后电压一直为0，状态为BATTERY_ABSENT）
+ */
+int Battery_Init(void) {
+  if (HAL_ADCEx_Calibration_Start(&hadc1) != HAL_OK ||
+      HAL_ADC_Start_DMA(&hadc1, (uint32_t *)adc_buf, BATTERY_ADC_LEN) != HAL_OK) {
+    return -1;
+  }
+  // 只读循环缓冲区，不需要半满/全满中断（约每0.3ms一次）
+  __HAL_DMA_DISABLE_IT(hadc1.DMA_Handle, DMA_IT_HT | DMA_IT_TC);
+  last_ms = HAL_GetTick();
+  started = 1;
+  return 0;
+}
+
+/**
+ * @brief  取缓冲区平均值、低通滤波并更新电池状态（每个控制周期调用一次）
+ * @retval 当前状态；进入BATTERY_CUTOFF后保持
+ */
+Battery_StateTypeDef Battery_Update(void) {
+  uint32_t now = HAL_GetTick();
+  uint32_t dt = now - last_ms;
+  uint32_t sum = 0;
+  int32_t mv_q8;
+
+  if (!started) return BATTERY_ABSENT;
+
+  for (uint8_t i = 0; i < BATTERY_ADC_LEN; i++) {
+    sum += adc_buf[i];
+  }
+  mv_q8 = (int32_t)((sum * BATTERY_MV_SCALE) >> 8);
+
+  // 一阶低通，k = dt/(tau+dt)；首次取样或长时间未调用时直接取当前值
+  if (filtered_q8 == 0 || dt >= BATTERY_FILTER_MS * 8U) {
+    filtered_q8 = mv_q8;
+    last_ms = now;
+  } else if (dt != 0) {
+    int32_t k = (int32_t)((dt << 8) / (BATTERY_FILTER_MS + dt));
+    filtered_q8 += ((mv_q8 - filtered_q8) * k) >> 8;
+    last_ms = now;
+  }
+  voltage_mv = (uint16_t)((filtered_q8 + 128) >> 8);
+
+  if (state == BATTERY_CUTOFF) return state;
+  // 是否接了电池只判断一次：锁定之后再低于BATTERY_PRESENT_MV也是电池在掉压，照样计入断电
+  if (!present && voltage_mv >= BATTERY_PRESENT_MV) {
+    present = 1;
+  }
+  if (!present) {
+    state = BATTERY_ABSENT;
+  } else if (voltage_mv < BATTERY_CUTOFF_MV) {
+    if (!low_timing) {
+      low_timing = 1;
+      low_since_ms = now;
+    }
+    state = (now - low_since_ms >= BATTERY_CUTOFF_MS) ? BATTERY_CUTOFF : BATTERY_LOW;
+  } else {
+    low_timing = 0;
+    state = (voltage_mv < BATTERY_LOW_MV) ? BATTERY_LOW : BATTERY_OK;
+  }
+  return state;
+}
+
+/**
+ * @brief  滤波后的电池电压（mV），未启动或未取样时为0
+ */
+uint16_t Battery_Get_Voltage(void) {
+  return voltage_mv;
+}
+
+/**
+ * @brief  最近一次Battery_Update得到的状态
+ */
+Battery_StateTypeDef Battery_Get_State(void) {
+  return state;
+}
+
+/**
+ * @brief  解除低压断电（换电池后由指令调用），下次更新重新判断，包括是否接了电池
+ */
+void Battery_Clear_Cutoff(void) {
+  low_timing = 0;
+  present = 0;
+  state = BATTERY_ABSENT;
+}
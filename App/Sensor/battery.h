@@ -0,0 +1,35 @@
+#ifndef TWIGO_BATTERY_H
+#define TWIGO_BATTERY_H
+
+#include "stm32f1xx_hal.h"
+
+// 电池电压采样：PB0(ADC1_IN8)经分压电阻接电池，ADC连续转换，DMA循环搬运到缓冲区，
+// 不开DMA中断，控制周期里取缓冲区平均值再低通滤波，CPU开销只有一次求和
+#define BATTERY_ADC_LEN         16      // DMA循环缓冲区（采样点，每点约21us）
+#define BATTERY_VREF_MV         3300U   // ADC参考电压（VDDA）
+#define BATTERY_DIV_TOP         20U     // 分压上电阻（kΩ）
+#define BATTERY_DIV_BOTTOM      10U     // 分压下电阻（kΩ），8.4V满电时ADC输入2.8V
+#define BATTERY_FILTER_MS       20U     // 低通时间常数：滤掉PWM纹波，跟得上负载突变引起的压降
+
+// 阈值（2S锂电）
+#define BATTERY_PRESENT_MV      5000U   // 一直低于此值认为没接电池（只用USB供电调试），不补偿也不断电；
+                                        // 一旦达到就锁定为有电池，之后再低按欠压处理
+#define BATTERY_LOW_MV          6800U   // 低电量提示（3.4V/节）
+#define BATTERY_CUTOFF_MV       6400U   // 低压断电（3.2V/节）
+#define BATTERY_CUTOFF_MS       2000U   // 持续低于断电阈值这么久才断电，避免大电流瞬间压降误触发
+
+// 电池状态
+typedef enum {
+  BATTERY_ABSENT = 0,   // 未接电池（从未达到BATTERY_PRESENT_MV）或ADC未启动
+  BATTERY_OK,
+  BATTERY_LOW,          // 低电量，仍正常控制
+  BATTERY_CUTOFF        // 已断电（锁定，直到Battery_Clear_Cutoff或复位）
+} Battery_StateTypeDef;
+
+int Battery_Init(void);
+Battery_StateTypeDef Battery_Update(void);
+uint16_t Battery_Get_Voltage(void);
+Battery_StateTypeDef Battery_Get_State(void);
+void Battery_Clear_Cutoff(void);
+
+#endif //TWIGO_BATTERY_H
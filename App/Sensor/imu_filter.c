@@ -0,0 +1,72 @@
+#include "Sensor/imu_filter.h"
+#include "Math/fast_math.h"
+
+/**
+ * @brief  初始化互补滤波器
+ * @param  f: 滤波器
+ * @param  rate_hz: 采样率
+ * @param  tau_ms: 时间常数，短于它的变化信陀螺仪，长于它的信加速度计
+ * @param  gyro_lsb_per_dps: 陀螺仪灵敏度（±2000dps量程为16.4）
+ */
+void IMU_Filter_Init(IMU_FilterTypeDef *f, uint16_t rate_hz, uint16_t tau_ms, float gyro_lsb_per_dps) {
+  f->angle = 0;
+  f->rate = 0;
+  f->gyro_scale = (int32_t)(65536.0f / gyro_lsb_per_dps);
+  f->bias = 0;
+  f->bias_sum = 0;
+  f->bias_count = 0;
+  IMU_Filter_Set_Rate(f, rate_hz, tau_ms);
+}
+
+/**
+ * @brief  修改采样率（运行中调用，保留角度和零偏，只重算积分步长和修正权重）
+ * @param  f: 滤波器
+ * @param  rate_hz: 新采样率
+ * @param  tau_ms: 时间常数
+ */
+void IMU_Filter_Set_Rate(IMU_FilterTypeDef *f, uint16_t rate_hz, uint16_t tau_ms) {
+  float dt = 1.0f / rate_hz;
+  float tau = tau_ms * 0.001f;
+
+  f->alpha = (int32_t)(65536.0f * dt / (tau + dt));
+  if (f->alpha < 1) f->alpha = 1;
+  f->rate_hz = rate_hz;
+}
+
+/**
+ * @brief  使用已标定的陀螺零偏，跳过启动时的零偏估计（只用下一个样本初始化角度）
+ * @param  f: 滤波器（IMU_Filter_Init之后调用）
+ * @param  gyro_bias: 俯仰轴零偏，LSB
+ */
+void IMU_Filter_Set_Bias(IMU_FilterTypeDef *f, int16_t gyro_bias) {
+  f->bias_count = IMU_FILTER_BIAS_SAMPLES - 1;
+  f->bias_sum = (int32_t)gyro_bias * (IMU_FILTER_BIAS_SAMPLES - 1);
+}
+
+/**
+ * @brief  输入一个样本（机体坐标系），更新俯仰角和角速度
+ * @param  f: 滤波器
+ * @param  gyro_y: 绕俯仰轴的角速度，LSB
+ * @param  accel_x: 前向加速度，LSB
+ * @param  accel_z: 竖直加速度，LSB
+ */
+void IMU_Filter_Update(IMU_FilterTypeDef *f, int16_t gyro_y, int16_t accel_x, int16_t accel_z) {
+  // 与DMP四元数的俯仰角定义一致：pitch = -asin(ax/|a|)
+  int32_t acc_angle = fast_atan2_deg_q16(-accel_x, accel_z);
+
+  if (f->bias_count < IMU_FILTER_BIAS_SAMPLES) {
+    // 启动阶段：累计陀螺零偏，角度直接取加速度计
+    f->bias_sum += gyro_y;
+    if (++f->bias_count == IMU_FILTER_BIAS_SAMPLES) {
+      f->bias = f->bias_sum / IMU_FILTER_BIAS_SAMPLES;
+    }
+    f->angle = acc_angle;
+    f->rate = 0;
+    return;
+  }
+
+  // 陀螺积分 + 加速度计低通修正
+  f->rate = (gyro_y - f->bias) * f->gyro_scale;
+  f->angle += f->rate / f->rate_hz;
+  f->angle += (int32_t)(((int64_t)(acc_angle - f->angle) * f->alpha) >> 16);
+}
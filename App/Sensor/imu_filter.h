@@ -0,0 +1,32 @@
+#ifndef TWIGO_IMU_FILTER_H
+#define TWIGO_IMU_FILTER_H
+
+#include <stdint.h>
+
+#define IMU_FILTER_BIAS_SAMPLES 128     // 启动时静止估计陀螺零偏的样本数
+
+// 俯仰角定点互补滤波器（全部为整数运算，M3无FPU）
+typedef struct {
+  int32_t angle;          // 俯仰角，Q16.16度
+  int32_t rate;           // 俯仰角速度（已去零偏），Q16.16度/秒
+  int32_t gyro_scale;     // 陀螺仪LSB -> 度/秒，Q16.16
+  int32_t alpha;          // 加速度计修正权重，Q16.16
+  int32_t bias;           // 陀螺零偏，LSB
+  int32_t bias_sum;
+  uint16_t rate_hz;       // 采样率
+  uint16_t bias_count;    // 已累计的零偏样本数
+} IMU_FilterTypeDef;
+
+void IMU_Filter_Init(IMU_FilterTypeDef *f, uint16_t rate_hz, uint16_t tau_ms, float gyro_lsb_per_dps);
+void IMU_Filter_Set_Bias(IMU_FilterTypeDef *f, int16_t gyro_bias);
+void IMU_Filter_Set_Rate(IMU_FilterTypeDef *f, uint16_t rate_hz, uint16_t tau_ms);
+void IMU_Filter_Update(IMU_FilterTypeDef *f, int16_t gyro_y, int16_t accel_x, int16_t accel_z);
+
+/**
+ * @brief  零偏估计完成后输出才有效
+ */
+static inline uint8_t IMU_Filter_Ready(const IMU_FilterTypeDef *f) {
+  return f->bias_count >= IMU_FILTER_BIAS_SAMPLES;
+}
+
+#endif //TWIGO_IMU_FILTER_H
@@ -23,6 +23,7 @@
 #include <string.h>
 #include <math.h>
 #include "inv_mpu.h"
+#include "Math/crc16.h"
 
 /* The following functions must be defined for this platform:
  * i2c_write(unsigned char slave_addr, unsigned char reg_addr,
@@ -38,10 +39,12 @@
  */
 #if defined STM32_MPU6050
 #include "i2c.h"
+#include "System/i2c_bus.h"
+/* 经总线层收发：统计错误，总线卡死时就地恢复后重试一次 */
 #define i2c_write(dev_addr,reg_addr,date_size,p_data) \
-    HAL_I2C_Mem_Write(&hi2c2,dev_addr,reg_addr,I2C_MEMADD_SIZE_8BIT,p_data, date_size,0xF)
+    I2C_Bus_Mem_Write(&hi2c2,dev_addr,reg_addr,p_data, date_size,0xF)
 #define i2c_read(dev_addr,reg_addr,date_size,p_data) \
-    HAL_I2C_Mem_Read(&hi2c2,dev_addr,reg_addr,I2C_MEMADD_SIZE_8BIT,p_data, date_size,0xF)
+    I2C_Bus_Mem_Read(&hi2c2,dev_addr,reg_addr,p_data, date_size,0xF)
 #define delay_ms HAL_Delay
 #define get_ms(p)  do{ *p = HAL_GetTick();}while(0)
 // static inline int reg_int_cb(struct int_param_s *int_param)
@@ -166,6 +169,8 @@ static inline int reg_int_cb(struct int_param_s *int_param)
 #endif
 
 static int set_int_enable(unsigned char enable);
+static int wait_reg_clear(unsigned char reg, unsigned char mask,
+    unsigned long timeout_ms);
 
 /* Hardware registers needed by driver. */
 struct gyro_reg_s {
@@ -282,6 +287,8 @@ struct chip_cfg_s {
     unsigned char dmp_on;
     /* Ensures that DMP will only be loaded once. */
     unsigned char dmp_loaded;
+    /* 1 if mpu_probe_firmware found a matching image left in DMP memory. */
+    unsigned char dmp_resident;
     /* Sampling rate used when DMP is enabled. */
     unsigned short dmp_sample_rate;
 #ifdef AK89xx_SECONDARY
@@ -637,6 +644,30 @@ static int setup_compass(void);
 #define MAX_COMPASS_SAMPLE_RATE (100)
 #endif
 
+/**
+ *  @brief      Poll a register until the self-clearing bits in mask read 0.
+ *  Replaces fixed delays after reset commands. A failed read (the chip NACKs
+ *  while it is still resetting) counts as not ready.
+ *  @param[in]  reg         Register address.
+ *  @param[in]  mask        Bits to wait for.
+ *  @param[in]  timeout_ms  Upper bound, the delay the driver used to take.
+ *  @return     0 if the bits cleared in time.
+ */
+static int wait_reg_clear(unsigned char reg, unsigned char mask,
+    unsigned long timeout_ms)
+{
+    unsigned char tmp;
+    unsigned long start, now;
+
+    get_ms(&start);
+    do {
+        if (!i2c_read(st.hw->addr, reg, 1, &tmp) && !(tmp & mask))
+            return 0;
+        get_ms(&now);
+    } while (now - start < timeout_ms);
+    return -1;
+}
+
 /**
  *  @brief      Enable/disable data ready interrupt.
  *  If the DMP is on, the DMP interrupt is enabled. Otherwise, the data ready
@@ -724,11 +755,19 @@ int mpu_init(struct int_param_s *int_param)
 {
     unsigned char data[6];
 
-    /* Reset device. */
-    data[0] = BIT_RESET;
-    if (i2c_write(st.hw->addr, st.reg->pwr_mgmt_1, 1, data))
-        return -1;
-    delay_ms(100);
+    if (!st.chip_cfg.dmp_resident) {
+        /* Wait for the chip to answer after power-up, then reset it. */
+        if (wait_reg_clear(st.reg->pwr_mgmt_1, BIT_RESET, 100))
+            return -1;
+        data[0] = BIT_RESET;
+        if (i2c_write(st.hw->addr, st.reg->pwr_mgmt_1, 1, data))
+            return -1;
+        if (wait_reg_clear(st.reg->pwr_mgmt_1, BIT_RESET, 100))
+            return -1;
+    }
+    /* Otherwise the DMP image survived an MCU-only reset. A device reset
+     * would throw it away, and every register is rewritten below anyway.
+     */
 
     /* Wake up chip. */
     data[0] = 0x00;
@@ -1152,7 +1191,8 @@ int mpu_reset_fifo(void)
         data = BIT_FIFO_RST | BIT_DMP_RST;
         if (i2c_write(st.hw->addr, st.reg->user_ctrl, 1, &data))
             return -1;
-        delay_ms(50);
+        if (wait_reg_clear(st.reg->user_ctrl, BIT_FIFO_RST | BIT_DMP_RST, 50))
+            return -1;
         data = BIT_DMP_EN | BIT_FIFO_EN;
         if (st.chip_cfg.sensors & INV_XYZ_COMPASS)
             data |= BIT_AUX_IF_EN;
@@ -1171,13 +1211,14 @@ int mpu_reset_fifo(void)
         data = BIT_FIFO_RST;
         if (i2c_write(st.hw->addr, st.reg->user_ctrl, 1, &data))
             return -1;
+        if (wait_reg_clear(st.reg->user_ctrl, BIT_FIFO_RST, 50))
+            return -1;
         if (st.chip_cfg.bypass_mode || !(st.chip_cfg.sensors & INV_XYZ_COMPASS))
             data = BIT_FIFO_EN;
         else
             data = BIT_FIFO_EN | BIT_AUX_IF_EN;
         if (i2c_write(st.hw->addr, st.reg->user_ctrl, 1, &data))
             return -1;
-        delay_ms(50);
         if (st.chip_cfg.int_enable)
             data = BIT_DATA_RDY_EN;
         else
@@ -1707,7 +1748,9 @@ int mpu_set_sensors(unsigned char sensors)
 
     st.chip_cfg.sensors = sensors;
     st.chip_cfg.lp_accel_mode = 0;
-    delay_ms(50);
+    /* Gyro start-up time; nothing to wait for when going to sleep. */
+    if (sensors)
+        delay_ms(50);
     return 0;
 }
 
@@ -1859,6 +1902,34 @@ int mpu_read_fifo_stream(unsigned short length, unsigned char *data,
     return 0;
 }
 
+/**
+ *  @brief      Get the registers needed to stream the FIFO outside of
+ *  this driver.
+ *  This function should be used if the FIFO is to be read asynchronously
+ *  (e.g. by DMA) instead of through @e mpu_read_fifo_stream or
+ *  @e mpu_read_fifo. With the DMP off, packets are the sensors selected by
+ *  @e mpu_configure_fifo in register order (accel, then gyro).
+ *  @param[out] dev_addr    I2C device address.
+ *  @param[out] count_reg   FIFO_COUNT_H register (count is big-endian).
+ *  @param[out] rw_reg      FIFO_R_W register.
+ *  @param[out] max_fifo    FIFO size in bytes.
+ *  @return     0 if successful.
+ */
+int mpu_get_fifo_stream_regs(unsigned char *dev_addr, unsigned char *count_reg,
+    unsigned char *rw_reg, unsigned short *max_fifo)
+{
+    if (!st.chip_cfg.dmp_on && !st.chip_cfg.fifo_enable)
+        return -1;
+    if (!st.chip_cfg.sensors)
+        return -1;
+
+    dev_addr[0] = st.hw->addr;
+    count_reg[0] = st.reg->fifo_count_h;
+    rw_reg[0] = st.reg->fifo_r_w;
+    max_fifo[0] = st.hw->max_fifo;
+    return 0;
+}
+
 /**
  *  @brief      Set device to bypass mode.
  *  @param[in]  bypass_on   1 to enable bypass mode.
@@ -2892,22 +2963,127 @@ int mpu_read_mem(unsigned short mem_addr, unsigned short length,
     return 0;
 }
 
+/* Verify mode for mpu_load_firmware. Sampled readback checks the head and
+ * tail of every bank, enough to catch a dropped or misaddressed write.
+ */
+#ifndef MPU_LOAD_VERIFY_FULL
+#define MPU_LOAD_VERIFY_FULL    (0)
+#endif
+#define LOAD_VERIFY_SAMPLE      (16)
+/* Signature written into the unused tail of the last image bank. Lets
+ * mpu_probe_firmware recognise an image that survived an MCU-only reset.
+ */
+#define DMP_SIG_LEN             (8)
+#define DMP_SIG_MAGIC_0         ('D')
+#define DMP_SIG_MAGIC_1         ('M')
+
+static void build_signature(unsigned short length, const unsigned char *firmware,
+    unsigned short start_addr, unsigned char *sig)
+{
+    uint16_t crc = crc16_update(CRC16_INIT, firmware, length);
+    sig[0] = DMP_SIG_MAGIC_0;
+    sig[1] = DMP_SIG_MAGIC_1;
+    sig[2] = (unsigned char)(crc >> 8);
+    sig[3] = (unsigned char)(crc & 0xFF);
+    sig[4] = (unsigned char)(length >> 8);
+    sig[5] = (unsigned char)(length & 0xFF);
+    sig[6] = (unsigned char)(start_addr >> 8);
+    sig[7] = (unsigned char)(start_addr & 0xFF);
+}
+
+static int signature_fits(unsigned short length)
+{
+    return (length % st.hw->bank_size) + DMP_SIG_LEN <= st.hw->bank_size;
+}
+
+/* CRC of a readback of [addr, addr + length), taken in small pieces. */
+static int readback_crc(unsigned short addr, unsigned short length,
+    uint16_t *crc)
+{
+    unsigned char cur[LOAD_VERIFY_SAMPLE];
+    unsigned short this_read;
+
+    while (length) {
+        this_read = min(LOAD_VERIFY_SAMPLE, length);
+        if (mpu_read_mem(addr, this_read, cur))
+            return -1;
+        *crc = crc16_update(*crc, cur, this_read);
+        addr += this_read;
+        length -= this_read;
+    }
+    return 0;
+}
+
+/**
+ *  @brief      Check whether DMP memory already holds this image.
+ *  Call before mpu_init. Requires the DMP to be running with the program
+ *  start address and signature left by a previous mpu_load_firmware. On a
+ *  match, mpu_init skips the device reset and mpu_load_firmware skips the
+ *  upload.
+ *  @param[in]  length      Length of DMP image.
+ *  @param[in]  firmware    DMP code.
+ *  @param[in]  start_addr  Starting address of DMP code memory.
+ *  @return     0 if the image is resident.
+ */
+int mpu_probe_firmware(unsigned short length, const unsigned char *firmware,
+    unsigned short start_addr)
+{
+    unsigned char tmp[2], sig[DMP_SIG_LEN], expect[DMP_SIG_LEN];
+
+    st.chip_cfg.dmp_resident = 0;
+    if (!firmware || !signature_fits(length))
+        return -1;
+
+    /* Awake, not resetting, DMP enabled. */
+    if (i2c_read(st.hw->addr, st.reg->pwr_mgmt_1, 1, tmp))
+        return -1;
+    if (tmp[0] & (BIT_RESET | BIT_SLEEP))
+        return -1;
+    if (i2c_read(st.hw->addr, st.reg->user_ctrl, 1, tmp))
+        return -1;
+    if (!(tmp[0] & BIT_DMP_EN))
+        return -1;
+    if (i2c_read(st.hw->addr, st.reg->prgm_start_h, 2, tmp))
+        return -1;
+    if (((tmp[0] << 8) | tmp[1]) != start_addr)
+        return -1;
+
+    /* mpu_read_mem needs chip_cfg, which is not set up yet. */
+    tmp[0] = (unsigned char)(length >> 8);
+    tmp[1] = (unsigned char)(length & 0xFF);
+    if (i2c_write(st.hw->addr, st.reg->bank_sel, 2, tmp))
+        return -1;
+    if (i2c_read(st.hw->addr, st.reg->mem_r_w, DMP_SIG_LEN, sig))
+        return -1;
+    build_signature(length, firmware, start_addr, expect);
+    if (memcmp(sig, expect, DMP_SIG_LEN))
+        return -1;
+
+    st.chip_cfg.dmp_resident = 1;
+    return 0;
+}
+
 /**
  *  @brief      Load and verify DMP image.
+ *  The image is written in bank-sized bursts, then checked with one CRC
+ *  over a sampled (or, with MPU_LOAD_VERIFY_FULL, complete) readback. If
+ *  mpu_probe_firmware found the same image resident, nothing is written.
  *  @param[in]  length      Length of DMP image.
  *  @param[in]  firmware    DMP code.
  *  @param[in]  start_addr  Starting address of DMP code memory.
  *  @param[in]  sample_rate Fixed sampling rate used when DMP is enabled.
- *  @return     0 if successful.
+ *  @return     0 if successful, -2 if verification failed.
  */
 int mpu_load_firmware(unsigned short length, const unsigned char *firmware,
     unsigned short start_addr, unsigned short sample_rate)
 {
     unsigned short ii;
     unsigned short this_write;
-    /* Must divide evenly into st.hw->bank_size to avoid bank crossings. */
-#define LOAD_CHUNK  (16)
-    unsigned char cur[LOAD_CHUNK], tmp[2];
+    unsigned short bank_left;
+    /* Never cross a bank boundary in one write. */
+#define LOAD_CHUNK  (st.hw->bank_size)
+    unsigned char tmp[2], sig[DMP_SIG_LEN];
+    uint16_t crc_image, crc_chip;
 
     if (st.chip_cfg.dmp_loaded)
         /* DMP should only be loaded once. */
@@ -2915,14 +3091,48 @@ int mpu_load_firmware(unsigned short length, const unsigned char *firmware,
 
     if (!firmware)
         return -1;
-    for (ii = 0; ii < length; ii += this_write) {
-        this_write = min(LOAD_CHUNK, length - ii);
-        if (mpu_write_mem(ii, this_write, (unsigned char*)&firmware[ii]))
-            return -1;
-        if (mpu_read_mem(ii, this_write, cur))
+
+    if (!st.chip_cfg.dmp_resident) {
+        for (ii = 0; ii < length; ii += this_write) {
+            bank_left = LOAD_CHUNK - (ii % LOAD_CHUNK);
+            this_write = min(bank_left, length - ii);
+            if (mpu_write_mem(ii, this_write, (unsigned char*)&firmware[ii]))
+                return -1;
+        }
+
+        crc_image = CRC16_INIT;
+        crc_chip = CRC16_INIT;
+#if MPU_LOAD_VERIFY_FULL
+        crc_image = crc16_update(crc_image, firmware, length);
+        if (readback_crc(0, length, &crc_chip))
             return -1;
-        if (memcmp(firmware+ii, cur, this_write))
+#else
+        for (ii = 0; ii < length; ii += this_write) {
+            bank_left = LOAD_CHUNK - (ii % LOAD_CHUNK);
+            this_write = min(bank_left, length - ii);
+            if (this_write <= 2 * LOAD_VERIFY_SAMPLE) {
+                crc_image = crc16_update(crc_image, &firmware[ii], this_write);
+                if (readback_crc(ii, this_write, &crc_chip))
+                    return -1;
+            } else {
+                unsigned short tail = ii + this_write - LOAD_VERIFY_SAMPLE;
+                crc_image = crc16_update(crc_image, &firmware[ii], LOAD_VERIFY_SAMPLE);
+                crc_image = crc16_update(crc_image, &firmware[tail], LOAD_VERIFY_SAMPLE);
+                if (readback_crc(ii, LOAD_VERIFY_SAMPLE, &crc_chip))
+                    return -1;
+                if (readback_crc(tail, LOAD_VERIFY_SAMPLE, &crc_chip))
+                    return -1;
+            }
+        }
+#endif
+        if (crc_image != crc_chip)
             return -2;
+
+        if (signature_fits(length)) {
+            build_signature(length, firmware, start_addr, sig);
+            if (mpu_write_mem(length, DMP_SIG_LEN, sig))
+                return -1;
+        }
     }
 
     /* Set program start address. */
@@ -2936,6 +3146,15 @@ int mpu_load_firmware(unsigned short length, const unsigned char *firmware,
     return 0;
 }
 
+/**
+ *  @brief      Check if the last DMP load reused a resident image.
+ *  @return     1 if the upload was skipped.
+ */
+unsigned char mpu_firmware_was_resident(void)
+{
+    return st.chip_cfg.dmp_resident;
+}
+
 /**
  *  @brief      Enable/disable DMP support.
  *  @param[in]  enable  1 to turn on the DMP.
@@ -117,6 +117,8 @@ int mpu_read_fifo(short *gyro, short *accel, unsigned long *timestamp,
     unsigned char *sensors, unsigned char *more);
 int mpu_read_fifo_stream(unsigned short length, unsigned char *data,
     unsigned char *more);
+int mpu_get_fifo_stream_regs(unsigned char *dev_addr, unsigned char *count_reg,
+    unsigned char *rw_reg, unsigned short *max_fifo);
 int mpu_reset_fifo(void);
 
 int mpu_write_mem(unsigned short mem_addr, unsigned short length,
@@ -125,6 +127,9 @@ int mpu_read_mem(unsigned short mem_addr, unsigned short length,
     unsigned char *data);
 int mpu_load_firmware(unsigned short length, const unsigned char *firmware,
     unsigned short start_addr, unsigned short sample_rate);
+int mpu_probe_firmware(unsigned short length, const unsigned char *firmware,
+    unsigned short start_addr);
+unsigned char mpu_firmware_was_resident(void);
 
 int mpu_reg_dump(void);
 int mpu_read_reg(unsigned char reg, unsigned char *data);
@@ -488,6 +488,7 @@ struct dmp_s {
     unsigned short feature_mask;
     unsigned short fifo_rate;
     unsigned char packet_length;
+    short packet_sensors;
 };
 
 static struct dmp_s dmp = {
@@ -496,7 +497,8 @@ static struct dmp_s dmp = {
     .orient = 0,
     .feature_mask = 0,
     .fifo_rate = 0,
-    .packet_length = 0
+    .packet_length = 0,
+    .packet_sensors = 0
 };
 
 /**
@@ -509,6 +511,17 @@ int dmp_load_motion_driver_firmware(void)
         DMP_SAMPLE_RATE);
 }
 
+/**
+ *  @brief  Check whether the DMP image is still loaded from a previous boot.
+ *  Call before mpu_init. On success the following mpu_init and
+ *  dmp_load_motion_driver_firmware keep the resident image.
+ *  @return 0 if the image is resident.
+ */
+int dmp_probe_motion_driver_firmware(void)
+{
+    return mpu_probe_firmware(DMP_CODE_SIZE, dmp_memory, sStartAddress);
+}
+
 /**
  *  @brief      Push gyro and accel orientation to the DMP.
  *  The orientation is represented here as the output of
@@ -1103,6 +1116,15 @@ int dmp_enable_feature(unsigned short mask)
     if (mask & (DMP_FEATURE_TAP | DMP_FEATURE_ANDROID_ORIENT))
         dmp.packet_length += 4;
 
+    /* The set of sensors in each packet is fixed by the feature mask. */
+    dmp.packet_sensors = 0;
+    if (mask & (DMP_FEATURE_LP_QUAT | DMP_FEATURE_6X_LP_QUAT))
+        dmp.packet_sensors |= INV_WXYZ_QUAT;
+    if (mask & DMP_FEATURE_SEND_RAW_ACCEL)
+        dmp.packet_sensors |= INV_XYZ_ACCEL;
+    if (mask & DMP_FEATURE_SEND_ANY_GYRO)
+        dmp.packet_sensors |= INV_XYZ_GYRO;
+
     return 0;
 }
 
@@ -1241,53 +1263,58 @@ int dmp_set_interrupt_mode(unsigned char mode)
 }
 
 /**
- *  @brief      Get one packet from the FIFO.
- *  If @e sensors does not contain a particular sensor, disregard the data
- *  returned to that pointer.
- *  \n @e sensors can contain a combination of the following flags:
- *  \n INV_X_GYRO, INV_Y_GYRO, INV_Z_GYRO
- *  \n INV_XYZ_GYRO
- *  \n INV_XYZ_ACCEL
- *  \n INV_WXYZ_QUAT
- *  \n If the FIFO has no new data, @e sensors will be zero.
- *  \n If the FIFO is disabled, @e sensors will be zero and this function will
- *  return a non-zero error code.
+ *  @brief      Get the length of one DMP FIFO packet.
+ *  The length only changes when @e dmp_enable_feature is called.
+ *  @param[out] length  Packet length in bytes.
+ *  @return     0 if successful.
+ */
+int dmp_get_packet_length(unsigned char *length)
+{
+    length[0] = dmp.packet_length;
+    return 0;
+}
+
+/**
+ *  @brief      Parse one DMP packet that has already been read from the FIFO.
+ *  This function should be used if the packet is read elsewhere (e.g. by DMA).
+ *  See @e dmp_read_fifo for the meaning of the outputs.
+ *  \n If the quaternion fails the corruption check, @e sensors will be zero
+ *  and the caller is responsible for resetting the FIFO.
+ *  @param[in]  fifo_data   One packet of @e dmp_get_packet_length bytes.
  *  @param[out] gyro        Gyro data in hardware units.
  *  @param[out] accel       Accel data in hardware units.
  *  @param[out] quat        3-axis quaternion data in hardware units.
- *  @param[out] timestamp   Timestamp in milliseconds.
  *  @param[out] sensors     Mask of sensors read from FIFO.
- *  @param[out] more        Number of remaining packets.
  *  @return     0 if successful.
  */
-int dmp_read_fifo(short *gyro, short *accel, long *quat,
-    unsigned long *timestamp, short *sensors, unsigned char *more)
+int dmp_parse_fifo_packet(const unsigned char *fifo_data, short *gyro,
+    short *accel, long *quat, short *sensors)
 {
-    unsigned char fifo_data[MAX_PACKET_LENGTH];
     unsigned char ii = 0;
 
-    /* TODO: sensors[0] only changes when dmp_enable_feature is called. We can
-     * cache this value and save some cycles.
+    /* sensors[0] only changes when dmp_enable_feature is called, so it is
+     * cached there and only written once the packet has been accepted.
      */
     sensors[0] = 0;
 
-    /* Get a packet. */
-    if (mpu_read_fifo_stream(dmp.packet_length, fifo_data, more))
-        return -1;
-
     /* Parse DMP packet. */
     if (dmp.feature_mask & (DMP_FEATURE_LP_QUAT | DMP_FEATURE_6X_LP_QUAT)) {
 #ifdef FIFO_CORRUPTION_CHECK
         long quat_q14[4], quat_mag_sq;
 #endif
-        quat[0] = ((long)fifo_data[0] << 24) | ((long)fifo_data[1] << 16) |
-            ((long)fifo_data[2] << 8) | fifo_data[3];
-        quat[1] = ((long)fifo_data[4] << 24) | ((long)fifo_data[5] << 16) |
-            ((long)fifo_data[6] << 8) | fifo_data[7];
-        quat[2] = ((long)fifo_data[8] << 24) | ((long)fifo_data[9] << 16) |
-            ((long)fifo_data[10] << 8) | fifo_data[11];
-        quat[3] = ((long)fifo_data[12] << 24) | ((long)fifo_data[13] << 16) |
-            ((long)fifo_data[14] << 8) | fifo_data[15];
+        /* Go through int32_t so the sign is kept where long is 64 bits. */
+        quat[0] = (int32_t)(((uint32_t)fifo_data[0] << 24) |
+            ((uint32_t)fifo_data[1] << 16) | ((uint32_t)fifo_data[2] << 8) |
+            fifo_data[3]);
+        quat[1] = (int32_t)(((uint32_t)fifo_data[4] << 24) |
+            ((uint32_t)fifo_data[5] << 16) | ((uint32_t)fifo_data[6] << 8) |
+            fifo_data[7]);
+        quat[2] = (int32_t)(((uint32_t)fifo_data[8] << 24) |
+            ((uint32_t)fifo_data[9] << 16) | ((uint32_t)fifo_data[10] << 8) |
+            fifo_data[11]);
+        quat[3] = (int32_t)(((uint32_t)fifo_data[12] << 24) |
+            ((uint32_t)fifo_data[13] << 16) | ((uint32_t)fifo_data[14] << 8) |
+            fifo_data[15]);
         ii += 16;
 #ifdef FIFO_CORRUPTION_CHECK
         /* We can detect a corrupted FIFO by monitoring the quaternion data and
@@ -1307,11 +1334,8 @@ int dmp_read_fifo(short *gyro, short *accel, long *quat,
         if ((quat_mag_sq < QUAT_MAG_SQ_MIN) ||
             (quat_mag_sq > QUAT_MAG_SQ_MAX)) {
             /* Quaternion is outside of the acceptable threshold. */
-            mpu_reset_fifo();
-            sensors[0] = 0;
             return -1;
         }
-        sensors[0] |= INV_WXYZ_QUAT;
 #endif
     }
 
@@ -1320,7 +1344,6 @@ int dmp_read_fifo(short *gyro, short *accel, long *quat,
         accel[1] = ((short)fifo_data[ii+2] << 8) | fifo_data[ii+3];
         accel[2] = ((short)fifo_data[ii+4] << 8) | fifo_data[ii+5];
         ii += 6;
-        sensors[0] |= INV_XYZ_ACCEL;
     }
 
     if (dmp.feature_mask & DMP_FEATURE_SEND_ANY_GYRO) {
@@ -1328,14 +1351,53 @@ int dmp_read_fifo(short *gyro, short *accel, long *quat,
         gyro[1] = ((short)fifo_data[ii+2] << 8) | fifo_data[ii+3];
         gyro[2] = ((short)fifo_data[ii+4] << 8) | fifo_data[ii+5];
         ii += 6;
-        sensors[0] |= INV_XYZ_GYRO;
     }
 
     /* Gesture data is at the end of the DMP packet. Parse it and call
      * the gesture callbacks (if registered).
      */
     if (dmp.feature_mask & (DMP_FEATURE_TAP | DMP_FEATURE_ANDROID_ORIENT))
-        decode_gesture(fifo_data + ii);
+        decode_gesture((unsigned char*)fifo_data + ii);
+
+    sensors[0] = dmp.packet_sensors;
+    return 0;
+}
+
+/**
+ *  @brief      Get one packet from the FIFO.
+ *  If @e sensors does not contain a particular sensor, disregard the data
+ *  returned to that pointer.
+ *  \n @e sensors can contain a combination of the following flags:
+ *  \n INV_X_GYRO, INV_Y_GYRO, INV_Z_GYRO
+ *  \n INV_XYZ_GYRO
+ *  \n INV_XYZ_ACCEL
+ *  \n INV_WXYZ_QUAT
+ *  \n If the FIFO has no new data, @e sensors will be zero.
+ *  \n If the FIFO is disabled, @e sensors will be zero and this function will
+ *  return a non-zero error code.
+ *  @param[out] gyro        Gyro data in hardware units.
+ *  @param[out] accel       Accel data in hardware units.
+ *  @param[out] quat        3-axis quaternion data in hardware units.
+ *  @param[out] timestamp   Timestamp in milliseconds.
+ *  @param[out] sensors     Mask of sensors read from FIFO.
+ *  @param[out] more        Number of remaining packets.
+ *  @return     0 if successful.
+ */
+int dmp_read_fifo(short *gyro, short *accel, long *quat,
+    unsigned long *timestamp, short *sensors, unsigned char *more)
+{
+    unsigned char fifo_data[MAX_PACKET_LENGTH];
+
+    sensors[0] = 0;
+
+    /* Get a packet. */
+    if (mpu_read_fifo_stream(dmp.packet_length, fifo_data, more))
+        return -1;
+
+    if (dmp_parse_fifo_packet(fifo_data, gyro, accel, quat, sensors)) {
+        mpu_reset_fifo();
+        return -1;
+    }
 
     get_ms(timestamp);
     return 0;
@@ -51,6 +51,7 @@
 
 /* Set up functions. */
 int dmp_load_motion_driver_firmware(void);
+int dmp_probe_motion_driver_firmware(void);
 int dmp_set_fifo_rate(unsigned short rate);
 int dmp_get_fifo_rate(unsigned short *rate);
 int dmp_enable_feature(unsigned short mask);
@@ -93,5 +94,12 @@ int dmp_enable_gyro_cal(unsigned char enable);
 int dmp_read_fifo(short *gyro, short *accel, long *quat,
     unsigned long *timestamp, short *sensors, unsigned char *more);
 
+/* Split read functions. Use these if the FIFO is read asynchronously and the
+ * packet is parsed after the transfer completes.
+ */
+int dmp_get_packet_length(unsigned char *length);
+int dmp_parse_fifo_packet(const unsigned char *fifo_data, short *gyro,
+    short *accel, long *quat, short *sensors);
+
 #endif  /* #ifndef _INV_MPU_DMP_MOTION_DRIVER_H_ */
 
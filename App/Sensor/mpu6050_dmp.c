@@ -4,7 +4,75 @@
 #include "mpu6050_dmp.h"
 #include "inv_mpu.h"
 #include "inv_mpu_dmp_motion_driver.h"
-#include "math.h"
+#include "i2c.h"
+#include "Sensor/imu_filter.h"
+#include "Math/fast_math.h"
+#include "System/profiler.h"
+#include "System/timebase.h"
+#include "System/i2c_bus.h"
+
+// DMP单包最大长度：四元数16 + 加速度6 + 陀螺仪6 + 手势4
+#define DMP_PACKET_MAX_LEN  32
+// 原始数据模式FIFO单包：加速度6 + 陀螺仪6（按寄存器顺序）
+#define RAW_PACKET_LEN      12
+
+// 四元数模长平方的有效范围（Q30右移16位后计算，与驱动的FIFO_CORRUPTION_CHECK一致）
+#define QUAT_MAG_SQ_NORMALIZED  (1L << 28)
+#define QUAT_MAG_SQ_MIN         (QUAT_MAG_SQ_NORMALIZED - (1L << 24))
+#define QUAT_MAG_SQ_MAX         (QUAT_MAG_SQ_NORMALIZED + (1L << 24))
+
+typedef int (*dmp_parser_t)(const uint8_t *p, MPU6050_DataTypeDef *d);
+
+static int parse_balance(const uint8_t *p, MPU6050_DataTypeDef *d);
+static int parse_full(const uint8_t *p, MPU6050_DataTypeDef *d);
+
+// DMP功能配置表：包长度必须与dmp_enable_feature算出的一致
+static const struct {
+    MPU6050_DMP_ProfileInfoTypeDef info;
+    dmp_parser_t parse;
+} dmp_profiles[MPU6050_DMP_PROFILE_COUNT] = {
+    [MPU6050_DMP_PROFILE_BALANCE] = {
+        { "balance-minimal", DMP_FEATURE_6X_LP_QUAT | DMP_FEATURE_SEND_CAL_GYRO |
+                             DMP_FEATURE_GYRO_CAL, 16 + 6 },
+        parse_balance
+    },
+    [MPU6050_DMP_PROFILE_FULL] = {
+        { "full", DMP_FEATURE_6X_LP_QUAT | DMP_FEATURE_TAP | DMP_FEATURE_ANDROID_ORIENT |
+                  DMP_FEATURE_SEND_RAW_ACCEL | DMP_FEATURE_SEND_CAL_GYRO |
+                  DMP_FEATURE_GYRO_CAL, 16 + 6 + 6 + 4 },
+        parse_full
+    },
+};
+
+static MPU6050_ModeTypeDef sensor_mode = MPU6050_MODE_DMP;
+static uint16_t sensor_rate = DEFAULT_MPU_HZ;
+static MPU6050_DMP_ProfileTypeDef dmp_profile = MPU6050_DMP_PROFILE_FULL;
+static dmp_parser_t dmp_parser = parse_full;
+static IMU_FilterTypeDef imu_filter;
+
+// 异步读取上下文（DMA在中断中推进，主循环只处理FIFO复位）
+static volatile MPU6050_AsyncStateTypeDef async_state = MPU6050_ASYNC_IDLE;
+static volatile uint8_t async_enabled = 0;
+static volatile uint8_t reset_pending = 0;
+static uint64_t async_start_us;     // 当前DMA传输的启动时刻（超时检测）
+static uint8_t euler_mask = MPU6050_EULER_ALL;
+static uint8_t fifo_dev_addr;
+static uint8_t fifo_count_reg;
+static uint8_t fifo_rw_reg;
+static uint16_t fifo_max;
+static uint8_t packet_len;
+static uint64_t edge_us;                // 本次读取对应的INT边沿时刻
+static uint64_t rearm_us;               // 被跳过的INT边沿时刻
+static uint32_t sample_period_us;
+static volatile uint8_t rearm = 0;      // 传输期间来过INT
+static uint8_t batch_len;               // 本次整批读取的包数
+static uint8_t discard_left;            // 还需丢弃的旧包数
+static uint8_t discard_chunk;           // 当前丢弃段的包数
+static uint8_t count_buf[2];
+static uint8_t packet_buf[DMP_PACKET_MAX_LEN * MPU6050_DMP_BATCH_MAX];
+static MPU6050_DataTypeDef batch[MPU6050_DMP_BATCH_MAX];
+static MPU6050_AsyncStatsTypeDef async_stats;
+static MPU6050_BootInfoTypeDef boot_info;
 /* The sensors can be mounted onto the board in any orientation. The mounting
  * matrix seen below tells the MPL how to rotate the raw data from thei
  * driver(s).
@@ -92,10 +160,164 @@ static int run_self_test(void)
     return 0;
 }
 
+static int dmp_init(uint16_t rate);
+static void raw_to_body(const short *raw, int16_t *body);
+
+// 原始数据模式初始化：DMP关闭，陀螺仪+加速度进FIFO，数据就绪触发INT
+static int raw_init(uint16_t rate)
+{
+    int ret;
+    float gyro_sens;
+    struct int_param_s int_param;
+
+    ret = mpu_init(&int_param);
+    if(ret != 0)
+    {
+        return ERROR_MPU_INIT;
+    }
+    ret = mpu_set_sensors(INV_XYZ_GYRO | INV_XYZ_ACCEL);
+    if(ret != 0)
+    {
+        return ERROR_SET_SENSOR;
+    }
+    //采样率同时把DLPF设为其一半
+    ret = mpu_set_sample_rate(rate);
+    if(ret != 0)
+    {
+        return ERROR_SET_RATE;
+    }
+    //打开FIFO并使能数据就绪中断
+    ret = mpu_configure_fifo(INV_XYZ_GYRO | INV_XYZ_ACCEL);
+    if(ret != 0)
+    {
+        return ERROR_CONFIG_FIFO;
+    }
+    mpu_get_gyro_sens(&gyro_sens);
+    IMU_Filter_Init(&imu_filter, rate, MPU6050_RAW_FILTER_TAU_MS, gyro_sens);
+    return 0;
+}
+
+// DMP输出速率只能是内部采样率的整数分频，取不小于请求值的最近一档（与驱动的分频一致）
+static uint16_t dmp_round_rate(uint16_t rate)
+{
+    return MPU6050_DMP_MAX_HZ / (MPU6050_DMP_MAX_HZ / rate);
+}
+
+/**
+ * @brief  按模式初始化MPU6050
+ * @param  mode: MPU6050_MODE_DMP 或 MPU6050_MODE_RAW
+ * @param  rate_hz: 输出速率，>=MPU6050_MIN_HZ；DMP模式<=200，RAW模式<=1000
+ * @retval 0=成功，其余为ERROR_*错误码
+ */
+int MPU6050_Init(MPU6050_ModeTypeDef mode, uint16_t rate_hz)
+{
+    int ret;
+    uint32_t start = HAL_GetTick();
+    uint16_t max_hz = (mode == MPU6050_MODE_RAW) ? MPU6050_RAW_MAX_HZ : MPU6050_DMP_MAX_HZ;
+
+    if (rate_hz < MPU6050_MIN_HZ || rate_hz > max_hz)
+    {
+        return ERROR_SET_RATE;
+    }
+    if (mode == MPU6050_MODE_DMP)
+    {
+        rate_hz = dmp_round_rate(rate_hz);
+    }
+    sensor_mode = mode;
+    sensor_rate = rate_hz;
+    if (mode == MPU6050_MODE_RAW)
+    {
+        ret = raw_init(rate_hz);
+        boot_info.warm = 0;
+    }
+    else
+    {
+        ret = dmp_init(rate_hz);
+        boot_info.warm = mpu_firmware_was_resident();
+    }
+    if (ret == 0)
+    {
+        boot_info.init_ms = HAL_GetTick() - start;
+    }
+    return ret;
+}
+
+MPU6050_ModeTypeDef MPU6050_Get_Mode(void)
+{
+    return sensor_mode;
+}
+
+uint16_t MPU6050_Get_Rate(void)
+{
+    return sensor_rate;
+}
+
+/**
+ * @brief  运行中修改输出速率和数字低通，不重新初始化芯片（需先关闭异步读取）
+ * @param  rate_hz: >=MPU6050_MIN_HZ；DMP模式<=200，按200Hz的整数分频取不小于它的一档；RAW模式<=1000
+ * @param  lpf_hz: 数字低通截止频率，0=自动（采样率的一半），按驱动档位向下取整
+ * @retval 0=成功，ERROR_SET_RATE / ERROR_SET_FIFO_RATE
+ * @note   实际速率见MPU6050_Get_Rate；重新开启异步读取时FIFO被清空、采样周期随之更新
+ */
+int MPU6050_Set_Rate(uint16_t rate_hz, uint16_t lpf_hz)
+{
+    unsigned short actual;
+    uint16_t max_hz = (sensor_mode == MPU6050_MODE_RAW) ? MPU6050_RAW_MAX_HZ : MPU6050_DMP_MAX_HZ;
+
+    if (async_enabled || rate_hz < MPU6050_MIN_HZ || rate_hz > max_hz)
+    {
+        return ERROR_SET_RATE;
+    }
+    if (sensor_mode == MPU6050_MODE_RAW)
+    {
+        //采样率同时把DLPF设为其一半
+        if (mpu_set_sample_rate(rate_hz) || mpu_get_sample_rate(&actual))
+        {
+            return ERROR_SET_RATE;
+        }
+        IMU_Filter_Set_Rate(&imu_filter, actual, MPU6050_RAW_FILTER_TAU_MS);
+    }
+    else
+    {
+        //DMP内部采样率不变，只改输出分频；自动低通与dmp使能时一致
+        actual = dmp_round_rate(rate_hz);
+        if (dmp_set_fifo_rate(actual))
+        {
+            return ERROR_SET_FIFO_RATE;
+        }
+        if (lpf_hz == 0)
+        {
+            lpf_hz = MPU6050_DMP_MAX_HZ / 2;
+        }
+    }
+    if (lpf_hz != 0 && mpu_set_lpf(lpf_hz))
+    {
+        return ERROR_SET_RATE;
+    }
+    sensor_rate = actual;
+    return 0;
+}
+
+/**
+ * @brief  当前数字低通截止频率（Hz），0=读取失败或关闭
+ */
+uint16_t MPU6050_Get_Lpf(void)
+{
+    unsigned short lpf;
+    return mpu_get_lpf(&lpf) ? 0 : lpf;
+}
+
 int MPU6050_DMP_init(void)
+{
+    return MPU6050_Init(MPU6050_MODE_DMP, DEFAULT_MPU_HZ);
+}
+
+static int dmp_init(uint16_t rate)
 {
     int ret;
     struct int_param_s int_param;
+    //检测DMP固件是否仍在芯片中（只复位了MCU时），是则跳过芯片复位和固件加载
+    dmp_probe_motion_driver_firmware();
     //mpu_init
     ret = mpu_init(&int_param);
     if(ret != 0)
@@ -115,7 +337,7 @@ int MPU6050_DMP_init(void)
         return ERROR_CONFIG_FIFO;
     }
     //设置采样率
-    ret = mpu_set_sample_rate(DEFAULT_MPU_HZ);
+    ret = mpu_set_sample_rate(rate);
     if(ret != 0)
     {
         return ERROR_SET_RATE;
@@ -132,16 +354,14 @@ int MPU6050_DMP_init(void)
     {
         return ERROR_SET_ORIENTATION;
     }
-    //设置DMP功能
-    ret = dmp_enable_feature(DMP_FEATURE_6X_LP_QUAT | DMP_FEATURE_TAP |
-            DMP_FEATURE_ANDROID_ORIENT | DMP_FEATURE_SEND_RAW_ACCEL |
-            DMP_FEATURE_SEND_CAL_GYRO | DMP_FEATURE_GYRO_CAL);
+    //设置DMP功能（由功能配置决定包格式）
+    ret = dmp_enable_feature(dmp_profiles[dmp_profile].info.features);
     if(ret != 0)
     {
         return ERROR_ENABLE_FEATURE;
     }
     //设置输出速率
-    ret = dmp_set_fifo_rate(DEFAULT_MPU_HZ);
+    ret = dmp_set_fifo_rate(rate);
     if(ret != 0)
     {
         return ERROR_SET_FIFO_RATE;
@@ -166,35 +386,571 @@ int MPU6050_DMP_init(void)
     return 0;
 }
 
+/**
+ * @brief  静止状态下测量陀螺仪（和加速度计）零偏，阻塞约samples个采样周期
+ * @param  samples: 平均的样本数
+ * @param  gyro: 输出陀螺仪零偏（度/秒，Q16，传感器坐标系）
+ * @param  accel: 输出加速度计零偏（g，Q16），NULL=不测量；要求芯片水平放置，Z轴扣除1g
+ * @retval 0=成功, -1=异步读取未关闭或读取失败
+ * @note   需先调用MPU6050_DMP_Async_Disable，避免与DMA读取争用I2C
+ */
+int MPU6050_Measure_Bias(uint16_t samples, long *gyro, long *accel)
+{
+    short g[3], a[3];
+    int32_t gyro_sum[3] = {0, 0, 0}, accel_sum[3] = {0, 0, 0};
+    float gyro_sens;
+    unsigned short accel_sens;
+    uint32_t period_ms = 1000U / sensor_rate;
+
+    if (async_enabled || samples == 0)
+        return -1;
+    if (mpu_get_gyro_sens(&gyro_sens) || mpu_get_accel_sens(&accel_sens))
+        return -1;
+    for (uint16_t n = 0; n < samples; n++) {
+        // 数据寄存器按采样率更新，每个采样周期读一次
+        HAL_Delay(period_ms ? period_ms - 1 : 0);
+        if (mpu_get_gyro_reg(g, NULL) || mpu_get_accel_reg(a, NULL))
+            return -1;
+        for (uint8_t i = 0; i < 3; i++) {
+            gyro_sum[i] += g[i];
+            accel_sum[i] += a[i];
+        }
+    }
+    for (uint8_t i = 0; i < 3; i++)
+        gyro[i] = (long)(gyro_sum[i] * 65536.0f / (samples * gyro_sens));
+    if (accel) {
+        // 与自检相同：水平放置时Z轴读数应为±1g
+        int32_t one_g = (int32_t)accel_sens * samples;
+        accel_sum[2] -= (accel_sum[2] > 0) ? one_g : -one_g;
+        for (uint8_t i = 0; i < 3; i++)
+            accel[i] = (long)(((int64_t)accel_sum[i] << 16) / ((int32_t)samples * accel_sens));
+    }
+    return 0;
+}
+
+/**
+ * @brief  写入已标定的零偏（初始化之后、开启异步读取之前调用）
+ * @param  gyro: 陀螺仪零偏（度/秒，Q16，传感器坐标系）
+ * @param  accel: 加速度计零偏（g，Q16），NULL=不写
+ * @retval 0=成功, -1=写入DMP失败
+ * @note   DMP模式写入DMP（之后DMP的陀螺自动校准继续修正）；RAW模式把俯仰轴零偏交给互补滤波
+ */
+int MPU6050_Set_Bias(const long *gyro, const long *accel)
+{
+    long bias[3];
+    float gyro_sens;
+    unsigned short accel_sens;
+
+    if (mpu_get_gyro_sens(&gyro_sens))
+        return -1;
+    if (sensor_mode == MPU6050_MODE_RAW) {
+        short raw[3];
+        int16_t body[3];
+        for (uint8_t i = 0; i < 3; i++)
+            raw[i] = (short)(gyro[i] * gyro_sens / 65536.0f);
+        raw_to_body(raw, body);
+        IMU_Filter_Set_Bias(&imu_filter, body[1]);
+        return 0;
+    }
+
+    // 与自检结果的换算相同：Q16物理量 -> Q16硬件单位
+    for (uint8_t i = 0; i < 3; i++)
+        bias[i] = (long)(gyro[i] * gyro_sens);
+    if (dmp_set_gyro_bias(bias))
+        return -1;
+    if (accel) {
+        if (mpu_get_accel_sens(&accel_sens))
+            return -1;
+        for (uint8_t i = 0; i < 3; i++)
+            bias[i] = accel[i] * accel_sens;
+        if (dmp_set_accel_bias(bias))
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  选择DMP功能配置（在MPU6050_Init之前调用）
+ * @param  profile: MPU6050_DMP_PROFILE_BALANCE 或 MPU6050_DMP_PROFILE_FULL
+ * @retval 0=成功, -1=配置无效
+ */
+int MPU6050_DMP_Set_Profile(MPU6050_DMP_ProfileTypeDef profile)
+{
+    if (profile >= MPU6050_DMP_PROFILE_COUNT)
+        return -1;
+    dmp_profile = profile;
+    return 0;
+}
+
+/**
+ * @brief  获取当前DMP功能配置
+ */
+const MPU6050_DMP_ProfileInfoTypeDef *MPU6050_DMP_Get_Profile(void)
+{
+    return &dmp_profiles[dmp_profile].info;
+}
+
+/**
+ * @brief  获取最近一次成功初始化的耗时和是否复用了常驻固件
+ */
+const MPU6050_BootInfoTypeDef *MPU6050_DMP_Get_Boot_Info(void)
+{
+    return &boot_info;
+}
+
+// 四元数转欧拉角（度），只计算mask中要求的角度
+static void quat_to_euler(const long *quat, uint8_t mask, float *pitch, float *roll, float *yaw)
+{
+    float q0 = quat[0] * (1.0f / Q30);
+    float q1 = quat[1] * (1.0f / Q30);
+    float q2 = quat[2] * (1.0f / Q30);
+    float q3 = quat[3] * (1.0f / Q30);
+
+    if (mask & MPU6050_EULER_PITCH)
+        *pitch = -fast_asinf(2.0f * (q1 * q3 - q0 * q2)) * FAST_RAD_TO_DEG;
+    if (mask & MPU6050_EULER_ROLL)
+        *roll = fast_atan2f(2.0f * (q2 * q3 + q0 * q1), 1.0f - 2.0f * (q1 * q1 + q2 * q2)) * FAST_RAD_TO_DEG;
+    if (mask & MPU6050_EULER_YAW)
+        *yaw = fast_atan2f(-2.0f * (q0 * q3 + q1 * q2), q0 * q0 + q1 * q1 - q2 * q2 - q3 * q3) * FAST_RAD_TO_DEG;
+}
+
+/**
+ * @brief  设置DMA异步读取时需要计算的欧拉角（未选中的角度不计算、不更新）
+ * @param  mask: MPU6050_EULER_PITCH | MPU6050_EULER_ROLL | MPU6050_EULER_YAW
+ */
+void MPU6050_DMP_Set_Euler_Mask(uint8_t mask)
+{
+    euler_mask = mask & MPU6050_EULER_ALL;
+}
+
 int MPU6050_DMP_Get_Date(float *pitch, float *roll, float *yaw)
 {
-    float q0 = 1.0f, q1 = 0.0f, q2 = 0.0f, q3 = 0.0f;
+    return MPU6050_DMP_Get_Euler(MPU6050_EULER_ALL, pitch, roll, yaw);
+}
+
+/**
+ * @brief  阻塞读取一包FIFO并只计算需要的欧拉角
+ * @param  mask: 需要计算的角度，未选中的指针可传NULL
+ * @retval 0=成功, -1=读取失败
+ */
+int MPU6050_DMP_Get_Euler(uint8_t mask, float *pitch, float *roll, float *yaw)
+{
     short gyro[3];
     short accel[3];
     long quat[4];
     unsigned long timestamp;
     short sensors;
     unsigned char more;
-    if(dmp_read_fifo(gyro, accel, quat, &timestamp, &sensors, &more))
+    uint8_t n = 0;
+    if (sensor_mode != MPU6050_MODE_DMP)
     {
         return -1;
     }
+    // 一次读空积压，只使用最新的一包
+    do
+    {
+        if(dmp_read_fifo(gyro, accel, quat, &timestamp, &sensors, &more))
+        {
+            return -1;
+        }
+    } while(more && ++n < MPU6050_DMP_BATCH_MAX);
 
     if(sensors & INV_WXYZ_QUAT)
     {
-        q0 = quat[0] / Q30;
-        q1 = quat[1] / Q30;
-        q2 = quat[2] / Q30;
-        q3 = quat[3] / Q30;
+        quat_to_euler(quat, mask, pitch, roll, yaw);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief  开启DMA异步读取FIFO（需在MPU6050_DMP_init成功之后调用）
+ * @retval 0=成功, -1=DMP未使能或包长度无效
+ */
+int MPU6050_DMP_Async_Enable(void)
+{
+    unsigned char dev_addr, count_reg, rw_reg, length;
+    unsigned short max_fifo, rate;
+
+    async_enabled = 0;
+    if (mpu_get_fifo_stream_regs(&dev_addr, &count_reg, &rw_reg, &max_fifo))
+        return -1;
+    if (sensor_mode == MPU6050_MODE_RAW) {
+        length = RAW_PACKET_LEN;
+        rate = sensor_rate;
+    } else {
+        // 专用解析函数按固定偏移取数，包长度不符说明配置表和驱动不一致
+        if (dmp_get_packet_length(&length) || length != dmp_profiles[dmp_profile].info.packet_len)
+            return -1;
+        dmp_parser = dmp_profiles[dmp_profile].parse;
+        if (dmp_get_fifo_rate(&rate) || rate == 0)
+            rate = DEFAULT_MPU_HZ;
+    }
+
+    fifo_dev_addr = dev_addr;
+    fifo_count_reg = count_reg;
+    fifo_rw_reg = rw_reg;
+    fifo_max = max_fifo;
+    packet_len = length;
+    sample_period_us = 1000000U / rate;
+
+    // 丢弃初始化期间积累的旧数据
+    mpu_reset_fifo();
+    reset_pending = 0;
+    rearm = 0;
+    async_state = MPU6050_ASYNC_IDLE;
+    async_enabled = 1;
+    return 0;
+}
+
+// DMA传输超时（SCL/SDA被拉住或丢了完成中断）：停掉DMA通道，记一次总线超时，
+// 总线恢复和FIFO复位在主循环中执行；调用者已确认状态非空闲且已超时
+static void async_abort(void)
+{
+    HAL_DMA_Abort(&hdma_i2c2_rx);
+    async_state = MPU6050_ASYNC_IDLE;
+    reset_pending = 1;
+    async_stats.i2c_errors++;
+    I2C_Bus_Complete_Error(&hi2c2, HAL_TIMEOUT);
+}
+
+/**
+ * @brief  关闭DMA异步读取，等待正在进行的传输结束后返回（主循环中调用）
+ * @retval 0=成功，ERROR_ASYNC_TIMEOUT=传输超过MPU6050_ASYNC_TIMEOUT_US未结束，
+ *         已中止DMA并恢复总线（FIFO在重新开启异步读取时复位）
+ */
+int MPU6050_DMP_Async_Disable(void)
+{
+    uint8_t stalled = 0;
+
+    async_enabled = 0;
+    while (async_state != MPU6050_ASYNC_IDLE && !stalled) {
+        __NOP();
+        __disable_irq();
+        if (async_state != MPU6050_ASYNC_IDLE && Timebase_Now_Us() - async_start_us > MPU6050_ASYNC_TIMEOUT_US) {
+            async_abort();
+            stalled = 1;
+        }
+        __enable_irq();
+    }
+    if (!stalled) {
+        return 0;
+    }
+    // 调用者接着要做阻塞读写，就地恢复总线，不等主循环
+    if (I2C_Bus_Recover_Pending(&hi2c2)) {
+        I2C_Bus_Recover(&hi2c2);
+    }
+    return ERROR_ASYNC_TIMEOUT;
+}
+
+// 启动一次FIFO相关的DMA读取，失败则回到空闲
+static void async_start(MPU6050_AsyncStateTypeDef state, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    async_state = state;
+    async_start_us = Timebase_Now_Us();
+    if (I2C_Bus_Check(&hi2c2, HAL_I2C_Mem_Read_DMA(&hi2c2, fifo_dev_addr, reg, I2C_MEMADD_SIZE_8BIT, buf, len)) != 0) {
+        async_stats.i2c_errors++;
+        // 丢弃/数据阶段失败时FIFO读指针可能已错位
+        if (state != MPU6050_ASYNC_READ_COUNT)
+            reset_pending = 1;
+        async_state = MPU6050_ASYNC_IDLE;
+    }
+}
+
+/**
+ * @brief  INT边沿触发：启动DMA读取FIFO_COUNT（在EXTI中断中调用）
+ * @note   F1的HAL仍以轮询方式发送设备地址和寄存器地址，只有数据阶段走DMA
+ */
+void MPU6050_DMP_Start_Read(void)
+{
+    // 先取时间戳，尽量贴近INT边沿
+    uint64_t now = Timebase_Now_Us();
+
+    if (!async_enabled || reset_pending)
+        return;
+    if (async_state != MPU6050_ASYNC_IDLE || HAL_I2C_GetState(&hi2c2) != HAL_I2C_STATE_READY) {
+        // 本次传输结束后立即再读一次，不必等下一个INT
+        async_stats.busy_skips++;
+        rearm_us = now;
+        rearm = 1;
+        return;
+    }
+
+    edge_us = now;
+    PROF_BEGIN(PROF_STAGE_FIFO_READ);
+    async_start(MPU6050_ASYNC_READ_COUNT, fifo_count_reg, count_buf, 2);
+}
+
+/**
+ * @brief  主循环中调用：执行中断里无法完成的总线恢复和FIFO复位（都含延时）
+ */
+void MPU6050_DMP_Process(void)
+{
+    // DMA传输迟迟不结束（SCL/SDA被拉住或丢了完成中断），按超时处理
+    __disable_irq();
+    if (async_state != MPU6050_ASYNC_IDLE && Timebase_Now_Us() - async_start_us > MPU6050_ASYNC_TIMEOUT_US) {
+        async_abort();
+    }
+    __enable_irq();
+
+    if (I2C_Bus_Recover_Pending(&hi2c2)) {
+        // 先挡住新的INT；被打断的传输可能让FIFO读指针错位，恢复后一并复位FIFO重新对齐
+        reset_pending = 1;
+        if (async_state == MPU6050_ASYNC_IDLE) {
+            I2C_Bus_Recover(&hi2c2);
+        }
+    }
+    if (reset_pending && async_state == MPU6050_ASYNC_IDLE && !I2C_Bus_Recover_Pending(&hi2c2)) {
+        mpu_reset_fifo();
+        reset_pending = 0;
+    }
+}
+
+/**
+ * @brief  获取异步读取统计
+ */
+const MPU6050_AsyncStatsTypeDef *MPU6050_DMP_Get_Async_Stats(void)
+{
+    return &async_stats;
+}
+
+/**
+ * @brief  新数据就绪回调（在DMA中断中调用，用户可重写）
+ * @param  data: 一批数据中最新的一包，仅在回调内有效
+ */
+__weak void MPU6050_DMP_DataReadyCallback(const MPU6050_DataTypeDef *data)
+{
+    UNUSED(data);
+}
+
+/**
+ * @brief  一批数据就绪回调（在DataReadyCallback之前调用，用户可重写，用于滤波/记录）
+ * @param  batch: 按时间从旧到新排列，batch[count-1]为最新一包，仅在回调内有效
+ * @param  count: 包数（1~MPU6050_DMP_BATCH_MAX）
+ */
+__weak void MPU6050_DMP_BatchReadyCallback(const MPU6050_DataTypeDef *batch, uint8_t count)
+{
+    UNUSED(batch);
+    UNUSED(count);
+}
+
+// 读取下一段：先丢弃超出批量上限的旧包，再一次性读出整批
+static void async_read_next(void)
+{
+    if (discard_left) {
+        uint8_t n = (discard_left > MPU6050_DMP_BATCH_MAX) ? MPU6050_DMP_BATCH_MAX : discard_left;
+        discard_chunk = n;
+        async_start(MPU6050_ASYNC_READ_DISCARD, fifo_rw_reg, packet_buf, (uint16_t)n * packet_len);
+    } else {
+        async_start(MPU6050_ASYNC_READ_PACKET, fifo_rw_reg, packet_buf, (uint16_t)batch_len * packet_len);
+    }
+}
+
+// FIFO_COUNT读取完成：判断溢出，计算本次要读的完整包数
+static void async_count_done(void)
+{
+    uint16_t count = ((uint16_t)count_buf[0] << 8) | count_buf[1];
+    uint16_t packets;
+
+    if (count >= fifo_max) {
+        // FIFO溢出，数据已错位，交给主循环复位
+        async_stats.overflows++;
+        reset_pending = 1;
+        async_state = MPU6050_ASYNC_IDLE;
+        return;
+    }
+    packets = count / packet_len;
+    if (packets == 0) {
+        async_state = MPU6050_ASYNC_IDLE;
+        return;
+    }
+
+    // 积压超过批量上限时只保留最新的一批，保证延迟有界
+    if (packets > MPU6050_DMP_BATCH_MAX) {
+        discard_left = (uint8_t)(packets - MPU6050_DMP_BATCH_MAX);
+        packets = MPU6050_DMP_BATCH_MAX;
+    } else {
+        discard_left = 0;
+    }
+    batch_len = (uint8_t)packets;
+    async_read_next();
+}
 
-        *pitch = -1.0*(asin(2 * q1 * q3 - 2 * q0 * q2) * 57.3); // pitch
-        *roll = atan2(2 * q2 * q3 + 2 * q0 * q1, -2 * q1 * q1 - 2 * q2 * q2 + 1) * 57.3; // roll
-        *yaw = atan2(-2 * (q0 * q3 + q1 * q2), q0 * q0 + q1 * q1 - q2 * q2 - q3 * q3) * 57.3; // yaw
+// 丢弃段读取完成
+static void async_discard_done(void)
+{
+    async_stats.dropped += discard_chunk;
+    async_stats.bytes += (uint32_t)discard_chunk * packet_len;
+    discard_left -= discard_chunk;
+    async_read_next();
+}
+
+// 传感器坐标系 -> 机体坐标系（与DMP使用同一个安装矩阵）
+static void raw_to_body(const short *raw, int16_t *body)
+{
+    for (uint8_t i = 0; i < 3; i++) {
+        int32_t v = gyro_orientation[i * 3 + 0] * raw[0] +
+                    gyro_orientation[i * 3 + 1] * raw[1] +
+                    gyro_orientation[i * 3 + 2] * raw[2];
+        body[i] = (int16_t)(v > 32767 ? 32767 : v);
     }
+}
 
+static inline int32_t be32(const uint8_t *p)
+{
+    return (int32_t)(((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+                     ((uint32_t)p[2] << 8) | p[3]);
+}
+
+static inline short be16(const uint8_t *p)
+{
+    return (short)((p[0] << 8) | p[1]);
+}
+
+// 解析包头的Q30四元数，模长偏离1说明FIFO错位
+static int parse_quat(const uint8_t *p, long *quat)
+{
+    int32_t q0 = be32(p), q1 = be32(p + 4), q2 = be32(p + 8), q3 = be32(p + 12);
+    int32_t w = q0 >> 16, x = q1 >> 16, y = q2 >> 16, z = q3 >> 16;
+    int32_t mag_sq = w * w + x * x + y * y + z * z;
+
+    quat[0] = q0;
+    quat[1] = q1;
+    quat[2] = q2;
+    quat[3] = q3;
+    return (mag_sq < QUAT_MAG_SQ_MIN || mag_sq > QUAT_MAG_SQ_MAX) ? -1 : 0;
+}
+
+// balance-minimal：四元数[0,16) + 校准陀螺仪[16,22)
+static int parse_balance(const uint8_t *p, MPU6050_DataTypeDef *d)
+{
+    if (parse_quat(p, d->quat)) {
+        d->sensors = 0;
+        return -1;
+    }
+    d->gyro[0] = be16(p + 16);
+    d->gyro[1] = be16(p + 18);
+    d->gyro[2] = be16(p + 20);
+    d->sensors = INV_WXYZ_QUAT | INV_XYZ_GYRO;
     return 0;
 }
 
+// full：包尾带手势数据，交给驱动解析并分发敲击/方向回调
+static int parse_full(const uint8_t *p, MPU6050_DataTypeDef *d)
+{
+    return dmp_parse_fifo_packet(p, d->gyro, d->accel, d->quat, &d->sensors);
+}
+
+// 解析一包原始数据并更新互补滤波
+static void raw_parse_packet(const uint8_t *p, MPU6050_DataTypeDef *d)
+{
+    int16_t gyro_b[3], accel_b[3];
+
+    for (uint8_t i = 0; i < 3; i++) {
+        d->accel[i] = (short)((p[2 * i] << 8) | p[2 * i + 1]);
+        d->gyro[i] = (short)((p[6 + 2 * i] << 8) | p[6 + 2 * i + 1]);
+    }
+    d->sensors = INV_XYZ_GYRO | INV_XYZ_ACCEL;
+
+    raw_to_body(d->gyro, gyro_b);
+    raw_to_body(d->accel, accel_b);
+    IMU_Filter_Update(&imu_filter, gyro_b[1], accel_b[0], accel_b[2]);
+    if (IMU_Filter_Ready(&imu_filter)) {
+        d->pitch = imu_filter.angle * (1.0f / 65536.0f);
+        d->pitch_rate = imu_filter.rate * (1.0f / 65536.0f);
+        d->sensors |= MPU6050_SENSOR_ATTITUDE;
+    }
+}
+
+// 整批读取完成：逐包解析，最新一包交给控制环
+static void async_packet_done(void)
+{
+    uint8_t n;
+
+    PROF_END(PROF_STAGE_FIFO_READ);
+    async_state = MPU6050_ASYNC_IDLE;
+    async_stats.bytes += (uint32_t)batch_len * packet_len;
+    for (n = 0; n < batch_len; n++) {
+        MPU6050_DataTypeDef *d = &batch[n];
+        if (sensor_mode == MPU6050_MODE_RAW) {
+            PROF_BEGIN(PROF_STAGE_QUAT);
+            raw_parse_packet(packet_buf + (uint16_t)n * packet_len, d);
+            PROF_END(PROF_STAGE_QUAT);
+            continue;
+        }
+        PROF_BEGIN(PROF_STAGE_PARSE);
+        int bad = dmp_parser(packet_buf + (uint16_t)n * packet_len, d);
+        PROF_END(PROF_STAGE_PARSE);
+        if (bad) {
+            // 四元数越界说明FIFO错位，需要复位；之前解析成功的包仍然交付
+            async_stats.bad_packets++;
+            reset_pending = 1;
+            break;
+        }
+        if (d->sensors & INV_WXYZ_QUAT) {
+            PROF_BEGIN(PROF_STAGE_QUAT);
+            quat_to_euler(d->quat, euler_mask, &d->pitch, &d->roll, &d->yaw);
+            PROF_END(PROF_STAGE_QUAT);
+        }
+    }
+
+    if (n > 0) {
+        // 最新一包对应本次INT，更早的包按采样周期倒推时间戳
+        for (uint8_t i = 0; i < n; i++) {
+            batch[i].timestamp = edge_us - (uint64_t)(n - 1 - i) * sample_period_us;
+        }
+        async_stats.packets += n;
+        if (n > async_stats.max_batch)
+            async_stats.max_batch = n;
+        MPU6050_DMP_BatchReadyCallback(batch, n);
+        MPU6050_DMP_DataReadyCallback(&batch[n - 1]);
+    }
+
+    // 传输期间有INT被跳过，立即补读
+    if (rearm && !reset_pending && async_enabled) {
+        rearm = 0;
+        edge_us = rearm_us;
+        PROF_BEGIN(PROF_STAGE_FIFO_READ);
+        async_start(MPU6050_ASYNC_READ_COUNT, fifo_count_reg, count_buf, 2);
+    }
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c != &hi2c2)
+        return;
+
+    switch (async_state) {
+        case MPU6050_ASYNC_READ_COUNT:
+            async_count_done();
+            break;
+        case MPU6050_ASYNC_READ_DISCARD:
+            async_discard_done();
+            break;
+        case MPU6050_ASYNC_READ_PACKET:
+            async_packet_done();
+            break;
+        default:
+            break;
+    }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    // 错误分类和恢复请求交给总线层，恢复在主循环中执行
+    I2C_Bus_Complete_Error(hi2c, HAL_ERROR);
+    if (hi2c != &hi2c2)
+        return;
+
+    if (async_state != MPU6050_ASYNC_IDLE) {
+        // 数据段读到一半出错时FIFO读指针已错位
+        if (async_state != MPU6050_ASYNC_READ_COUNT)
+            reset_pending = 1;
+        async_stats.i2c_errors++;
+        async_state = MPU6050_ASYNC_IDLE;
+    }
+}
+
 /**
  * @brief  配置MPU6050的DMP中断功能
  * @param  enable: 中断使能标志 (1=使能, 0=禁用)
@@ -4,6 +4,9 @@
 
 #ifndef MPU6050_DMP_H
 #define MPU6050_DMP_H
+
+#include "stm32f1xx_hal.h"
+
 #define ERROR_MPU_INIT      -1
 #define ERROR_SET_SENSOR    -2
 #define ERROR_CONFIG_FIFO   -3
@@ -14,11 +17,107 @@
 #define ERROR_SET_FIFO_RATE         -8
 #define ERROR_SELF_TEST             -9
 #define ERROR_DMP_STATE             -10
+#define ERROR_ASYNC_TIMEOUT         -11     // 关闭异步读取时DMA传输超时未结束
 
 #define DEFAULT_MPU_HZ  100
+#define MPU6050_DMP_MAX_HZ      200     // DMP输出速率上限（DMP内部固定200Hz采样，输出按整数分频）
+#define MPU6050_RAW_MAX_HZ      1000    // 原始数据模式采样率上限（DLPF开启时）
+#define MPU6050_RAW_DEFAULT_HZ  500
+#define MPU6050_MIN_HZ          20      // 输出速率下限：再低控制环已失去平衡能力，dt也超出PID定点换算范围
+#define MPU6050_RAW_FILTER_TAU_MS   500 // 原始数据模式互补滤波时间常数
+#define MPU6050_DMP_BATCH_MAX   8   // 一次突发读取的最大包数，更早的积压被丢弃
+#define MPU6050_ASYNC_TIMEOUT_US    10000   // DMA传输超时（满批8x32字节@400kHz约6.5ms），超时后恢复总线
 #define Q30  1073741824.0f
 
+// 欧拉角计算掩码
+#define MPU6050_EULER_PITCH 0x01
+#define MPU6050_EULER_ROLL  0x02
+#define MPU6050_EULER_YAW   0x04
+#define MPU6050_EULER_ALL   (MPU6050_EULER_PITCH | MPU6050_EULER_ROLL | MPU6050_EULER_YAW)
+
+// 有效数据掩码扩展：pitch/pitch_rate由MCU互补滤波给出（RAW模式）
+#define MPU6050_SENSOR_ATTITUDE 0x0200
+
+// 传感器工作模式（初始化时选择）
+typedef enum {
+  MPU6050_MODE_DMP = 0,   // DMP融合四元数，最高200Hz，有内部延迟
+  MPU6050_MODE_RAW        // FIFO原始陀螺仪+加速度，最高1kHz，MCU定点互补滤波
+} MPU6050_ModeTypeDef;
+
+// DMP功能配置：决定FIFO包布局，每种配置用固定偏移的专用解析函数
+typedef enum {
+  MPU6050_DMP_PROFILE_BALANCE = 0,  // 6轴四元数+校准陀螺仪，22字节/包
+  MPU6050_DMP_PROFILE_FULL,         // 另加原始加速度、敲击/方向手势，32字节/包
+  MPU6050_DMP_PROFILE_COUNT
+} MPU6050_DMP_ProfileTypeDef;
+
+// DMP功能配置描述
+typedef struct {
+  const char *name;
+  uint16_t features;    // DMP_FEATURE_*
+  uint8_t packet_len;   // 每包字节数
+} MPU6050_DMP_ProfileInfoTypeDef;
+
+// DMA异步读取FIFO的状态
+typedef enum {
+  MPU6050_ASYNC_IDLE = 0,     // 空闲，等待INT
+  MPU6050_ASYNC_READ_COUNT,   // 正在DMA读取FIFO_COUNT
+  MPU6050_ASYNC_READ_DISCARD, // 正在DMA读出并丢弃超出批量上限的旧包
+  MPU6050_ASYNC_READ_PACKET   // 正在DMA整批读取DMP数据包
+} MPU6050_AsyncStateTypeDef;
+
+// 一帧解析完成的DMP数据
+typedef struct {
+  float pitch;          // 俯仰角（度）
+  float roll;           // 横滚角（度）
+  float yaw;            // 偏航角（度）
+  float pitch_rate;     // 俯仰角速度（度/秒，仅RAW模式）
+  short gyro[3];        // 陀螺仪原始值
+  short accel[3];       // 加速度计原始值
+  long quat[4];         // Q30格式四元数
+  short sensors;        // 有效数据掩码（INV_XYZ_GYRO等）
+  uint64_t timestamp;   // INT边沿时刻（us，见Timebase_Now_Us）
+} MPU6050_DataTypeDef;
+
+// 初始化信息（启动计时用）
+typedef struct {
+  uint32_t init_ms;     // MPU6050_DMP_init耗时
+  uint8_t warm;         // 1=DMP固件仍在芯片中，跳过了芯片复位和固件加载
+} MPU6050_BootInfoTypeDef;
+
+// 异步读取统计（调试用）
+typedef struct {
+  uint32_t packets;     // 成功解析的包数
+  uint32_t bytes;       // 读取的数据包字节数（含丢弃的包，不含FIFO_COUNT）
+  uint32_t busy_skips;  // INT到来时上一次传输未完成的次数（传输结束后补读）
+  uint32_t dropped;     // 积压超过批量上限而丢弃的包数
+  uint32_t max_batch;   // 单次突发读取的最大包数
+  uint32_t overflows;   // FIFO溢出次数
+  uint32_t bad_packets; // 四元数校验失败次数
+  uint32_t i2c_errors;  // I2C/DMA错误及传输超时次数（总线统计见I2C_Bus_Get_Stats）
+} MPU6050_AsyncStatsTypeDef;
+
+int MPU6050_Init(MPU6050_ModeTypeDef mode, uint16_t rate_hz);
+MPU6050_ModeTypeDef MPU6050_Get_Mode(void);
+uint16_t MPU6050_Get_Rate(void);
+int MPU6050_Set_Rate(uint16_t rate_hz, uint16_t lpf_hz);
+uint16_t MPU6050_Get_Lpf(void);
 int MPU6050_DMP_init(void);
+const MPU6050_BootInfoTypeDef *MPU6050_DMP_Get_Boot_Info(void);
 int MPU6050_DMP_Get_Date(float *pitch, float *roll, float *yaw);
+int MPU6050_DMP_Get_Euler(uint8_t mask, float *pitch, float *roll, float *yaw);
+void MPU6050_DMP_Set_Euler_Mask(uint8_t mask);
+int MPU6050_Measure_Bias(uint16_t samples, long *gyro, long *accel);
+int MPU6050_Set_Bias(const long *gyro, const long *accel);
+int MPU6050_DMP_Set_Profile(MPU6050_DMP_ProfileTypeDef profile);
+const MPU6050_DMP_ProfileInfoTypeDef *MPU6050_DMP_Get_Profile(void);
+
+int MPU6050_DMP_Async_Enable(void);
+int MPU6050_DMP_Async_Disable(void);
+void MPU6050_DMP_Start_Read(void);
+void MPU6050_DMP_Process(void);
+const MPU6050_AsyncStatsTypeDef *MPU6050_DMP_Get_Async_Stats(void);
+void MPU6050_DMP_DataReadyCallback(const MPU6050_DataTypeDef *data);
+void MPU6050_DMP_BatchReadyCallback(const MPU6050_DataTypeDef *batch, uint8_t count);
 
 #endif //MPU6050_DMP_H
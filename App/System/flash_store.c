@@ -0,0 +1,195 @@
+#include "System/flash_store.h"
+#include "Math/crc16.h"
+#include <string.h>
+
+// 页格式：[标志 4][序号 4][记录...]，标志最后写入，序号大的页有效
+// 记录格式：[标签 2][长度 2][数据，补齐到半字][CRC16 2]，CRC覆盖标签、长度和数据
+#define PAGE_MAGIC      0x53465754u     // "TWFS"
+#define PAGE_HDR_LEN    8U
+#define REC_HDR_LEN     4U
+#define REC_SPACE(len)  (REC_HDR_LEN + (((uint32_t)(len) + 1U) & ~1U) + 2U)
+#define TAG_EMPTY       0xFFFFu
+
+static uintptr_t active;        // 当前页地址，0=存储区为空
+static uint32_t active_seq;
+static uint32_t write_off;      // 下一条记录在页内的偏移
+
+static inline uint16_t rd16(uintptr_t addr) {
+  return *(volatile const uint16_t *)addr;
+}
+
+static inline uint32_t rd32(uintptr_t addr) {
+  return *(volatile const uint32_t *)addr;
+}
+
+static uintptr_t page_addr(uint8_t i) {
+  return FLASH_STORE_BASE + (uintptr_t)i * FLASH_STORE_PAGE_SIZE;
+}
+
+// 读取off处记录的标签和长度，返回0表示日志结束或记录头损坏
+static uint8_t rec_at(uintptr_t page, uint32_t off, uint16_t *tag, uint16_t *len) {
+  if (off + REC_SPACE(0) > FLASH_STORE_PAGE_SIZE) return 0;
+  *tag = rd16(page + off);
+  *len = rd16(page + off + 2);
+  if (*tag == TAG_EMPTY) return 0;
+  if (*len > FLASH_STORE_MAX_LEN || off + REC_SPACE(*len) > FLASH_STORE_PAGE_SIZE) return 0;
+  return 1;
+}
+
+static uint8_t rec_valid(uintptr_t rec, uint16_t len) {
+  uint16_t crc = crc16_update(CRC16_INIT, (const uint8_t *)rec, REC_HDR_LEN + len);
+  return rd16(rec + REC_SPACE(len) - 2) == crc;
+}
+
+// 日志末尾偏移；记录头写了一半时返回页大小，下次写入先整理
+static uint32_t scan_end(uintptr_t page) {
+  uint32_t off = PAGE_HDR_LEN;
+  uint16_t tag, len;
+  while (rec_at(page, off, &tag, &len)) {
+    off += REC_SPACE(len);
+  }
+  if (off + REC_SPACE(0) > FLASH_STORE_PAGE_SIZE) return FLASH_STORE_PAGE_SIZE;
+  return (rd16(page + off) == TAG_EMPTY && rd16(page + off + 2) == TAG_EMPTY) ? off : FLASH_STORE_PAGE_SIZE;
+}
+
+// 页内该标签最后一条完整记录，0=没有
+static uintptr_t find(uintptr_t page, uint16_t tag, uint16_t *len) {
+  uintptr_t found = 0;
+  uint32_t off = PAGE_HDR_LEN;
+  uint16_t t, l;
+  while (rec_at(page, off, &t, &l)) {
+    if (t == tag && rec_valid(page + off, l)) {
+      found = page + off;
+      *len = l;
+    }
+    off += REC_SPACE(l);
+  }
+  return found;
+}
+
+static int program16(uintptr_t addr, uint16_t v) {
+  return HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, addr, v) == HAL_OK ? 0 : ERROR_FLASH_WRITE;
+}
+
+// 按标签、长度、数据、CRC的顺序写入一条记录
+static int program_record(uintptr_t addr, uint16_t tag, const uint8_t *data, uint16_t len) {
+  uint8_t hdr[REC_HDR_LEN] = { (uint8_t)tag, (uint8_t)(tag >> 8), (uint8_t)len, (uint8_t)(len >> 8) };
+  uint16_t crc = crc16_update(crc16_update(CRC16_INIT, hdr, REC_HDR_LEN), data, len);
+  uint16_t i;
+
+  if (program16(addr, tag) || program16(addr + 2, len)) return ERROR_FLASH_WRITE;
+  addr += REC_HDR_LEN;
+  for (i = 0; i + 1 < len; i += 2, addr += 2) {
+    if (program16(addr, (uint16_t)(data[i] | (data[i + 1] << 8)))) return ERROR_FLASH_WRITE;
+  }
+  if (i < len) {
+    if (program16(addr, (uint16_t)(data[i] | 0xFF00u))) return ERROR_FLASH_WRITE;
+    addr += 2;
+  }
+  return program16(addr, crc);
+}
+
+// 擦除另一页，搬移其余标签的最新记录并写入新记录，最后写页头切换
+static int compact(uint16_t tag, const uint8_t *data, uint16_t len) {
+  uintptr_t dst = (active == page_addr(0)) ? page_addr(1) : page_addr(0);
+  FLASH_EraseInitTypeDef erase = {0};
+  uint32_t page_error;
+  uint32_t off = PAGE_HDR_LEN;
+  uint32_t seq = active ? active_seq + 1 : 1;
+
+  erase.TypeErase = FLASH_TYPEERASE_PAGES;
+  erase.PageAddress = dst;
+  erase.NbPages = 1;
+  if (HAL_FLASHEx_Erase(&erase, &page_error) != HAL_OK) return ERROR_FLASH_WRITE;
+
+  if (active) {
+    uint32_t src = PAGE_HDR_LEN;
+    uint16_t t, l, latest_len;
+    while (rec_at(active, src, &t, &l)) {
+      if (t != tag && find(active, t, &latest_len) == active + src) {
+        if (off + REC_SPACE(l) > FLASH_STORE_PAGE_SIZE) return ERROR_FLASH_FULL;
+        if (program_record(dst + off, t, (const uint8_t *)(active + src + REC_HDR_LEN), l)) return ERROR_FLASH_WRITE;
+        off += REC_SPACE(l);
+      }
+      src += REC_SPACE(l);
+    }
+  }
+  if (off + REC_SPACE(len) > FLASH_STORE_PAGE_SIZE) return ERROR_FLASH_FULL;
+  if (program_record(dst + off, tag, data, len)) return ERROR_FLASH_WRITE;
+  off += REC_SPACE(len);
+
+  if (program16(dst + 4, (uint16_t)seq) || program16(dst + 6, (uint16_t)(seq >> 16)) ||
+      program16(dst, (uint16_t)PAGE_MAGIC) || program16(dst + 2, (uint16_t)(PAGE_MAGIC >> 16))) {
+    return ERROR_FLASH_WRITE;
+  }
+  active = dst;
+  active_seq = seq;
+  write_off = off;
+  return 0;
+}
+
+/**
+ * @brief  找到有效页和日志末尾（上电时调用一次）
+ * @retval 0=成功，1=存储区为空
+ */
+int Flash_Store_Init(void) {
+  active = 0;
+  for (uint8_t i = 0; i < 2; i++) {
+    uintptr_t p = page_addr(i);
+    if (rd32(p) != PAGE_MAGIC) continue;
+    uint32_t seq = rd32(p + 4);
+    if (!active || (int32_t)(seq - active_seq) > 0) {
+      active = p;
+      active_seq = seq;
+    }
+  }
+  if (!active) return 1;
+  write_off = scan_end(active);
+  return 0;
+}
+
+/**
+ * @brief  读取标签的最新记录
+ * @param  tag: 记录标签
+ * @param  data: 输出缓冲
+ * @param  len: 缓冲大小，记录更长时只拷贝前len字节
+ * @retval 记录的实际长度，-1=没有该记录
+ */
+int Flash_Store_Read(uint16_t tag, void *data, uint16_t len) {
+  uint16_t rec_len;
+  uintptr_t rec;
+
+  if (!active || !(rec = find(active, tag, &rec_len))) return -1;
+  memcpy(data, (const void *)(rec + REC_HDR_LEN), rec_len < len ? rec_len : len);
+  return rec_len;
+}
+
+/**
+ * @brief  写入一条记录（与当前内容相同时不写）
+ * @param  tag: 记录标签
+ * @param  data: 数据
+ * @param  len: 字节数，不超过FLASH_STORE_MAX_LEN
+ * @retval 0=成功，其余为ERROR_FLASH_*错误码
+ */
+int Flash_Store_Write(uint16_t tag, const void *data, uint16_t len) {
+  uint16_t old_len;
+  uintptr_t old;
+  int ret;
+
+  if (tag == TAG_EMPTY || len > FLASH_STORE_MAX_LEN) return ERROR_FLASH_ARG;
+  if (active && (old = find(active, tag, &old_len)) && old_len == len &&
+      memcmp((const void *)(old + REC_HDR_LEN), data, len) == 0) {
+    return 0;
+  }
+
+  HAL_FLASH_Unlock();
+  if (!active || write_off + REC_SPACE(len) > FLASH_STORE_PAGE_SIZE) {
+    ret = compact(tag, (const uint8_t *)data, len);
+  } else {
+    ret = program_record(active + write_off, tag, (const uint8_t *)data, len);
+    // 写失败时这段空间状态不明，下次写入整理到另一页
+    write_off = ret ? FLASH_STORE_PAGE_SIZE : write_off + REC_SPACE(len);
+  }
+  HAL_FLASH_Lock();
+  return ret;
+}
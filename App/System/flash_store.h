@@ -0,0 +1,26 @@
+#ifndef TWIGO_FLASH_STORE_H
+#define TWIGO_FLASH_STORE_H
+
+#include "stm32f1xx_hal.h"
+
+// 记录存储区：芯片最后2页（链接脚本已让出），两页轮换
+// 记录按标签追加写入，读取时同一标签以最后一条完整记录为准；页满时把每个标签的
+// 最新记录整理到另一页。擦写期间CPU停顿（擦除一页约20ms），不要在平衡控制中调用
+#define FLASH_STORE_BASE        (FLASH_BASE + 0xF800U)
+#define FLASH_STORE_PAGE_SIZE   FLASH_PAGE_SIZE
+#define FLASH_STORE_MAX_LEN     256     // 单条记录数据上限（字节）
+
+// 记录标签（0xFFFF保留）
+#define FLASH_TAG_IMU_CALIB     0x0101  // IMU零偏和机械平衡角
+#define FLASH_TAG_MOTOR_CALIB   0x0102  // 电机起转/维持阈值（摩擦补偿表）
+#define FLASH_TAG_HC05_BAUD     0x0103  // 协商后的蓝牙串口波特率
+
+#define ERROR_FLASH_ARG         -1
+#define ERROR_FLASH_WRITE       -2
+#define ERROR_FLASH_FULL        -3
+
+int Flash_Store_Init(void);
+int Flash_Store_Read(uint16_t tag, void *data, uint16_t len);
+int Flash_Store_Write(uint16_t tag, const void *data, uint16_t len);
+
+#endif //TWIGO_FLASH_STORE_H
@@ -0,0 +1,223 @@
+#include "System/i2c_bus.h"
+#include "System/timebase.h"
+#include "i2c.h"
+
+// 总线与引脚的对应关系（与i2c.c中HAL_I2C_MspInit一致）
+typedef struct {
+  I2C_HandleTypeDef *hi2c;
+  GPIO_TypeDef *port;
+  uint16_t scl;
+  uint16_t sda;
+  volatile uint8_t recover_pending;
+  I2C_Bus_StatsTypeDef stats;
+} I2C_BusTypeDef;
+
+static I2C_BusTypeDef buses[] = {
+  { .hi2c = &hi2c1, .port = GPIOB, .scl = GPIO_PIN_8, .sda = GPIO_PIN_9 },    // OLED（已重映射）
+  { .hi2c = &hi2c2, .port = GPIOB, .scl = GPIO_PIN_10, .sda = GPIO_PIN_11 },  // MPU6050
+};
+
+#define BUS_COUNT   (sizeof(buses) / sizeof(buses[0]))
+
+// 这些错误说明总线状态机已乱，只有恢复才能继续
+#define BUS_FAULT_ERRORS    (HAL_I2C_ERROR_BERR | HAL_I2C_ERROR_ARLO | HAL_I2C_ERROR_OVR | \
+                             HAL_I2C_ERROR_DMA | HAL_I2C_ERROR_TIMEOUT)
+
+static I2C_BusTypeDef *bus_of(I2C_HandleTypeDef *hi2c) {
+  for (uint8_t i = 0; i < BUS_COUNT; i++) {
+    if (buses[i].hi2c == hi2c) return &buses[i];
+  }
+  return NULL;
+}
+
+// 补发时钟的半个周期：忙等DWT周期计数器
+static void bus_half_period(void) {
+  uint32_t start = DWT->CYCCNT;
+  uint32_t cycles = SystemCoreClock / 1000000U * I2C_BUS_CLEAR_HALF_US;
+
+  while (DWT->CYCCNT - start < cycles) {
+    __NOP();
+  }
+}
+
+// 按HAL返回值/ErrorCode分类记错，总线故障时挂起恢复
+static int bus_classify(I2C_BusTypeDef *bus, I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status) {
+  switch (status) {
+    case HAL_OK:
+      return 0;
+    case HAL_BUSY:
+      // 句柄空闲却返回BUSY：等BUSY标志超时，说明SDA/SCL被拉住了
+      if (HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY) {
+        bus->stats.busy++;
+        return ERROR_I2C_BUSY;
+      }
+      bus->stats.timeouts++;
+      break;
+    case HAL_TIMEOUT:
+      bus->stats.timeouts++;
+      break;
+    default:
+      if (!(hi2c->ErrorCode & BUS_FAULT_ERRORS)) {
+        bus->stats.nacks++;
+        return ERROR_I2C_NACK;
+      }
+      if (hi2c->ErrorCode & HAL_I2C_ERROR_TIMEOUT)
+        bus->stats.timeouts++;
+      else
+        bus->stats.errors++;
+      break;
+  }
+  bus->recover_pending = 1;
+  return ERROR_I2C_BUS;
+}
+
+/**
+ * @brief  统计一次HAL传输的发起结果（阻塞传输即最终结果），总线故障时挂起恢复（可在中断中调用）
+ * @param  status: HAL_I2C_*返回值
+ * @retval 0=成功, ERROR_I2C_NACK/BUSY/BUS
+ */
+int I2C_Bus_Check(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status) {
+  I2C_BusTypeDef *bus = bus_of(hi2c);
+
+  if (bus == NULL) return (status == HAL_OK) ? 0 : ERROR_I2C_ARG;
+  bus->stats.transfers++;
+  return bus_classify(bus, hi2c, status);
+}
+
+/**
+ * @brief  统计已由I2C_Bus_Check计过数的DMA/中断传输在完成阶段的失败（错误回调或超时中调用）
+ * @param  status: 错误回调中传HAL_ERROR（错误类型取自ErrorCode），传输超时传HAL_TIMEOUT
+ * @retval ERROR_I2C_NACK/BUS
+ */
+int I2C_Bus_Complete_Error(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status) {
+  I2C_BusTypeDef *bus = bus_of(hi2c);
+
+  if (bus == NULL) return ERROR_I2C_ARG;
+  return bus_classify(bus, hi2c, status);
+}
+
+/**
+ * @brief  阻塞写寄存器，总线故障时恢复并重试（不可在中断中调用）
+ * @retval 0=成功, 负数为ERROR_I2C_*
+ */
+int I2C_Bus_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t dev_addr, uint16_t reg,
+                      uint8_t *data, uint16_t len, uint32_t timeout) {
+  int ret;
+
+  for (uint8_t attempt = 0;; attempt++) {
+    ret = I2C_Bus_Check(hi2c, HAL_I2C_Mem_Write(hi2c, dev_addr, reg, I2C_MEMADD_SIZE_8BIT,
+                                                data, len, timeout));
+    if (ret != ERROR_I2C_BUS || attempt >= I2C_BUS_RETRIES || I2C_Bus_Recover(hi2c) != 0)
+      return ret;
+  }
+}
+
+/**
+ * @brief  阻塞读寄存器，总线故障时恢复并重试（不可在中断中调用）
+ * @retval 0=成功, 负数为ERROR_I2C_*
+ */
+int I2C_Bus_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t dev_addr, uint16_t reg,
+                     uint8_t *data, uint16_t len, uint32_t timeout) {
+  int ret;
+
+  for (uint8_t attempt = 0;; attempt++) {
+    ret = I2C_Bus_Check(hi2c, HAL_I2C_Mem_Read(hi2c, dev_addr, reg, I2C_MEMADD_SIZE_8BIT,
+                                               data, len, timeout));
+    if (ret != ERROR_I2C_BUS || attempt >= I2C_BUS_RETRIES || I2C_Bus_Recover(hi2c) != 0)
+      return ret;
+  }
+}
+
+/**
+ * @brief  阻塞发送，总线故障时恢复并重试（不可在中断中调用）
+ * @retval 0=成功, 负数为ERROR_I2C_*
+ */
+int I2C_Bus_Transmit(I2C_HandleTypeDef *hi2c, uint16_t dev_addr,
+                     uint8_t *data, uint16_t len, uint32_t timeout) {
+  int ret;
+
+  for (uint8_t attempt = 0;; attempt++) {
+    ret = I2C_Bus_Check(hi2c, HAL_I2C_Master_Transmit(hi2c, dev_addr, data, len, timeout));
+    if (ret != ERROR_I2C_BUS || attempt >= I2C_BUS_RETRIES || I2C_Bus_Recover(hi2c) != 0)
+      return ret;
+  }
+}
+
+/**
+ * @brief  是否有DMA/中断传输报告了总线故障、等待主循环恢复
+ */
+uint8_t I2C_Bus_Recover_Pending(I2C_HandleTypeDef *hi2c) {
+  I2C_BusTypeDef *bus = bus_of(hi2c);
+
+  return bus != NULL && bus->recover_pending;
+}
+
+/**
+ * @brief  恢复总线：释放被从机拉住的SDA并重新初始化外设，不复位MCU
+ * @note   耗时约(补发时钟数+2)*10us加上外设初始化；调用前需保证没有DMA/中断传输会再启动
+ * @retval 0=成功, ERROR_I2C_STUCK=总线仍被拉低, ERROR_I2C_BUS=外设初始化失败
+ */
+int I2C_Bus_Recover(I2C_HandleTypeDef *hi2c) {
+  I2C_BusTypeDef *bus = bus_of(hi2c);
+  GPIO_InitTypeDef gpio = {0};
+  uint64_t start;
+  uint32_t elapsed;
+  uint8_t n;
+  int ret = 0;
+
+  if (bus == NULL) return ERROR_I2C_ARG;
+  start = Timebase_Now_Us();
+
+  // 关时钟、停DMA通道，引脚交还GPIO
+  HAL_I2C_DeInit(hi2c);
+  HAL_GPIO_WritePin(bus->port, bus->scl | bus->sda, GPIO_PIN_SET);
+  gpio.Pin = bus->scl | bus->sda;
+  gpio.Mode = GPIO_MODE_OUTPUT_OD;
+  gpio.Pull = GPIO_NOPULL;
+  gpio.Speed = GPIO_SPEED_FREQ_HIGH;
+  HAL_GPIO_Init(bus->port, &gpio);
+  bus_half_period();
+
+  // 从机卡在发送数据中途时会一直拉低SDA，逐个补发时钟让它把剩余位移出
+  for (n = 0; n < I2C_BUS_CLEAR_CLOCKS && HAL_GPIO_ReadPin(bus->port, bus->sda) == GPIO_PIN_RESET; n++) {
+    HAL_GPIO_WritePin(bus->port, bus->scl, GPIO_PIN_RESET);
+    bus_half_period();
+    HAL_GPIO_WritePin(bus->port, bus->scl, GPIO_PIN_SET);
+    bus_half_period();
+  }
+
+  // STOP：SCL为高时SDA由低变高，从机回到空闲
+  HAL_GPIO_WritePin(bus->port, bus->scl, GPIO_PIN_RESET);
+  bus_half_period();
+  HAL_GPIO_WritePin(bus->port, bus->sda, GPIO_PIN_RESET);
+  bus_half_period();
+  HAL_GPIO_WritePin(bus->port, bus->scl, GPIO_PIN_SET);
+  bus_half_period();
+  HAL_GPIO_WritePin(bus->port, bus->sda, GPIO_PIN_SET);
+  bus_half_period();
+  if (HAL_GPIO_ReadPin(bus->port, bus->sda) == GPIO_PIN_RESET ||
+      HAL_GPIO_ReadPin(bus->port, bus->scl) == GPIO_PIN_RESET) {
+    bus->stats.recover_fails++;
+    ret = ERROR_I2C_STUCK;
+  }
+
+  // MspInit把引脚切回复用开漏，Init内部先SWRST再按hi2c->Init配置
+  if (HAL_I2C_Init(hi2c) != HAL_OK) ret = ERROR_I2C_BUS;
+
+  elapsed = (uint32_t)(Timebase_Now_Us() - start);
+  bus->stats.recoveries++;
+  bus->stats.clock_pulses += n;
+  bus->stats.last_recover_us = elapsed;
+  if (elapsed > bus->stats.max_recover_us) bus->stats.max_recover_us = elapsed;
+  bus->recover_pending = 0;
+  return ret;
+}
+
+/**
+ * @brief  获取总线统计，hi2c不在表中时返回NULL
+ */
+const I2C_Bus_StatsTypeDef *I2C_Bus_Get_Stats(I2C_HandleTypeDef *hi2c) {
+  I2C_BusTypeDef *bus = bus_of(hi2c);
+
+  return bus != NULL ? &bus->stats : NULL;
+}
@@ -0,0 +1,45 @@
+#ifndef TWIGO_I2C_BUS_H
+#define TWIGO_I2C_BUS_H
+
+#include "stm32f1xx_hal.h"
+
+// I2C总线自恢复层：统计每条总线的错误，总线卡死时不复位MCU就地恢复
+// 恢复步骤：关闭外设 -> 引脚切到开漏GPIO，补发最多9个SCL时钟直到从机释放SDA
+// -> 手动产生STOP -> 重新初始化外设（F1的HAL_I2C_Init先做SWRST，清除卡住的BUSY标志）
+#define I2C_BUS_CLEAR_CLOCKS    9       // 从机最多还要移出8位数据+1位应答
+#define I2C_BUS_CLEAR_HALF_US   5       // 补发时钟半周期（100kHz）
+#define I2C_BUS_RETRIES         1       // 阻塞传输恢复后重试次数
+
+#define ERROR_I2C_ARG           -1
+#define ERROR_I2C_NACK          -2      // 从机无应答，不需要恢复总线
+#define ERROR_I2C_BUSY          -3      // 句柄正被其他传输（DMA）占用
+#define ERROR_I2C_BUS           -4      // 总线错误/仲裁丢失/超时，需要恢复
+#define ERROR_I2C_STUCK         -5      // 补发时钟后SDA或SCL仍被拉低
+
+// 单条总线的统计（调试用）
+typedef struct {
+  uint32_t transfers;       // 经过本层发起的传输次数（DMA传输只在发起时计一次）
+  uint32_t nacks;           // 从机无应答
+  uint32_t errors;          // 总线错误/仲裁丢失/溢出/DMA错误
+  uint32_t timeouts;        // 传输超时（含BUSY标志卡住）
+  uint32_t busy;            // 句柄忙，未发起传输
+  uint32_t recoveries;      // 执行恢复的次数
+  uint32_t recover_fails;   // 恢复后总线仍被拉低的次数
+  uint32_t clock_pulses;    // 为释放SDA累计补发的SCL时钟
+  uint32_t last_recover_us; // 最近一次恢复耗时
+  uint32_t max_recover_us;  // 最长一次恢复耗时
+} I2C_Bus_StatsTypeDef;
+
+int I2C_Bus_Check(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status);
+int I2C_Bus_Complete_Error(I2C_HandleTypeDef *hi2c, HAL_StatusTypeDef status);
+int I2C_Bus_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t dev_addr, uint16_t reg,
+                      uint8_t *data, uint16_t len, uint32_t timeout);
+int I2C_Bus_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t dev_addr, uint16_t reg,
+                     uint8_t *data, uint16_t len, uint32_t timeout);
+int I2C_Bus_Transmit(I2C_HandleTypeDef *hi2c, uint16_t dev_addr,
+                     uint8_t *data, uint16_t len, uint32_t timeout);
+uint8_t I2C_Bus_Recover_Pending(I2C_HandleTypeDef *hi2c);
+int I2C_Bus_Recover(I2C_HandleTypeDef *hi2c);
+const I2C_Bus_StatsTypeDef *I2C_Bus_Get_Stats(I2C_HandleTypeDef *hi2c);
+
+#endif //TWIGO_I2C_BUS_H
@@ -0,0 +1,139 @@
+#include "System/param.h"
+#include "Balance/balance_control.h"
+#include <string.h>
+
+_Static_assert(PARAM_COUNT <= 32, "pending位图为32位");
+_Static_assert(PARAM_HASH_SIZE >= 2U * PARAM_COUNT, "哈希索引太小");
+
+// 一组PID参数：目标值和输出限幅的范围按各环的单位给出
+#define PARAM_PID(id, prefix, pid, target_lim, out_lim) \
+  [id##_KP]       = { prefix ".kp",       PARAM_TYPE_FLOAT, 0.0f, 100.0f,  &(pid).kp,       &(pid) }, \
+  [id##_KI]       = { prefix ".ki",       PARAM_TYPE_FLOAT, 0.0f, 10.0f,   &(pid).ki,       &(pid) }, \
+  [id##_KD]       = { prefix ".kd",       PARAM_TYPE_FLOAT, 0.0f, 20.0f,   &(pid).kd,       &(pid) }, \
+  [id##_TARGET]   = { prefix ".target",   PARAM_TYPE_FLOAT, -(target_lim), (target_lim), &(pid).target, &(pid) }, \
+  [id##_ALPHA]    = { prefix ".alpha",    PARAM_TYPE_FLOAT, 0.0f, 0.99f,   &(pid).alpha,    &(pid) }, \
+  [id##_DEADBAND] = { prefix ".deadband", PARAM_TYPE_FLOAT, 0.0f, 10.0f,   &(pid).deadband, &(pid) }, \
+  [id##_MAX_OUT]  = { prefix ".max_out",  PARAM_TYPE_FLOAT, 0.0f, (out_lim), &(pid).max_out, &(pid) }, \
+  [id##_MIN_OUT]  = { prefix ".min_out",  PARAM_TYPE_FLOAT, -(out_lim), 0.0f, &(pid).min_out, &(pid) }
+
+static const Param_DescTypeDef params[PARAM_COUNT] = {
+  PARAM_PID(PARAM_BAL, "bal", balance_pid, 45.0f, 100.0f),      // 平衡环：度，输出百分比
+  PARAM_PID(PARAM_SPD, "spd", speed_pid, 10000.0f, 100.0f),     // 速度环：编码器计数/秒
+  PARAM_PID(PARAM_TURN, "turn", turn_pid, 180.0f, 100.0f),      // 转向环：度
+  [PARAM_MOTOR_MIN_START] = { "motor.min_start", PARAM_TYPE_FLOAT, 0.0f, 100.0f, &min_start_pwm, NULL },
+};
+
+static uint8_t hash_slots[PARAM_HASH_SIZE];     // 参数下标+1，0=空槽
+static float staged[PARAM_COUNT];
+static volatile uint32_t pending;               // 暂存了新值的参数位图
+
+#define PARAM_LOCK()        uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define PARAM_UNLOCK()      __set_PRIMASK(primask)
+
+// FNV-1a字符串哈希
+static uint32_t name_hash(const char *s) {
+  uint32_t h = 2166136261U;
+  while (*s) {
+    h = (h ^ (uint8_t)*s++) * 16777619U;
+  }
+  return h;
+}
+
+/**
+ * @brief  建立名称哈希索引（上电时调用一次）
+ */
+void Param_Init(void) {
+  memset(hash_slots, 0, sizeof(hash_slots));
+  for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+    uint32_t h = name_hash(params[i].name) & (PARAM_HASH_SIZE - 1U);
+    while (hash_slots[h]) {
+      h = (h + 1U) & (PARAM_HASH_SIZE - 1U);
+    }
+    hash_slots[h] = i + 1U;
+  }
+  pending = 0;
+}
+
+/**
+ * @brief  按名称查找参数编号（哈希 + 线性探测，平均一次字符串比较）
+ * @retval 参数编号，ERROR_PARAM_ID=没有该参数
+ */
+int Param_Find(const char *name) {
+  uint32_t h = name_hash(name) & (PARAM_HASH_SIZE - 1U);
+
+  while (hash_slots[h]) {
+    uint8_t i = hash_slots[h] - 1U;
+    if (strcmp(params[i].name, name) == 0) {
+      return i;
+    }
+    h = (h + 1U) & (PARAM_HASH_SIZE - 1U);
+  }
+  return ERROR_PARAM_ID;
+}
+
+/**
+ * @brief  获取参数描述
+ * @retval 描述，编号无效时为NULL
+ */
+const Param_DescTypeDef *Param_Get_Desc(uint8_t id) {
+  return id < PARAM_COUNT ? &params[id] : NULL;
+}
+
+/**
+ * @brief  读取参数当前生效的值
+ * @retval 0=成功，ERROR_PARAM_ID=编号无效
+ */
+int Param_Get(uint8_t id, float *value) {
+  if (id >= PARAM_COUNT) return ERROR_PARAM_ID;
+  *value = *(const float *)params[id].addr;
+  return 0;
+}
+
+/**
+ * @brief  暂存参数新值，下次Param_Commit时生效（任务和中断中都可调用）
+ * @retval 0=成功，ERROR_PARAM_ID=编号无效，ERROR_PARAM_RANGE=超出上下限（不暂存）
+ */
+int Param_Set(uint8_t id, float value) {
+  if (id >= PARAM_COUNT) return ERROR_PARAM_ID;
+  // 写成!(a && b)让NaN也判为越界
+  if (!(value >= params[id].min && value <= params[id].max)) return ERROR_PARAM_RANGE;
+  PARAM_LOCK();
+  staged[id] = value;
+  pending |= 1UL << id;
+  PARAM_UNLOCK();
+  return 0;
+}
+
+/**
+ * @brief  暂存中尚未生效的参数个数
+ */
+uint8_t Param_Pending(void) {
+  return (uint8_t)__builtin_popcount(pending);
+}
+
+/**
+ * @brief  让暂存的修改一起生效并同步定点PID参数（控制周期开始前调用）
+ */
+void Param_Commit(void) {
+  uint32_t bits;
+  void *synced = NULL;
+
+  if (pending == 0) return;
+  PARAM_LOCK();
+  bits = pending;
+  pending = 0;
+  for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+    if (bits & (1UL << i)) {
+      *(float *)params[i].addr = staged[i];
+    }
+  }
+  PARAM_UNLOCK();
+
+  // 同一PID的参数在表中连续，相邻重复的只同步一次
+  for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+    if ((bits & (1UL << i)) && params[i].pid != NULL && params[i].pid != synced) {
+      synced = params[i].pid;
+      PID_Fixed_Sync((PID_HandleTypeDef *)synced);
+    }
+  }
+}
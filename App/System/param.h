@@ -0,0 +1,69 @@
+#ifndef TWIGO_PARAM_H
+#define TWIGO_PARAM_H
+
+#include "stm32f1xx_hal.h"
+
+// 运行时参数表：每个可调参数一条记录（名称、编号、类型、上下限、地址）
+// 编号就是表中的下标，二进制客户端按编号直接访问；名称查找走哈希索引（Param_Init中建立）
+// 修改先暂存，由Param_Commit在控制周期开始前一次性生效，同一批修改不会被拆到两个周期
+// 编号只能在末尾追加，不要改动已有编号
+
+// 参数编号
+typedef enum {
+  PARAM_BAL_KP = 0,
+  PARAM_BAL_KI,
+  PARAM_BAL_KD,
+  PARAM_BAL_TARGET,
+  PARAM_BAL_ALPHA,
+  PARAM_BAL_DEADBAND,
+  PARAM_BAL_MAX_OUT,
+  PARAM_BAL_MIN_OUT,
+  PARAM_SPD_KP,
+  PARAM_SPD_KI,
+  PARAM_SPD_KD,
+  PARAM_SPD_TARGET,
+  PARAM_SPD_ALPHA,
+  PARAM_SPD_DEADBAND,
+  PARAM_SPD_MAX_OUT,
+  PARAM_SPD_MIN_OUT,
+  PARAM_TURN_KP,
+  PARAM_TURN_KI,
+  PARAM_TURN_KD,
+  PARAM_TURN_TARGET,
+  PARAM_TURN_ALPHA,
+  PARAM_TURN_DEADBAND,
+  PARAM_TURN_MAX_OUT,
+  PARAM_TURN_MIN_OUT,
+  PARAM_MOTOR_MIN_START,
+  PARAM_COUNT
+} Param_IdTypeDef;
+
+// 参数类型（目前可调参数都是float）
+typedef enum {
+  PARAM_TYPE_FLOAT = 0
+} Param_TypeTypeDef;
+
+// 参数描述
+typedef struct {
+  const char *name;
+  Param_TypeTypeDef type;
+  float min;
+  float max;
+  void *addr;
+  void *pid;            // 所属PID（PID_HandleTypeDef），生效后同步定点参数；NULL=无
+} Param_DescTypeDef;
+
+#define PARAM_HASH_SIZE     64U     // 名称哈希索引槽数（2的幂，至少为参数个数的2倍）
+
+#define ERROR_PARAM_ID      -1
+#define ERROR_PARAM_RANGE   -2
+
+void Param_Init(void);
+int Param_Find(const char *name);
+const Param_DescTypeDef *Param_Get_Desc(uint8_t id);
+int Param_Get(uint8_t id, float *value);
+int Param_Set(uint8_t id, float value);
+uint8_t Param_Pending(void);
+void Param_Commit(void);
+
+#endif //TWIGO_PARAM_H
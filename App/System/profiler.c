@@ -0,0 +1,58 @@
+#include "System/profiler.h"
+
+#if PROFILER_ENABLE
+
+uint32_t profiler_start[PROF_STAGE_COUNT];
+static Profiler_StatTypeDef stats[PROF_STAGE_COUNT];
+
+static const char *const stage_names[PROF_STAGE_COUNT] = {
+  "EXTI", "FIFO", "PARSE", "QUAT", "PID", "MOTOR", "LAT"
+};
+
+/**
+ * @brief  使能DWT周期计数器并清空统计
+ * @note   不清零CYCCNT，它同时是Timebase的时间源
+ */
+void Profiler_Init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  Profiler_Reset();
+}
+
+/**
+ * @brief  清空所有阶段的统计
+ */
+void Profiler_Reset(void) {
+  __disable_irq();
+  for (uint8_t i = 0; i < PROF_STAGE_COUNT; i++) {
+    stats[i] = (Profiler_StatTypeDef){0};
+  }
+  __enable_irq();
+}
+
+/**
+ * @brief  记录一次阶段耗时
+ * @param  stage: 阶段
+ * @param  cycles: 耗时（CPU周期）
+ */
+void Profiler_Record(Profiler_StageTypeDef stage, uint32_t cycles) {
+  Profiler_StatTypeDef *s = &stats[stage];
+  uint32_t bin = cycles ? (31U - __CLZ(cycles)) : 0U;
+
+  if (s->count == 0 || cycles < s->min) s->min = cycles;
+  if (cycles > s->max) s->max = cycles;
+  s->sum += cycles;
+  s->count++;
+  if (bin >= PROFILER_HIST_BINS) bin = PROFILER_HIST_BINS - 1;
+  s->hist[bin]++;
+}
+
+const Profiler_StatTypeDef *Profiler_Get_Stat(Profiler_StageTypeDef stage) {
+  return &stats[stage];
+}
+
+const char *Profiler_Get_Name(Profiler_StageTypeDef stage) {
+  return stage_names[stage];
+}
+
+#endif
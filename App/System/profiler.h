@@ -0,0 +1,56 @@
+#ifndef TWIGO_PROFILER_H
+#define TWIGO_PROFILER_H
+
+#include "stm32f1xx_hal.h"
+
+// 编译开关：置0时所有埋点宏展开为空，profiler.c也不参与编译
+#ifndef PROFILER_ENABLE
+#define PROFILER_ENABLE 1
+#endif
+
+#define PROFILER_HIST_BINS  16  // log2直方图：第n格统计[2^n, 2^(n+1))个周期
+
+// 热路径阶段
+typedef enum {
+  PROF_STAGE_EXTI = 0,    // INT中断处理
+  PROF_STAGE_FIFO_READ,   // FIFO DMA读取（INT到数据包解析前）
+  PROF_STAGE_PARSE,       // DMP数据包解析（每包一次）
+  PROF_STAGE_QUAT,        // 四元数转欧拉角（RAW模式为互补滤波）
+  PROF_STAGE_PID,         // PID计算
+  PROF_STAGE_MOTOR,       // 电机输出更新
+  PROF_STAGE_LATENCY,     // INT到电机输出的总延迟
+  PROF_STAGE_COUNT
+} Profiler_StageTypeDef;
+
+// 单个阶段的统计（单位：CPU周期）
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  uint32_t hist[PROFILER_HIST_BINS];
+} Profiler_StatTypeDef;
+
+#if PROFILER_ENABLE
+
+extern uint32_t profiler_start[PROF_STAGE_COUNT];
+
+// 阶段开始/结束埋点，开始和结束可以在不同中断中
+#define PROF_BEGIN(stage)   do { profiler_start[stage] = DWT->CYCCNT; } while (0)
+#define PROF_END(stage)     Profiler_Record((stage), DWT->CYCCNT - profiler_start[stage])
+
+void Profiler_Init(void);
+void Profiler_Reset(void);
+void Profiler_Record(Profiler_StageTypeDef stage, uint32_t cycles);
+const Profiler_StatTypeDef *Profiler_Get_Stat(Profiler_StageTypeDef stage);
+const char *Profiler_Get_Name(Profiler_StageTypeDef stage);
+
+#else
+
+#define PROF_BEGIN(stage)   do { } while (0)
+#define PROF_END(stage)     do { } while (0)
+#define Profiler_Init()     do { } while (0)
+
+#endif
+
+#endif //TWIGO_PROFILER_H
@@ -0,0 +1,43 @@
+#include "System/timebase.h"
+
+static uint64_t now_us;         // 已累计的微秒数
+static uint32_t ref_cycles;     // now_us对应的CYCCNT值
+static uint32_t cycles_per_us = 72;
+
+/**
+ * @brief  使能DWT周期计数器，时基从0开始
+ * @note   之后不要再改写DWT->CYCCNT，否则时基会跳变
+ */
+void Timebase_Init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  cycles_per_us = SystemCoreClock / 1000000U;
+  if (cycles_per_us == 0) cycles_per_us = 1;
+  __disable_irq();
+  now_us = 0;
+  ref_cycles = DWT->CYCCNT;
+  __enable_irq();
+}
+
+/**
+ * @brief  获取当前时间（微秒），可在中断中调用
+ * @retval 距Timebase_Init的微秒数
+ */
+uint64_t Timebase_Now_Us(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  // 32位无符号差值自然处理回绕；不足1us的余数留到下次
+  uint32_t us = (DWT->CYCCNT - ref_cycles) / cycles_per_us;
+  ref_cycles += us * cycles_per_us;
+  now_us += us;
+  uint64_t t = now_us;
+  __set_PRIMASK(primask);
+  return t;
+}
+
+/**
+ * @brief  SysTick中断中调用，防止两次读取间隔超过CYCCNT回绕周期
+ */
+void Timebase_Update(void) {
+  (void)Timebase_Now_Us();
+}
@@ -0,0 +1,13 @@
+#ifndef TWIGO_TIMEBASE_H
+#define TWIGO_TIMEBASE_H
+
+#include "stm32f1xx_hal.h"
+
+// 64位微秒时基：DWT周期计数器（72MHz下约59.6秒回绕一次）软件扩展
+// SysTick中断里调用Timebase_Update，保证每次回绕之前至少累计一次
+
+void Timebase_Init(void);
+void Timebase_Update(void);
+uint64_t Timebase_Now_Us(void);
+
+#endif //TWIGO_TIMEBASE_H
@@ -20,6 +20,5 @@
 #define MOTOR_PWM_TIM   &htim1
 #define MOTOR_PWMA_CHAN TIM_CHANNEL_1
 #define MOTOR_PWMB_CHAN TIM_CHANNEL_2
-#define MOTOR_PWM_MAX   100
 
 #endif //TWIGO_PIN_DEFINITIONS_H
\ No newline at end of file
@@ -36,6 +36,8 @@ extern I2C_HandleTypeDef hi2c1;
 
 extern I2C_HandleTypeDef hi2c2;
 
+extern DMA_HandleTypeDef hdma_i2c2_rx;
+
 /* USER CODE BEGIN Private defines */
 
 /* USER CODE END Private defines */
@@ -65,6 +65,8 @@ void Error_Handler(void);
 #define BIN1_GPIO_Port GPIOA
 #define BIN2_Pin GPIO_PIN_7
 #define BIN2_GPIO_Port GPIOA
+#define VBAT_Pin GPIO_PIN_0
+#define VBAT_GPIO_Port GPIOB
 #define PWMA_Pin GPIO_PIN_8
 #define PWMA_GPIO_Port GPIOA
 #define PWMB_Pin GPIO_PIN_9
@@ -26,6 +26,8 @@
 /* USER CODE END Header */
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
+#include "adc.h"
+#include "dma.h"
 #include "i2c.h"
 #include "tim.h"
 #include "usart.h"
@@ -33,6 +35,10 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "System/profiler.h"
+#include "System/timebase.h"
+#include "System/flash_store.h"
+#include "System/param.h"
 
 /* USER CODE END Includes */
 
@@ -96,6 +102,7 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_I2C2_Init();
   MX_TIM1_Init();
   MX_TIM2_Init();
@@ -103,12 +110,15 @@ int main(void)
   MX_USART2_UART_Init();
   MX_TIM3_Init();
   MX_I2C1_Init();
+  MX_ADC1_Init();
   /* USER CODE BEGIN 2 */
-  HAL_Delay(20);
-  MPU6050_DMP_init();
-  TB6612_Init();
+  Timebase_Init();
+  Profiler_Init();
+  Flash_Store_Init();
+  Param_Init();
+  // 电机和MPU6050在Balance_Init中初始化，上电等待由驱动轮询完成
   Balance_Init();
-  // Bluetooth_Debug_Init(&huart2);
+  Bluetooth_Debug_Init(&huart2);
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -118,7 +128,8 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-    // BluetoothDebug_Process();
+    Bluetooth_Debug_Process();
+    MPU6050_DMP_Process();
     Balance_Control();
   }
   /* USER CODE END 3 */
@@ -132,6 +143,7 @@ void SystemClock_Config(void)
 {
   RCC_OscInitTypeDef RCC_OscInitStruct = {0};
   RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+  RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
 
   /** Initializes the RCC Oscillators according to the specified parameters
   * in the RCC_OscInitTypeDef structure.
@@ -161,6 +173,12 @@ void SystemClock_Config(void)
   {
     Error_Handler();
   }
+  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_ADC;
+  PeriphClkInit.AdcClockSelection = RCC_ADCPCLK2_DIV6;
+  if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
+  {
+    Error_Handler();
+  }
 }
 
 /* USER CODE BEGIN 4 */
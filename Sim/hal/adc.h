@@ -0,0 +1,7 @@
+// SIL stand-in for Core/Inc/adc.h
+#ifndef SIM_ADC_H
+#define SIM_ADC_H
+#include "stm32f1xx_hal.h"
+extern ADC_HandleTypeDef hadc1;
+extern DMA_HandleTypeDef hdma_adc1;
+#endif //SIM_ADC_H
@@ -0,0 +1,5 @@
+// SIL stand-in for Core/Inc/gpio.h
+#ifndef SIM_GPIO_H
+#define SIM_GPIO_H
+#include "stm32f1xx_hal.h"
+#endif //SIM_GPIO_H
@@ -0,0 +1,580 @@
+//
+// Host-side stand-in for the STM32F1 HAL used by the SIL build.
+//
+// I2C2 is wired to the MPU6050 model. DMA reads complete after the time the
+// transfer would take on the wire, then call HAL_I2C_MemRxCpltCallback
+// like the DMA1_Channel5 interrupt would. Blocking transfers hold the bus
+// for the same wire time, and every HAL_GetTick() poll or __NOP() from
+// thread context costs a microsecond, so busy-wait loops in the firmware
+// see time pass.
+//
+// USART2 transmit DMA finishes after the frame's time on the wire at the
+// configured baud rate; the bytes go to the --telemetry capture file (or the
+// --cmd reply buffer). Lines injected with sim_uart_rx() land in the receive
+// DMA buffer after their time on the wire, raising the HT/TC events they cross
+// and then IDLE. Blocking receives see no HC-05 and time out.
+//
+// With --i2c-fault a FIFO DMA read can hang halfway with the MPU holding SDA
+// low: the transfer never completes, the peripheral reports BUSY until the
+// firmware clocks SCL on PB10 as a GPIO enough times to release the line.
+//
+#include "stm32f1xx_hal.h"
+#include "main.h"
+#include "tim.h"
+#include "i2c.h"
+#include "adc.h"
+#include "usart.h"
+#include "../sim.h"
+#include "../mpu_model.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint32_t SystemCoreClock = 72000000;
+DWT_Type sim_dwt;
+uint8_t sim_flash[SIM_FLASH_SIZE];
+CoreDebug_Type sim_core_debug;
+GPIO_TypeDef sim_gpioa, sim_gpiob, sim_gpioc;
+TIM_TypeDef sim_tim1, sim_tim2, sim_tim3, sim_tim4;
+
+TIM_HandleTypeDef htim1 = { .Instance = &sim_tim1 };
+TIM_HandleTypeDef htim2 = { .Instance = &sim_tim2 };
+TIM_HandleTypeDef htim3 = { .Instance = &sim_tim3 };
+TIM_HandleTypeDef htim4 = { .Instance = &sim_tim4 };
+I2C_HandleTypeDef hi2c1;
+I2C_HandleTypeDef hi2c2;
+DMA_HandleTypeDef hdma_i2c2_rx;
+DMA_HandleTypeDef hdma_adc1;
+ADC_HandleTypeDef hadc1 = { .DMA_Handle = &hdma_adc1 };
+DMA_HandleTypeDef hdma_usart2_tx;
+DMA_HandleTypeDef hdma_usart2_rx;
+UART_HandleTypeDef huart2 = { .Init = { .BaudRate = 9600 }, .hdmatx = &hdma_usart2_tx, .hdmarx = &hdma_usart2_rx };
+
+int sim_in_irq;
+static uint8_t nvic_enabled[SIM_IRQ_COUNT];
+
+// ADC1 circular DMA target
+static struct {
+  uint16_t *buf;
+  uint32_t len;
+} adc_dma;
+
+// pending I2C2 DMA read
+static struct {
+  int active;
+  uint64_t done_at;
+  uint8_t reg;
+  uint8_t *data;
+  uint16_t size;
+} i2c2_dma;
+
+// pending USART2 DMA transmit
+static struct {
+  int active;
+  uint64_t done_at;
+  const uint8_t *data;
+  uint16_t size;
+} uart2_dma;
+static FILE *uart2_capture;
+
+// USART2 circular receive DMA and the injected line on its way in
+static struct {
+  uint8_t *buf;
+  uint16_t size;
+  uint16_t pos;
+} uart2_rx_dma;
+static struct {
+  int active;
+  uint64_t done_at;
+  uint8_t data[SIM_UART_RX_MAX];
+  uint16_t len;
+} uart2_rx;
+
+// I2C2 line state: SCL clocks the slave still needs before it releases SDA,
+// and whether PB10/PB11 are currently plain GPIOs (bus clear in progress)
+static int i2c2_stuck_clocks;
+static int i2c2_lines_gpio;
+
+void sim_hal_reset(void) {
+  memset(&sim_dwt, 0, sizeof(sim_dwt));
+  memset(sim_flash, 0xFF, sizeof(sim_flash));
+  memset(&sim_core_debug, 0, sizeof(sim_core_debug));
+  memset(&sim_gpioa, 0, sizeof(sim_gpioa));
+  memset(&sim_gpiob, 0, sizeof(sim_gpiob));
+  memset(&sim_gpioc, 0, sizeof(sim_gpioc));
+  memset(&sim_tim1, 0, sizeof(sim_tim1));
+  memset(&sim_tim2, 0, sizeof(sim_tim2));
+  memset(&sim_tim3, 0, sizeof(sim_tim3));
+  memset(&sim_tim4, 0, sizeof(sim_tim4));
+  memset(nvic_enabled, 0, sizeof(nvic_enabled));
+  memset(&i2c2_dma, 0, sizeof(i2c2_dma));
+  memset(&adc_dma, 0, sizeof(adc_dma));
+  memset(&uart2_dma, 0, sizeof(uart2_dma));
+  memset(&uart2_rx_dma, 0, sizeof(uart2_rx_dma));
+  memset(&uart2_rx, 0, sizeof(uart2_rx));
+  huart2.gState = HAL_UART_STATE_READY;
+  huart2.RxState = HAL_UART_STATE_READY;
+  huart2.ErrorCode = 0;
+  i2c2_stuck_clocks = 0;
+  i2c2_lines_gpio = 0;
+  hi2c1.State = HAL_I2C_STATE_READY;
+  hi2c2.State = HAL_I2C_STATE_READY;
+  sim_in_irq = 0;
+}
+
+void Error_Handler(void) {
+  fprintf(stderr, "sil: Error_Handler called\n");
+  abort();
+}
+
+/* ---------------------------------------------------------------- Core -- */
+HAL_StatusTypeDef HAL_Init(void) {
+  return HAL_OK;
+}
+
+#define TICK_POLL_US    1U      // cost of one pass through a polling loop
+
+void sim_poll(void) {
+  if (!sim_in_irq) sim_advance_us(TICK_POLL_US);
+}
+
+uint32_t HAL_GetTick(void) {
+  sim_poll();
+  return (uint32_t)(sim_now_us() / 1000U);
+}
+
+void HAL_Delay(uint32_t Delay) {
+  if (sim_in_irq) {
+    fprintf(stderr, "sil: HAL_Delay(%u) called from interrupt context\n", (unsigned)Delay);
+    abort();
+  }
+  // HAL_Delay waits at least one extra tick
+  sim_advance_us(((uint64_t)Delay + 1U) * 1000U);
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority) {
+  (void)IRQn;
+  (void)PreemptPriority;
+  (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn) {
+  nvic_enabled[IRQn] = 1;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn) {
+  nvic_enabled[IRQn] = 0;
+}
+
+int sim_irq_enabled(IRQn_Type irq) {
+  return nvic_enabled[irq];
+}
+
+/* ---------------------------------------------------------------- GPIO -- */
+#define I2C2_SCL    GPIO_PIN_10
+#define I2C2_SDA    GPIO_PIN_11
+
+// Open-drain bus: a line reads high only if nobody pulls it low
+static void i2c2_lines_update(void) {
+  uint32_t idr = I2C2_SCL | I2C2_SDA;
+  if (i2c2_lines_gpio) idr &= GPIOB->ODR;
+  if (i2c2_stuck_clocks) idr &= ~(uint32_t)I2C2_SDA;
+  GPIOB->IDR = (GPIOB->IDR & ~(uint32_t)(I2C2_SCL | I2C2_SDA)) | idr;
+}
+
+// BSRR is write-only on the chip: fold pending set/reset bits into ODR
+// (set wins when both are given) before anybody looks at the port again
+static void gpio_sync(GPIO_TypeDef *GPIOx) {
+  uint32_t bsrr = GPIOx->BSRR;
+  if (!bsrr) return;
+  GPIOx->BSRR = 0;
+  GPIOx->ODR = (GPIOx->ODR | (bsrr & 0xFFFFU)) & ~((bsrr >> 16) & ~bsrr);
+  if (GPIOx == GPIOB && i2c2_lines_gpio) i2c2_lines_update();
+}
+
+void sim_gpio_sync(void) {
+  gpio_sync(GPIOA);
+  gpio_sync(GPIOB);
+  gpio_sync(GPIOC);
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init) {
+  if (GPIOx == GPIOB && (GPIO_Init->Pin & (I2C2_SCL | I2C2_SDA))) {
+    i2c2_lines_gpio = GPIO_Init->Mode == GPIO_MODE_OUTPUT_OD;
+    i2c2_lines_update();
+  }
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin) {
+  if (GPIOx == GPIOB && (GPIO_Pin & (I2C2_SCL | I2C2_SDA))) {
+    i2c2_lines_gpio = 0;
+    i2c2_lines_update();
+  }
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+  uint32_t before;
+  gpio_sync(GPIOx);
+  before = GPIOx->ODR;
+  if (PinState != GPIO_PIN_RESET)
+    GPIOx->ODR |= GPIO_Pin;
+  else
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+  if (GPIOx == GPIOB && i2c2_lines_gpio) {
+    // each SCL rising edge shifts one more bit out of the stuck slave
+    if (!(before & I2C2_SCL) && (GPIOx->ODR & I2C2_SCL) && i2c2_stuck_clocks) i2c2_stuck_clocks--;
+    i2c2_lines_update();
+  }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+  gpio_sync(GPIOx);
+  return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+  gpio_sync(GPIOx);
+  GPIOx->ODR ^= GPIO_Pin;
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+  UNUSED(GPIO_Pin);
+}
+
+/* ----------------------------------------------------------------- TIM -- */
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel) {
+  htim->Instance->CCER |= 1U << Channel;
+  htim->Instance->CR1 |= 1U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel) {
+  htim->Instance->CCER &= ~(1U << Channel);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Encoder_Start(TIM_HandleTypeDef *htim, uint32_t Channel) {
+  (void)Channel;
+  htim->Instance->CR1 |= 1U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim) {
+  htim->Instance->DIER |= 1U;
+  htim->Instance->CR1 |= 1U;
+  return HAL_OK;
+}
+
+__weak void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+  UNUSED(htim);
+}
+
+/* ----------------------------------------------------------------- I2C -- */
+#define I2C_TIMEOUT_BUSY_FLAG_US    25000U  // HAL waits this long for a stuck BUSY flag
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c) {
+  // SWRST + reconfigure; the pins go back to the peripheral
+  if (hi2c == &hi2c2) {
+    i2c2_lines_gpio = 0;
+    i2c2_lines_update();
+  }
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  hi2c->State = HAL_I2C_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma) {
+  // the channel stops; the I2C peripheral itself stays busy until re-initialised
+  if (hdma == &hdma_i2c2_rx) i2c2_dma.active = 0;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c) {
+  // clock off and the DMA channel disabled: a pending transfer never completes
+  if (hi2c == &hi2c2) i2c2_dma.active = 0;
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  hi2c->State = HAL_I2C_STATE_RESET;
+  return HAL_OK;
+}
+
+// A held SDA keeps the BUSY flag set; the HAL gives up after a timeout.
+// (On the target that wait would never end inside a priority-0 ISR, as
+// SysTick cannot preempt it; here it simply fails.)
+static int i2c2_bus_stuck(I2C_HandleTypeDef *hi2c) {
+  if (hi2c != &hi2c2 || !i2c2_stuck_clocks) return 0;
+  if (!sim_in_irq) sim_advance_us(I2C_TIMEOUT_BUSY_FLAG_US);
+  hi2c->ErrorCode |= HAL_I2C_ERROR_TIMEOUT;
+  return 1;
+}
+
+static uint64_t i2c_wire_us(const I2C_HandleTypeDef *hi2c, uint32_t bits) {
+  return (uint64_t)bits * 1000000U / (hi2c->Init.ClockSpeed ? hi2c->Init.ClockSpeed : 100000U);
+}
+
+// Blocking transfer: the bus is busy for the wire time while interrupts run
+static void i2c_blocking_wait(I2C_HandleTypeDef *hi2c, HAL_I2C_StateTypeDef state, uint32_t bits) {
+  if (sim_in_irq) return;
+  hi2c->State = state;
+  sim_advance_us(i2c_wire_us(hi2c, bits));
+  hi2c->State = HAL_I2C_STATE_READY;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+  (void)MemAddSize;
+  (void)Timeout;
+  if (hi2c != &hi2c2 || DevAddress != MPU_MODEL_ADDR) return HAL_ERROR;
+  if (hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+  if (i2c2_bus_stuck(hi2c)) return HAL_BUSY;
+  // START + addr + reg + data + STOP
+  i2c_blocking_wait(hi2c, HAL_I2C_STATE_BUSY_TX, 2U + 9U * (2U + Size));
+  mpu_model_write((uint8_t)MemAddress, pData, Size);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+  (void)MemAddSize;
+  (void)Timeout;
+  if (hi2c != &hi2c2 || DevAddress != MPU_MODEL_ADDR) return HAL_ERROR;
+  if (hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+  if (i2c2_bus_stuck(hi2c)) return HAL_BUSY;
+  i2c_blocking_wait(hi2c, HAL_I2C_STATE_BUSY_RX, 3U * 9U + 2U + 9U * Size);
+  mpu_model_read((uint8_t)MemAddress, pData, Size);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size) {
+  uint32_t bits;
+  (void)MemAddSize;
+  if (hi2c != &hi2c2 || DevAddress != MPU_MODEL_ADDR) return HAL_ERROR;
+  if (hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+  if (i2c2_bus_stuck(hi2c)) return HAL_BUSY;
+
+  // START + addr + reg + RESTART + addr, then 9 bits per data byte
+  bits = 3U * 9U + 2U + 9U * Size;
+  hi2c->State = HAL_I2C_STATE_BUSY_RX;
+  i2c2_stuck_clocks = sim_world_i2c_fault();
+  if (i2c2_stuck_clocks) {
+    // hangs partway through: some bytes already left the FIFO, no completion
+    mpu_model_read((uint8_t)MemAddress, pData, Size / 2U);
+    i2c2_lines_update();
+    return HAL_OK;
+  }
+  i2c2_dma.active = 1;
+  i2c2_dma.done_at = sim_now_us() + i2c_wire_us(hi2c, bits);
+  i2c2_dma.reg = (uint8_t)MemAddress;
+  i2c2_dma.data = pData;
+  i2c2_dma.size = Size;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                          uint16_t Size, uint32_t Timeout) {
+  (void)DevAddress;
+  (void)pData;
+  (void)Size;
+  (void)Timeout;
+  // nothing but the MPU6050 on the simulated buses
+  hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+  return HAL_ERROR;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c) {
+  return hi2c->State;
+}
+
+__weak void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+  UNUSED(hi2c);
+}
+
+__weak void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+  UNUSED(hi2c);
+}
+
+/* ---------------------------------------------------------------- UART -- */
+void sim_uart_capture(FILE *f) {
+  uart2_capture = f;
+}
+
+void sim_uart_set_baud(uint32_t baud) {
+  huart2.Init.BaudRate = baud;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size) {
+  if (huart != &huart2 || Size == 0) return HAL_ERROR;
+  if (huart->gState != HAL_UART_STATE_READY) return HAL_BUSY;
+  huart->gState = HAL_UART_STATE_BUSY_TX;
+  huart->ErrorCode = 0;
+  uart2_dma.active = 1;
+  // 1 start + 8 data + 1 stop bit per byte
+  uart2_dma.done_at = sim_now_us() + (uint64_t)Size * 10U * 1000000U / huart->Init.BaudRate;
+  uart2_dma.data = pData;
+  uart2_dma.size = Size;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart) {
+  if (huart != &huart2) return HAL_ERROR;
+  huart->ErrorCode = 0;
+  huart->gState = HAL_UART_STATE_READY;
+  huart->RxState = HAL_UART_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+  UNUSED(pData);
+  if (huart != &huart2 || Size == 0) return HAL_ERROR;
+  if (huart->RxState != HAL_UART_STATE_READY) return HAL_BUSY;
+  sim_advance_us((uint64_t)Timeout * 1000U);
+  return HAL_TIMEOUT;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size) {
+  if (huart != &huart2 || Size == 0) return HAL_ERROR;
+  if (huart->RxState != HAL_UART_STATE_READY) return HAL_BUSY;
+  huart->RxState = HAL_UART_STATE_BUSY_RX;
+  uart2_rx_dma.buf = pData;
+  uart2_rx_dma.size = Size;
+  uart2_rx_dma.pos = 0;
+  return HAL_OK;
+}
+
+int sim_uart_rx(const uint8_t *data, uint16_t len) {
+  if (uart2_rx.active || len == 0 || len > SIM_UART_RX_MAX) return -1;
+  memcpy(uart2_rx.data, data, len);
+  uart2_rx.len = len;
+  uart2_rx.active = 1;
+  uart2_rx.done_at = sim_now_us() + (uint64_t)len * 10U * 1000000U / huart2.Init.BaudRate;
+  return 0;
+}
+
+// The line has arrived: copy it into the circular buffer the way the DMA
+// would, with the half/full transfer events it crosses, then the IDLE event
+static void uart2_rx_deliver(void) {
+  if (huart2.RxState != HAL_UART_STATE_BUSY_RX) return;   // nobody listening: bytes lost
+  for (uint16_t i = 0; i < uart2_rx.len; i++) {
+    uart2_rx_dma.buf[uart2_rx_dma.pos++] = uart2_rx.data[i];
+    if (uart2_rx_dma.pos == uart2_rx_dma.size / 2U) {
+      HAL_UARTEx_RxEventCallback(&huart2, uart2_rx_dma.pos);
+    } else if (uart2_rx_dma.pos == uart2_rx_dma.size) {
+      HAL_UARTEx_RxEventCallback(&huart2, uart2_rx_dma.size);
+      uart2_rx_dma.pos = 0;
+    }
+  }
+  HAL_UARTEx_RxEventCallback(&huart2, uart2_rx_dma.pos);
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  UNUSED(huart);
+}
+
+__weak void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+  UNUSED(huart);
+  UNUSED(Size);
+}
+
+__weak void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+  UNUSED(huart);
+}
+
+uint64_t sim_hal_next_event(void) {
+  uint64_t next = i2c2_dma.active ? i2c2_dma.done_at : UINT64_MAX;
+  if (uart2_dma.active && uart2_dma.done_at < next) next = uart2_dma.done_at;
+  if (uart2_rx.active && uart2_rx.done_at < next) next = uart2_rx.done_at;
+  return next;
+}
+
+void sim_hal_run_events(uint64_t now) {
+  if (i2c2_dma.active && now >= i2c2_dma.done_at) {
+    i2c2_dma.active = 0;
+    mpu_model_read(i2c2_dma.reg, i2c2_dma.data, i2c2_dma.size);
+    hi2c2.State = HAL_I2C_STATE_READY;
+    sim_in_irq++;
+    HAL_I2C_MemRxCpltCallback(&hi2c2);
+    sim_in_irq--;
+  }
+  if (uart2_dma.active && now >= uart2_dma.done_at) {
+    uart2_dma.active = 0;
+    if (uart2_capture) fwrite(uart2_dma.data, 1, uart2_dma.size, uart2_capture);
+    huart2.gState = HAL_UART_STATE_READY;
+    sim_in_irq++;
+    HAL_UART_TxCpltCallback(&huart2);
+    sim_in_irq--;
+  }
+  if (uart2_rx.active && now >= uart2_rx.done_at) {
+    uart2_rx.active = 0;
+    sim_in_irq++;
+    uart2_rx_deliver();
+    sim_in_irq--;
+  }
+}
+
+/* --------------------------------------------------------------- FLASH -- */
+#define FLASH_PROGRAM_US    52U     // halfword program time (datasheet t_prog)
+#define FLASH_ERASE_US      20000U  // page erase time (datasheet t_ERASE)
+
+static int flash_locked = 1;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+  flash_locked = 0;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+  flash_locked = 1;
+  return HAL_OK;
+}
+
+static int flash_range_ok(uintptr_t addr, uint32_t len) {
+  return addr >= FLASH_BASE && addr + len <= FLASH_BASE + SIM_FLASH_SIZE;
+}
+
+// Like the F1: only 0xFFFF can be programmed, except for writing 0x0000
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uintptr_t Address, uint64_t Data) {
+  uint16_t cur, v = (uint16_t)Data;
+  if (flash_locked || TypeProgram != FLASH_TYPEPROGRAM_HALFWORD || (Address & 1U) ||
+      !flash_range_ok(Address, 2)) {
+    return HAL_ERROR;
+  }
+  memcpy(&cur, (const void *)Address, 2);
+  sim_world_flash_op();
+  sim_advance_us(FLASH_PROGRAM_US);
+  if (cur != 0xFFFFU && v != 0) return HAL_ERROR;
+  memcpy((void *)Address, &v, 2);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError) {
+  uint32_t len = pEraseInit->NbPages * FLASH_PAGE_SIZE;
+  *PageError = 0xFFFFFFFFU;
+  if (flash_locked || pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES ||
+      (pEraseInit->PageAddress - FLASH_BASE) % FLASH_PAGE_SIZE || !flash_range_ok(pEraseInit->PageAddress, len)) {
+    return HAL_ERROR;
+  }
+  sim_world_flash_op();
+  sim_advance_us((uint64_t)FLASH_ERASE_US * pEraseInit->NbPages);
+  memset((void *)pEraseInit->PageAddress, 0xFF, len);
+  return HAL_OK;
+}
+
+/* ----------------------------------------------------------------- ADC -- */
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc) {
+  (void)hadc;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length) {
+  if (hadc != &hadc1) return HAL_ERROR;
+  adc_dma.buf = (uint16_t *)pData;
+  adc_dma.len = Length;
+  return HAL_OK;
+}
+
+// A steady input fills the whole circular buffer
+void sim_adc_set(uint16_t counts) {
+  for (uint32_t i = 0; i < adc_dma.len; i++) {
+    adc_dma.buf[i] = counts;
+  }
+}
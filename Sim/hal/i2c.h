@@ -0,0 +1,8 @@
+// SIL stand-in for Core/Inc/i2c.h
+#ifndef SIM_I2C_H
+#define SIM_I2C_H
+#include "stm32f1xx_hal.h"
+extern I2C_HandleTypeDef hi2c1;
+extern I2C_HandleTypeDef hi2c2;
+extern DMA_HandleTypeDef hdma_i2c2_rx;
+#endif //SIM_I2C_H
@@ -0,0 +1,6 @@
+// SIL stand-in for Core/Inc/main.h
+#ifndef SIM_MAIN_H
+#define SIM_MAIN_H
+#include "stm32f1xx_hal.h"
+void Error_Handler(void);
+#endif //SIM_MAIN_H
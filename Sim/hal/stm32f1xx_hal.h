@@ -0,0 +1,346 @@
+//
+// Host-side stand-in for the STM32F1 HAL used by the SIL build.
+// Peripherals are plain structs in RAM; only what App/ touches is declared.
+//
+
+#ifndef SIM_STM32F1XX_HAL_H
+#define SIM_STM32F1XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __IO    volatile
+#define __weak  __attribute__((weak))
+#define UNUSED(X) (void)(X)
+
+typedef enum {
+  HAL_OK = 0x00U,
+  HAL_ERROR = 0x01U,
+  HAL_BUSY = 0x02U,
+  HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum { RESET = 0, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+
+/* ---------------------------------------------------------------- Core -- */
+typedef enum {
+  EXTI0_IRQn = 6,
+  DMA1_Channel1_IRQn = 11,
+  DMA1_Channel5_IRQn = 15,
+  DMA1_Channel6_IRQn = 16,
+  DMA1_Channel7_IRQn = 17,
+  ADC1_2_IRQn = 18,
+  EXTI9_5_IRQn = 23,
+  TIM1_UP_IRQn = 25,
+  TIM2_IRQn = 28,
+  TIM3_IRQn = 29,
+  TIM4_IRQn = 30,
+  I2C2_EV_IRQn = 33,
+  I2C2_ER_IRQn = 34,
+  USART2_IRQn = 38,
+  EXTI15_10_IRQn = 40,
+  SIM_IRQ_COUNT = 64
+} IRQn_Type;
+
+typedef struct {
+  __IO uint32_t CTRL;
+  __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+  __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern uint32_t SystemCoreClock;
+extern DWT_Type sim_dwt;
+extern CoreDebug_Type sim_core_debug;
+#define DWT         (&sim_dwt)
+#define CoreDebug   (&sim_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+
+#define __CLZ(x)            ((uint8_t)((x) ? __builtin_clz(x) : 32))
+#define __disable_irq()     do { } while (0)
+#define __enable_irq()      do { } while (0)
+#define __NOP()             sim_poll()
+#define __DSB()             do { } while (0)
+#define __get_PRIMASK()     (0U)
+#define __set_PRIMASK(x)    ((void)(x))
+
+// one pass through a polling loop in thread context costs simulated time
+void sim_poll(void);
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+/* ---------------------------------------------------------------- GPIO -- */
+typedef struct {
+  __IO uint32_t CRL;
+  __IO uint32_t CRH;
+  __IO uint32_t IDR;
+  __IO uint32_t ODR;
+  __IO uint32_t BSRR;
+  __IO uint32_t BRR;
+  __IO uint32_t LCKR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef sim_gpioa, sim_gpiob, sim_gpioc;
+#define GPIOA (&sim_gpioa)
+#define GPIOB (&sim_gpiob)
+#define GPIOC (&sim_gpioc)
+
+#define GPIO_PIN_0      ((uint16_t)0x0001)
+#define GPIO_PIN_1      ((uint16_t)0x0002)
+#define GPIO_PIN_2      ((uint16_t)0x0004)
+#define GPIO_PIN_3      ((uint16_t)0x0008)
+#define GPIO_PIN_4      ((uint16_t)0x0010)
+#define GPIO_PIN_5      ((uint16_t)0x0020)
+#define GPIO_PIN_6      ((uint16_t)0x0040)
+#define GPIO_PIN_7      ((uint16_t)0x0080)
+#define GPIO_PIN_8      ((uint16_t)0x0100)
+#define GPIO_PIN_9      ((uint16_t)0x0200)
+#define GPIO_PIN_10     ((uint16_t)0x0400)
+#define GPIO_PIN_11     ((uint16_t)0x0800)
+#define GPIO_PIN_12     ((uint16_t)0x1000)
+#define GPIO_PIN_13     ((uint16_t)0x2000)
+#define GPIO_PIN_14     ((uint16_t)0x4000)
+#define GPIO_PIN_15     ((uint16_t)0x8000)
+#define GPIO_PIN_All    ((uint16_t)0xFFFF)
+
+typedef enum {
+  GPIO_PIN_RESET = 0U,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+} GPIO_InitTypeDef;
+
+#define GPIO_MODE_INPUT         0x00000000U
+#define GPIO_MODE_OUTPUT_PP     0x00000001U
+#define GPIO_MODE_OUTPUT_OD     0x00000011U
+#define GPIO_MODE_AF_OD         0x00000012U
+#define GPIO_MODE_IT_RISING     0x10110000U
+#define GPIO_NOPULL             0x00000000U
+#define GPIO_SPEED_FREQ_HIGH    0x00000003U
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+#define __HAL_GPIO_EXTI_CLEAR_IT(__EXTI_LINE__) ((void)(__EXTI_LINE__))
+
+/* ----------------------------------------------------------------- TIM -- */
+typedef struct {
+  __IO uint32_t CR1;
+  __IO uint32_t CR2;
+  __IO uint32_t SMCR;
+  __IO uint32_t DIER;
+  __IO uint32_t SR;
+  __IO uint32_t EGR;
+  __IO uint32_t CCMR1;
+  __IO uint32_t CCMR2;
+  __IO uint32_t CCER;
+  __IO uint32_t CNT;
+  __IO uint32_t PSC;
+  __IO uint32_t ARR;
+  __IO uint32_t RCR;
+  __IO uint32_t CCR1;
+  __IO uint32_t CCR2;
+  __IO uint32_t CCR3;
+  __IO uint32_t CCR4;
+  __IO uint32_t BDTR;
+  __IO uint32_t DCR;
+  __IO uint32_t DMAR;
+} TIM_TypeDef;
+
+extern TIM_TypeDef sim_tim1, sim_tim2, sim_tim3, sim_tim4;
+#define TIM1 (&sim_tim1)
+#define TIM2 (&sim_tim2)
+#define TIM3 (&sim_tim3)
+#define TIM4 (&sim_tim4)
+
+typedef struct {
+  uint32_t Prescaler;
+  uint32_t CounterMode;
+  uint32_t Period;
+  uint32_t ClockDivision;
+  uint32_t RepetitionCounter;
+  uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+  TIM_TypeDef *Instance;
+  TIM_Base_InitTypeDef Init;
+} TIM_HandleTypeDef;
+
+#define TIM_CHANNEL_1   0x00000000U
+#define TIM_CHANNEL_2   0x00000004U
+#define TIM_CHANNEL_3   0x00000008U
+#define TIM_CHANNEL_4   0x0000000CU
+#define TIM_CHANNEL_ALL 0x0000003CU
+
+#define __HAL_TIM_SET_COMPARE(__HANDLE__, __CHANNEL__, __COMPARE__) \
+  (*(__IO uint32_t *)(&((__HANDLE__)->Instance->CCR1) + ((__CHANNEL__) >> 2U)) = (__COMPARE__))
+#define __HAL_TIM_GET_COMPARE(__HANDLE__, __CHANNEL__) \
+  (*(__IO uint32_t *)(&((__HANDLE__)->Instance->CCR1) + ((__CHANNEL__) >> 2U)))
+#define __HAL_TIM_SET_COUNTER(__HANDLE__, __COUNTER__) ((__HANDLE__)->Instance->CNT = (__COUNTER__))
+#define __HAL_TIM_GET_COUNTER(__HANDLE__) ((__HANDLE__)->Instance->CNT)
+#define __HAL_TIM_GET_AUTORELOAD(__HANDLE__) ((__HANDLE__)->Instance->ARR)
+#define TIM_IT_UPDATE   (1U << 0)
+#define TIM_FLAG_UPDATE (1U << 0)
+#define __HAL_TIM_ENABLE_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->Instance->DIER |= (__INTERRUPT__))
+#define __HAL_TIM_DISABLE_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->Instance->DIER &= ~(__INTERRUPT__))
+#define __HAL_TIM_GET_IT_SOURCE(__HANDLE__, __INTERRUPT__) \
+  ((((__HANDLE__)->Instance->DIER & (__INTERRUPT__)) == (__INTERRUPT__)) ? SET : RESET)
+#define __HAL_TIM_GET_FLAG(__HANDLE__, __FLAG__) (((__HANDLE__)->Instance->SR & (__FLAG__)) == (__FLAG__))
+#define __HAL_TIM_CLEAR_FLAG(__HANDLE__, __FLAG__) ((__HANDLE__)->Instance->SR = ~(__FLAG__))
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_Encoder_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+/* ----------------------------------------------------------------- I2C -- */
+typedef enum {
+  HAL_I2C_STATE_RESET = 0x00U,
+  HAL_I2C_STATE_READY = 0x20U,
+  HAL_I2C_STATE_BUSY = 0x24U,
+  HAL_I2C_STATE_BUSY_TX = 0x21U,
+  HAL_I2C_STATE_BUSY_RX = 0x22U
+} HAL_I2C_StateTypeDef;
+
+typedef struct {
+  uint32_t ClockSpeed;
+  uint32_t DutyCycle;
+  uint32_t OwnAddress1;
+  uint32_t AddressingMode;
+} I2C_InitTypeDef;
+
+typedef struct __I2C_HandleTypeDef {
+  void *Instance;
+  I2C_InitTypeDef Init;
+  __IO HAL_I2C_StateTypeDef State;
+  __IO uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+typedef struct {
+  void *Instance;
+} DMA_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+
+#define I2C_MEMADD_SIZE_8BIT    0x00000001U
+
+#define HAL_I2C_ERROR_NONE      0x00000000U
+#define HAL_I2C_ERROR_BERR      0x00000001U
+#define HAL_I2C_ERROR_ARLO      0x00000002U
+#define HAL_I2C_ERROR_AF        0x00000004U
+#define HAL_I2C_ERROR_OVR       0x00000008U
+#define HAL_I2C_ERROR_DMA       0x00000010U
+#define HAL_I2C_ERROR_TIMEOUT   0x00000020U
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                          uint16_t Size, uint32_t Timeout);
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+/* ----------------------------------------------------------------- ADC -- */
+// ADC1 converts continuously into a circular DMA buffer; the world model
+// writes the battery divider voltage into it
+typedef struct {
+  void *Instance;
+  DMA_HandleTypeDef *DMA_Handle;
+} ADC_HandleTypeDef;
+
+#define DMA_IT_TC   0x00000002U
+#define DMA_IT_HT   0x00000004U
+#define __HAL_DMA_DISABLE_IT(__HANDLE__, __INTERRUPT__) ((void)(__HANDLE__), (void)(__INTERRUPT__))
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length);
+
+/* ---------------------------------------------------------------- UART -- */
+// USART2 transmit DMA: the frame leaves at the configured baud rate, then
+// HAL_UART_TxCpltCallback runs like the USART2 TC interrupt would.
+// Receive: circular DMA with HT/TC/IDLE events (HAL_UARTEx_RxEventCallback);
+// lines injected with sim_uart_rx() arrive at the configured baud rate.
+// No HC-05 is modelled, so blocking receives (AT replies) time out.
+typedef enum {
+  HAL_UART_STATE_RESET = 0x00U,
+  HAL_UART_STATE_READY = 0x20U,
+  HAL_UART_STATE_BUSY_TX = 0x21U,
+  HAL_UART_STATE_BUSY_RX = 0x22U
+} HAL_UART_StateTypeDef;
+
+typedef struct {
+  uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef struct {
+  void *Instance;
+  UART_InitTypeDef Init;
+  DMA_HandleTypeDef *hdmatx;
+  DMA_HandleTypeDef *hdmarx;
+  __IO HAL_UART_StateTypeDef gState;
+  __IO HAL_UART_StateTypeDef RxState;
+  __IO uint32_t ErrorCode;
+} UART_HandleTypeDef;
+
+#define HAL_UART_ERROR_DMA  0x00000010U
+
+#define __HAL_UART_FLUSH_DRREGISTER(__HANDLE__) ((void)(__HANDLE__))
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+
+/* --------------------------------------------------------------- FLASH -- */
+// The 64 KB main flash is an array; FLASH_BASE points at it
+#define SIM_FLASH_SIZE              0x10000U
+extern uint8_t sim_flash[SIM_FLASH_SIZE];
+#define FLASH_BASE                  ((uintptr_t)sim_flash)
+#define FLASH_PAGE_SIZE             0x400U
+#define FLASH_TYPEPROGRAM_HALFWORD  0x01U
+#define FLASH_TYPEERASE_PAGES       0x00U
+
+typedef struct {
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uintptr_t PageAddress;
+  uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uintptr_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+
+#endif //SIM_STM32F1XX_HAL_H
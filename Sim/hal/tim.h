@@ -0,0 +1,9 @@
+// SIL stand-in for Core/Inc/tim.h
+#ifndef SIM_TIM_H
+#define SIM_TIM_H
+#include "stm32f1xx_hal.h"
+extern TIM_HandleTypeDef htim1;
+extern TIM_HandleTypeDef htim2;
+extern TIM_HandleTypeDef htim3;
+extern TIM_HandleTypeDef htim4;
+#endif //SIM_TIM_H
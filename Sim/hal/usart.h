@@ -0,0 +1,7 @@
+// SIL stand-in for Core/Inc/usart.h
+#ifndef SIM_USART_H
+#define SIM_USART_H
+#include "stm32f1xx_hal.h"
+extern UART_HandleTypeDef huart2;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+#endif //SIM_USART_H
@@ -0,0 +1,280 @@
+//
+// MPU6050 register / DMP memory / FIFO model for the SIL build.
+//
+// Register writes and reads behave like the real part as far as
+// inv_mpu.c cares: burst accesses auto-increment except on MEM_R_W and
+// FIFO_R_W, MEM_R_W walks DMP memory through BANK_SEL/MEM_START_ADDR, and
+// FIFO_COUNT reflects the byte queue. DMP packets are produced by the
+// world model rather than by executing the DMP image. With the DMP off,
+// samples go into the FIFO as raw accel/gyro words selected by FIFO_EN.
+//
+#include "mpu_model.h"
+#include "Sensor/inv_mpu_dmp_motion_driver.h"
+#include <math.h>
+#include <string.h>
+
+#define REG_SMPLRT_DIV      0x19
+#define REG_FIFO_EN         0x23
+#define REG_INT_ENABLE      0x38
+#define REG_INT_STATUS      0x3A
+#define REG_ACCEL_XOUT_H    0x3B
+#define REG_GYRO_XOUT_H     0x43
+#define REG_USER_CTRL       0x6A
+#define REG_PWR_MGMT_1      0x6B
+#define REG_BANK_SEL        0x6D
+#define REG_MEM_START_ADDR  0x6E
+#define REG_MEM_R_W         0x6F
+#define REG_FIFO_COUNT_H    0x72
+#define REG_FIFO_COUNT_L    0x73
+#define REG_FIFO_R_W        0x74
+#define REG_WHO_AM_I        0x75
+
+#define BIT_DMP_EN          0x80
+#define BIT_FIFO_EN         0x40
+#define BIT_DMP_RST         0x08
+#define BIT_FIFO_RST        0x04
+#define BIT_DEVICE_RESET    0x80
+#define BIT_DMP_INT         0x02
+#define BIT_DATA_RDY        0x01
+#define BIT_FIFO_EN_ACCEL   0x08
+#define BIT_FIFO_EN_GYRO    0x70
+#define BIT_FIFO_OVERFLOW   0x10
+
+static uint8_t regs[128];
+static uint8_t dmp_mem[4096];
+static uint8_t fifo[MPU_MODEL_FIFO_SIZE];
+static uint16_t fifo_head;
+static uint16_t fifo_len;
+static uint32_t fifo_dropped;
+
+static void fifo_clear(void) {
+  fifo_head = 0;
+  fifo_len = 0;
+}
+
+static void fifo_put(uint8_t b) {
+  if (fifo_len == MPU_MODEL_FIFO_SIZE) {
+    // Full: the oldest byte is lost, as on the real part
+    fifo_head = (fifo_head + 1) % MPU_MODEL_FIFO_SIZE;
+    fifo_len--;
+    regs[REG_INT_STATUS] |= BIT_FIFO_OVERFLOW;
+    fifo_dropped++;
+  }
+  fifo[(fifo_head + fifo_len) % MPU_MODEL_FIFO_SIZE] = b;
+  fifo_len++;
+}
+
+static uint8_t fifo_get(void) {
+  uint8_t b;
+  if (fifo_len == 0) return 0;
+  b = fifo[fifo_head];
+  fifo_head = (fifo_head + 1) % MPU_MODEL_FIFO_SIZE;
+  fifo_len--;
+  return b;
+}
+
+void mpu_model_reset(void) {
+  memset(regs, 0, sizeof(regs));
+  memset(dmp_mem, 0, sizeof(dmp_mem));
+  regs[REG_PWR_MGMT_1] = 0x40;
+  regs[REG_WHO_AM_I] = 0x68;
+  fifo_clear();
+  fifo_dropped = 0;
+}
+
+static uint16_t mem_addr(void) {
+  return (uint16_t)(((regs[REG_BANK_SEL] << 8) | regs[REG_MEM_START_ADDR]) & 0x0FFF);
+}
+
+static void write_reg(uint8_t reg, uint8_t v) {
+  switch (reg) {
+    case REG_PWR_MGMT_1:
+      if (v & BIT_DEVICE_RESET) {
+        mpu_model_reset();
+        return;
+      }
+      break;
+    case REG_USER_CTRL:
+      if (v & BIT_FIFO_RST) fifo_clear();
+      v &= (uint8_t)~(BIT_FIFO_RST | BIT_DMP_RST | 0x01);
+      break;
+    case REG_MEM_R_W:
+      dmp_mem[mem_addr()] = v;
+      regs[REG_MEM_START_ADDR]++;
+      return;
+    case REG_FIFO_R_W:
+      fifo_put(v);
+      return;
+    case REG_WHO_AM_I:
+    case REG_FIFO_COUNT_H:
+    case REG_FIFO_COUNT_L:
+      return;
+    default:
+      break;
+  }
+  regs[reg & 0x7F] = v;
+}
+
+static uint8_t read_reg(uint8_t reg) {
+  uint8_t v;
+  switch (reg) {
+    case REG_MEM_R_W:
+      v = dmp_mem[mem_addr()];
+      regs[REG_MEM_START_ADDR]++;
+      return v;
+    case REG_FIFO_R_W:
+      return fifo_get();
+    case REG_FIFO_COUNT_H:
+      return (uint8_t)(fifo_len >> 8);
+    case REG_FIFO_COUNT_L:
+      return (uint8_t)fifo_len;
+    case REG_INT_STATUS:
+      v = regs[REG_INT_STATUS];
+      regs[REG_INT_STATUS] = 0;
+      return v;
+    default:
+      return regs[reg & 0x7F];
+  }
+}
+
+static int auto_increment(uint8_t reg) {
+  return reg != REG_MEM_R_W && reg != REG_FIFO_R_W;
+}
+
+int mpu_model_write(uint8_t reg, const uint8_t *data, uint16_t len) {
+  for (uint16_t i = 0; i < len; i++) {
+    write_reg(reg, data[i]);
+    if (auto_increment(reg)) reg++;
+  }
+  return 0;
+}
+
+int mpu_model_read(uint8_t reg, uint8_t *data, uint16_t len) {
+  for (uint16_t i = 0; i < len; i++) {
+    data[i] = read_reg(reg);
+    if (auto_increment(reg)) reg++;
+  }
+  return 0;
+}
+
+static void put_be32(int32_t v) {
+  fifo_put((uint8_t)(v >> 24));
+  fifo_put((uint8_t)(v >> 16));
+  fifo_put((uint8_t)(v >> 8));
+  fifo_put((uint8_t)v);
+}
+
+static void put_be16(int16_t v) {
+  fifo_put((uint8_t)(v >> 8));
+  fifo_put((uint8_t)v);
+}
+
+static int16_t sat16(float v) {
+  if (v > 32767.0f) return 32767;
+  if (v < -32768.0f) return -32768;
+  return (int16_t)lrintf(v);
+}
+
+int mpu_model_dmp_enabled(void) {
+  return (regs[REG_USER_CTRL] & BIT_DMP_EN) != 0;
+}
+
+uint32_t mpu_model_sample_period_us(void) {
+  if (mpu_model_dmp_enabled()) {
+    unsigned short rate = 0;
+    dmp_get_fifo_rate(&rate);
+    return rate ? 1000000U / rate : 10000U;
+  }
+  // DLPF on: 1 kHz internal rate divided by 1 + SMPLRT_DIV
+  return 1000U * (1U + regs[REG_SMPLRT_DIV]);
+}
+
+// Raw sample in the sensor frame. The board mounts the chip with x and y
+// reversed (gyro_orientation in mpu6050_dmp.c), so forward pitch shows up
+// as +x gravity and -y rate.
+static int push_raw(const MPU_ModelSampleTypeDef *s) {
+  uint8_t en = regs[REG_FIFO_EN];
+
+  if (!(regs[REG_USER_CTRL] & BIT_FIFO_EN))
+    return 0;
+  if (en & BIT_FIFO_EN_ACCEL) {
+    put_be16(sat16(s->accel_g[0] * 16384.0f));
+    put_be16(sat16(s->accel_g[1] * 16384.0f));
+    put_be16(sat16(s->accel_g[2] * 16384.0f));
+  }
+  if (en & BIT_FIFO_EN_GYRO) {
+    put_be16(0);
+    put_be16(sat16(-s->pitch_rate_dps * 16.4f));
+    put_be16(0);
+  }
+  return (regs[REG_INT_ENABLE] & BIT_DATA_RDY) != 0;
+}
+
+static void set_be16(uint8_t reg, int16_t v) {
+  regs[reg] = (uint8_t)(v >> 8);
+  regs[reg + 1] = (uint8_t)v;
+}
+
+// Data registers follow every sample, in the same frame and scale as push_raw
+static void update_data_regs(const MPU_ModelSampleTypeDef *s) {
+  for (uint8_t i = 0; i < 3; i++)
+    set_be16((uint8_t)(REG_ACCEL_XOUT_H + 2 * i), sat16(s->accel_g[i] * 16384.0f));
+  set_be16(REG_GYRO_XOUT_H, 0);
+  set_be16(REG_GYRO_XOUT_H + 2, sat16(-s->pitch_rate_dps * 16.4f));
+  set_be16(REG_GYRO_XOUT_H + 4, 0);
+}
+
+int mpu_model_push_sample(const MPU_ModelSampleTypeDef *s) {
+  update_data_regs(s);
+  return mpu_model_dmp_enabled() ? mpu_model_push_dmp(s) : push_raw(s);
+}
+
+int mpu_model_push_dmp(const MPU_ModelSampleTypeDef *s) {
+  unsigned short features = 0;
+
+  if ((regs[REG_USER_CTRL] & (BIT_DMP_EN | BIT_FIFO_EN)) != (BIT_DMP_EN | BIT_FIFO_EN))
+    return 0;
+  dmp_get_enabled_features(&features);
+
+  if (features & (DMP_FEATURE_LP_QUAT | DMP_FEATURE_6X_LP_QUAT)) {
+    // Rotation about y chosen so that -asin(2(q1q3 - q0q2)) == pitch
+    float half = s->pitch_deg * (3.14159265f / 180.0f) * 0.5f;
+    put_be32((int32_t)lrint(cos(half) * 1073741824.0));
+    put_be32(0);
+    put_be32((int32_t)lrint(sin(half) * 1073741824.0));
+    put_be32(0);
+  }
+  if (features & DMP_FEATURE_SEND_RAW_ACCEL) {
+    put_be16(sat16(s->accel_g[0] * 16384.0f));
+    put_be16(sat16(s->accel_g[1] * 16384.0f));
+    put_be16(sat16(s->accel_g[2] * 16384.0f));
+  }
+  if (features & (DMP_FEATURE_SEND_RAW_GYRO | DMP_FEATURE_SEND_CAL_GYRO)) {
+    put_be16(0);
+    put_be16(sat16(s->pitch_rate_dps * 16.4f));
+    put_be16(0);
+  }
+  if (features & (DMP_FEATURE_TAP | DMP_FEATURE_ANDROID_ORIENT)) {
+    put_be32(0);
+  }
+  return (regs[REG_INT_ENABLE] & BIT_DMP_INT) != 0;
+}
+
+void mpu_model_save(MPU_ModelSnapshotTypeDef *snap) {
+  memcpy(snap->regs, regs, sizeof(regs));
+  memcpy(snap->dmp_mem, dmp_mem, sizeof(dmp_mem));
+}
+
+void mpu_model_restore(const MPU_ModelSnapshotTypeDef *snap) {
+  memcpy(regs, snap->regs, sizeof(regs));
+  memcpy(dmp_mem, snap->dmp_mem, sizeof(dmp_mem));
+  fifo_clear();
+}
+
+uint16_t mpu_model_fifo_count(void) {
+  return fifo_len;
+}
+
+uint32_t mpu_model_fifo_dropped(void) {
+  return fifo_dropped;
+}
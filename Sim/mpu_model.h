@@ -0,0 +1,43 @@
+//
+// MPU6050 register / DMP memory / FIFO model for the SIL build.
+//
+
+#ifndef SIM_MPU_MODEL_H
+#define SIM_MPU_MODEL_H
+
+#include <stdint.h>
+
+#define MPU_MODEL_ADDR      0xD0    // 8-bit address used by inv_mpu.c
+#define MPU_MODEL_FIFO_SIZE 1024
+
+typedef struct {
+  float pitch_deg;      // pitch as the firmware computes it from the quaternion
+  float pitch_rate_dps; // body pitch rate
+  float accel_g[3];     // specific force in the sensor frame
+} MPU_ModelSampleTypeDef;
+
+void mpu_model_reset(void);
+int mpu_model_write(uint8_t reg, const uint8_t *data, uint16_t len);
+int mpu_model_read(uint8_t reg, uint8_t *data, uint16_t len);
+
+// DMP output: appends one packet to the FIFO if the DMP and FIFO are enabled.
+// Returns 1 when the INT pin should pulse.
+int mpu_model_push_dmp(const MPU_ModelSampleTypeDef *s);
+// One sensor sample: a DMP packet when the DMP is on, raw FIFO words otherwise.
+// Returns 1 when the INT pin should pulse.
+int mpu_model_push_sample(const MPU_ModelSampleTypeDef *s);
+int mpu_model_dmp_enabled(void);
+uint32_t mpu_model_sample_period_us(void);   // DMP output or raw sample period
+uint16_t mpu_model_fifo_count(void);
+
+// Registers and DMP memory, kept across an MCU-only reset (warm boot)
+typedef struct {
+  uint8_t regs[128];
+  uint8_t dmp_mem[4096];
+} MPU_ModelSnapshotTypeDef;
+
+void mpu_model_save(MPU_ModelSnapshotTypeDef *snap);
+void mpu_model_restore(const MPU_ModelSnapshotTypeDef *snap);
+uint32_t mpu_model_fifo_dropped(void);   // bytes lost to FIFO overflow
+
+#endif //SIM_MPU_MODEL_H
@@ -0,0 +1,116 @@
+//
+// Two-wheel inverted pendulum with DC gear motors, for the SIL build.
+//
+// Generalised coordinates are wheel travel x and body tilt phi. A motor
+// torque tau acts between body and wheels, so it enters as tau/r on x and
+// -tau on phi:
+//
+//   (M + m + Iw/r^2) x'' + M l cos(phi) phi''  = tau/r + M l sin(phi) phi'^2 - c x'
+//   M l cos(phi) x''     + (Ib + M l^2) phi''  = -tau + M g l sin(phi)
+//
+// The gearbox-reflected rotor inertia Jr spins at x'/r - phi', which adds
+// Jr/r^2, -Jr/r and Jr to the mass matrix.
+//
+#include "plant.h"
+#include <math.h>
+
+void plant_default_params(Plant_ParamsTypeDef *p) {
+  p->body_mass = 0.80f;
+  p->com_height = 0.08f;
+  p->body_inertia = 0.0015f;
+  p->wheel_mass = 0.10f;
+  p->wheel_radius = 0.033f;
+  p->wheel_inertia = 5.4e-5f;
+  p->rolling_damping = 0.05f;
+  p->vbat = 7.4f;
+  p->resistance = 3.0f;
+  p->inductance = 0.002f;
+  p->kt = 0.30f;
+  p->rotor_inertia = 2.0e-3f;
+  p->coulomb_friction = 0.02f;
+  p->viscous_friction = 0.002f;
+  p->gravity = 9.81f;
+}
+
+void plant_reset(Plant_StateTypeDef *s, double phi0) {
+  s->x = 0.0;
+  s->x_dot = 0.0;
+  s->phi = phi0;
+  s->phi_dot = 0.0;
+  s->current[0] = 0.0;
+  s->current[1] = 0.0;
+  s->torque = 0.0;
+}
+
+// Motor current after dt, integrated exactly for the R-L circuit
+static double motor_current(const Plant_ParamsTypeDef *p, const Motor_CommandTypeDef *cmd,
+                            double i, double omega, double dt) {
+  double v, i_ss;
+  double decay = exp(-dt * p->resistance / p->inductance);
+
+  switch (cmd->mode) {
+    case MOTOR_DRIVE_FORWARD:  v = cmd->duty * p->vbat; break;
+    case MOTOR_DRIVE_BACKWARD: v = -cmd->duty * p->vbat; break;
+    case MOTOR_DRIVE_BRAKE:    v = 0.0; break;
+    default:
+      // Coast: the bridge is open, the winding current collapses
+      return 0.0;
+  }
+  i_ss = (v - p->kt * omega) / p->resistance;
+  return i_ss + (i - i_ss) * decay;
+}
+
+void plant_step(const Plant_ParamsTypeDef *p, Plant_StateTypeDef *s,
+                const Motor_CommandTypeDef cmd[2], double dt) {
+  const double M = p->body_mass, m = p->wheel_mass, l = p->com_height;
+  const double r = p->wheel_radius, g = p->gravity;
+  // gearbox output speed relative to the body
+  double omega = s->x_dot / r - s->phi_dot;
+  double tau = 0.0;
+
+  for (int k = 0; k < 2; k++) {
+    s->current[k] = motor_current(p, &cmd[k], s->current[k], omega, dt);
+    tau += p->kt * s->current[k];
+    tau -= p->coulomb_friction * tanh(omega / 0.5) + p->viscous_friction * omega;
+  }
+  s->torque = tau;
+
+  double c = cos(s->phi), sn = sin(s->phi);
+  double jr = p->rotor_inertia;
+  double a11 = M + m + (p->wheel_inertia + jr) / (r * r);
+  double a12 = M * l * c - jr / r;
+  double a22 = p->body_inertia + M * l * l + jr;
+  double b1 = tau / r + M * l * sn * s->phi_dot * s->phi_dot - p->rolling_damping * s->x_dot;
+  double b2 = -tau + M * g * l * sn;
+  double det = a11 * a22 - a12 * a12;
+  double x_dd = (b1 * a22 - a12 * b2) / det;
+  double phi_dd = (a11 * b2 - a12 * b1) / det;
+
+  // semi-implicit Euler
+  s->x_dot += x_dd * dt;
+  s->phi_dot += phi_dd * dt;
+  s->x += s->x_dot * dt;
+  s->phi += s->phi_dot * dt;
+}
+
+// Body held level with the wheels off the ground: only the wheel and rotor
+// inertia load the motors (motor friction calibration)
+void plant_step_lifted(const Plant_ParamsTypeDef *p, Plant_StateTypeDef *s,
+                       const Motor_CommandTypeDef cmd[2], double dt) {
+  const double r = p->wheel_radius;
+  double omega = s->x_dot / r;
+  double tau = 0.0;
+
+  for (int k = 0; k < 2; k++) {
+    s->current[k] = motor_current(p, &cmd[k], s->current[k], omega, dt);
+    tau += p->kt * s->current[k];
+    tau -= p->coulomb_friction * tanh(omega / 0.5) + p->viscous_friction * omega;
+  }
+  s->torque = tau;
+
+  omega += tau / (p->wheel_inertia + p->rotor_inertia) * dt;
+  s->x_dot = omega * r;
+  s->x += s->x_dot * dt;
+  s->phi = 0.0;
+  s->phi_dot = 0.0;
+}
@@ -0,0 +1,57 @@
+//
+// Two-wheel inverted pendulum with DC gear motors, for the SIL build.
+//
+
+#ifndef SIM_PLANT_H
+#define SIM_PLANT_H
+
+typedef enum {
+  MOTOR_DRIVE_COAST = 0,  // IN1 = IN2 = 0: outputs off
+  MOTOR_DRIVE_FORWARD,    // IN1 = 1, IN2 = 0
+  MOTOR_DRIVE_BACKWARD,   // IN1 = 0, IN2 = 1
+  MOTOR_DRIVE_BRAKE       // IN1 = IN2 = 1: short brake
+} Motor_DriveTypeDef;
+
+typedef struct {
+  Motor_DriveTypeDef mode;
+  float duty;             // 0..1, already quantized by the timer
+} Motor_CommandTypeDef;
+
+typedef struct {
+  // body
+  float body_mass;        // kg
+  float com_height;       // axle to centre of mass, m
+  float body_inertia;     // about the centre of mass, kg m^2
+  // wheels (both together)
+  float wheel_mass;       // kg
+  float wheel_radius;     // m
+  float wheel_inertia;    // kg m^2
+  float rolling_damping;  // N s/m
+  // one motor + gearbox, referred to the wheel
+  float vbat;             // V
+  float resistance;       // ohm
+  float inductance;       // H
+  float kt;               // N m / A (== ke, V s/rad)
+  float rotor_inertia;    // rotor inertia times gear ratio^2, both motors, kg m^2
+  float coulomb_friction; // N m
+  float viscous_friction; // N m s/rad
+  float gravity;          // m/s^2
+} Plant_ParamsTypeDef;
+
+typedef struct {
+  double x;               // wheel travel, m
+  double x_dot;
+  double phi;             // body tilt from vertical, rad, positive = leaning forward
+  double phi_dot;
+  double current[2];      // motor currents, A
+  double torque;          // total wheel torque last step, N m
+} Plant_StateTypeDef;
+
+void plant_default_params(Plant_ParamsTypeDef *p);
+void plant_reset(Plant_StateTypeDef *s, double phi0);
+void plant_step(const Plant_ParamsTypeDef *p, Plant_StateTypeDef *s,
+                const Motor_CommandTypeDef cmd[2], double dt);
+void plant_step_lifted(const Plant_ParamsTypeDef *p, Plant_StateTypeDef *s,
+                       const Motor_CommandTypeDef cmd[2], double dt);
+
+#endif //SIM_PLANT_H
@@ -0,0 +1,436 @@
+//
+// Software-in-the-loop runner: boots the balance firmware against the HAL
+// shim and the pendulum plant, runs it faster than real time and reports
+// control quality. Sweeps fork one process per run so firmware statics
+// start from a clean image every time.
+//
+#include "sim.h"
+#include "mpu_model.h"
+#include "tim.h"
+#include "i2c.h"
+#include "usart.h"
+#include "Balance/balance_control.h"
+#include "Sensor/mpu6050_dmp.h"
+#include "System/profiler.h"
+#include "System/flash_store.h"
+#include "System/i2c_bus.h"
+#include "System/param.h"
+#include "Comm/telemetry.h"
+#include "Comm/tx_ring.h"
+#include "Comm/bluetooth_debug.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAIN_LOOP_US    20U     // one pass of the while(1) loop in main()
+#define CMD_GAP_US      200000U // --cmd lines are sent this far apart, the first one at release
+
+typedef struct {
+  int raw_hz;               // 0 = DMP mode
+  int dmp_profile;          // MPU6050_DMP_PROFILE_* + 1, 0 = firmware default
+  int rate_hz, lpf_hz;      // switched at run time after boot, 0 = keep
+  int set_kp, set_ki, set_kd, set_target, set_engine;
+  float kp, ki, kd, target;
+  PID_EngineTypeDef engine;
+} Sim_GainsTypeDef;
+
+typedef struct {
+  Sim_ResultTypeDef world;
+  MPU6050_AsyncStatsTypeDef async;
+  Balance_BootInfoTypeDef boot;
+  I2C_Bus_StatsTypeDef bus; // I2C2
+  uint32_t fifo_us;         // mean INT-to-parse time of one FIFO read
+  float kp, ki, kd;
+} Sim_RunResultTypeDef;
+
+static void board_init(void) {
+  // The parts of MX_*_Init() that App code depends on
+  TIM1->ARR = 3600 - 1;     // 20 kHz PWM, 3600 duty steps
+  htim1.Init.Period = 3600 - 1;
+  hi2c2.Init.ClockSpeed = 400000;
+}
+
+static void sensor_setup(const Sim_GainsTypeDef *g) {
+  if (g->raw_hz) Balance_Set_Sensor_Mode(MPU6050_MODE_RAW, (uint16_t)g->raw_hz);
+  if (g->dmp_profile) Balance_Set_Dmp_Profile((MPU6050_DMP_ProfileTypeDef)(g->dmp_profile - 1));
+}
+
+// State a previous boot leaves behind: the MPU as seen after an MCU-only
+// reset, and the flash contents
+typedef struct {
+  MPU_ModelSnapshotTypeDef mpu;
+  uint8_t flash[SIM_FLASH_SIZE];
+} Sim_PriorBootTypeDef;
+
+// Boot once in a child process (and calibrate the IMU / motors if asked) and capture
+// what it leaves behind
+static int prior_boot(const Sim_ConfigTypeDef *cfg, const Sim_GainsTypeDef *g,
+                      Sim_PriorBootTypeDef *snap) {
+  int fd[2];
+  pid_t pid;
+  ssize_t n;
+
+  if (pipe(fd) != 0) return -1;
+  pid = fork();
+  if (pid < 0) return -1;
+  if (pid == 0) {
+    static Sim_PriorBootTypeDef s;
+    Sim_ConfigTypeDef c = *cfg;
+    close(fd[0]);
+    c.csv = NULL;
+    c.tilt0_deg = 0.0;    // calibrating: held still at the balance point
+    c.i2c_fault = 0.0;
+    if (cfg->cal_vbat > 0.0) c.vbat = cfg->cal_vbat;
+    sim_hal_reset();
+    mpu_model_reset();
+    sim_world_init(&c);
+    board_init();
+    Flash_Store_Init();
+    Param_Init();
+    sensor_setup(g);
+    Balance_Init();
+    if (cfg->calibrated && Balance_Calibrate(BALANCE_CALIB_AT_BALANCE) != 0) _exit(1);
+    if (cfg->motor_calib) {
+      sim_world_lift(1);
+      if (Balance_Calibrate(BALANCE_CALIB_FRICTION) != 0) _exit(1);
+    }
+    mpu_model_save(&s.mpu);
+    memcpy(s.flash, sim_flash, sizeof(s.flash));
+    n = write(fd[1], &s, sizeof(s));
+    _exit(n == (ssize_t)sizeof(s) ? 0 : 1);
+  }
+  close(fd[1]);
+  n = 0;
+  while (n < (ssize_t)sizeof(*snap)) {
+    ssize_t r = read(fd[0], (char *)snap + n, sizeof(*snap) - n);
+    if (r <= 0) break;
+    n += r;
+  }
+  close(fd[0]);
+  waitpid(pid, NULL, 0);
+  return n == (ssize_t)sizeof(*snap) ? 0 : -1;
+}
+
+static void run_once(const Sim_ConfigTypeDef *cfg, const Sim_GainsTypeDef *g, Sim_RunResultTypeDef *out) {
+  static Sim_PriorBootTypeDef snap;
+  int prior = (cfg->warm_boot || cfg->calibrated || cfg->motor_calib) && prior_boot(cfg, g, &snap) == 0;
+  const Profiler_StatTypeDef *fifo;
+
+  sim_hal_reset();
+  mpu_model_reset();
+  if (prior && cfg->warm_boot) mpu_model_restore(&snap.mpu);
+  if (prior && (cfg->calibrated || cfg->motor_calib)) memcpy(sim_flash, snap.flash, sizeof(sim_flash));
+  sim_world_init(cfg);
+  board_init();
+
+  // Same boot sequence as Core/Src/main.c (robot held upright meanwhile)
+  Profiler_Init();
+  Flash_Store_Init();
+  Param_Init();
+  sensor_setup(g);
+  Balance_Init();
+  // No HC-05 is modelled: baud negotiation gets no AT reply and stays at the
+  // factory rate; --baud then stands in for the rate a real module negotiated
+  Bluetooth_Debug_Init(&huart2);
+  sim_uart_set_baud(cfg->baud);
+
+  if (g->rate_hz && Balance_Set_Rate((uint16_t)g->rate_hz, (uint16_t)g->lpf_hz) != 0) {
+    fprintf(stderr, "sil: Balance_Set_Rate(%d, %d) failed\n", g->rate_hz, g->lpf_hz);
+  }
+  // Gains go through the parameter registry (bounds-checked, committed by the first Balance_Control)
+  if (g->set_kp && Param_Set(PARAM_BAL_KP, g->kp) != 0) fprintf(stderr, "sil: kp out of range\n");
+  if (g->set_ki && Param_Set(PARAM_BAL_KI, g->ki) != 0) fprintf(stderr, "sil: ki out of range\n");
+  if (g->set_kd && Param_Set(PARAM_BAL_KD, g->kd) != 0) fprintf(stderr, "sil: kd out of range\n");
+  if (g->set_target && Param_Set(PARAM_BAL_TARGET, g->target) != 0) fprintf(stderr, "sil: target out of range\n");
+  PID_SetEngine(&balance_pid, g->set_engine ? g->engine : balance_pid.engine);
+
+  FILE *capture = NULL;
+  if (cfg->telemetry) {
+    capture = fopen(cfg->telemetry, "wb");
+    if (capture == NULL) perror(cfg->telemetry);
+    sim_uart_capture(capture);
+    Telemetry_Set_Rate((uint16_t)cfg->telemetry_hz);
+  } else {
+    sim_uart_capture(cfg->console);
+  }
+
+  sim_world_release();
+  uint64_t next_cmd_us = sim_now_us();
+  int cmd = 0;
+  while (!sim_world_done()) {
+    if (cmd < cfg->n_cmd && sim_now_us() >= next_cmd_us) {
+      char line[SIM_UART_RX_MAX];
+      int len = snprintf(line, sizeof(line), "%s\r\n", cfg->cmd[cmd]);
+      if (len >= (int)sizeof(line) || sim_uart_rx((const uint8_t *)line, (uint16_t)len) != 0) {
+        fprintf(stderr, "sil: could not send command '%s'\n", cfg->cmd[cmd]);
+      }
+      cmd++;
+      next_cmd_us += CMD_GAP_US;
+    }
+    Bluetooth_Debug_Process();
+    MPU6050_DMP_Process();
+    Balance_Control();
+    sim_advance_us(MAIN_LOOP_US);
+  }
+  if (cmd < cfg->n_cmd) {
+    fprintf(stderr, "sil: run ended before %d of the commands were sent\n", cfg->n_cmd - cmd);
+  }
+
+  sim_uart_capture(NULL);
+  if (capture) {
+    const Telemetry_StatsTypeDef *ts = Telemetry_Get_Stats();
+    fprintf(stderr, "sil: telemetry %d Hz at %u baud: sent=%u dropped=%u\n", cfg->telemetry_hz,
+            (unsigned)cfg->baud, (unsigned)ts->sent, (unsigned)ts->dropped);
+    fclose(capture);
+  }
+
+  sim_world_result(&out->world);
+  sim_world_close();
+  out->async = *MPU6050_DMP_Get_Async_Stats();
+  out->boot = *Balance_Get_Boot_Info();
+  out->bus = *I2C_Bus_Get_Stats(&hi2c2);
+  fifo = Profiler_Get_Stat(PROF_STAGE_FIFO_READ);
+  out->fifo_us = fifo->count ? (uint32_t)(fifo->sum / fifo->count / (SystemCoreClock / 1000000U)) : 0;
+  out->kp = balance_pid.kp;
+  out->ki = balance_pid.ki;
+  out->kd = balance_pid.kd;
+}
+
+// Run in a child process and collect the result through a pipe
+static int run_isolated(const Sim_ConfigTypeDef *cfg, const Sim_GainsTypeDef *g, Sim_RunResultTypeDef *out) {
+  int fd[2];
+  pid_t pid;
+  ssize_t n;
+
+  if (pipe(fd) != 0) return -1;
+  pid = fork();
+  if (pid < 0) return -1;
+  if (pid == 0) {
+    Sim_RunResultTypeDef r;
+    close(fd[0]);
+    run_once(cfg, g, &r);
+    n = write(fd[1], &r, sizeof(r));
+    _exit(n == (ssize_t)sizeof(r) ? 0 : 1);
+  }
+  close(fd[1]);
+  n = read(fd[0], out, sizeof(*out));
+  close(fd[0]);
+  waitpid(pid, NULL, 0);
+  return n == (ssize_t)sizeof(*out) ? 0 : -1;
+}
+
+static void print_header(void) {
+  printf("%8s %8s %8s  %-6s %7s %9s %9s %8s %8s %7s %6s %6s %4s %6s %5s %6s %7s %7s\n",
+         "kp", "ki", "kd", "result", "t_fall", "rms_tilt", "max_tilt", "drift_m",
+         "rms_duty", "pkts", "busy", "drop", "maxb", "ovf", "i2c_r", "rec_us", "fifo_us", "boot_ms");
+}
+
+static void print_result(const Sim_RunResultTypeDef *r) {
+  printf("%8.3f %8.4f %8.3f  %-6s %7.2f %9.3f %9.3f %8.3f %8.3f %7u %6u %6u %4u %6u %5u %6u %7u %6u%c%c\n",
+         r->kp, r->ki, r->kd, r->world.fell ? "FELL" : "OK", r->world.t_fall,
+         r->world.rms_tilt_deg, r->world.max_tilt_deg, r->world.drift_m, r->world.rms_duty,
+         (unsigned)r->async.packets, (unsigned)r->async.busy_skips,
+         (unsigned)r->async.dropped, (unsigned)r->async.max_batch, (unsigned)r->async.overflows,
+         (unsigned)r->bus.recoveries, (unsigned)r->bus.max_recover_us,
+         (unsigned)r->fifo_us,
+         (unsigned)r->boot.first_cycle_ms, r->boot.dmp_warm ? 'w' : ' ',
+         r->boot.calibrated ? 'c' : ' ');
+}
+
+static int parse_range(const char *s, float *lo, float *hi, int *n) {
+  return sscanf(s, "%f:%f:%d", lo, hi, n) == 3 && *n >= 1;
+}
+
+// Quality limits checked after a run, 0 = not checked
+typedef struct {
+  double rms_tilt_deg;
+  double max_tilt_deg;
+  double drift_m;
+} Sim_LimitsTypeDef;
+
+static int over_limits(const Sim_RunResultTypeDef *r, const Sim_LimitsTypeDef *lim) {
+  int over = 0;
+  if (r->world.late_duty > 0.0) {
+    fprintf(stderr, "sil: motors still driven (duty %.3f) after --expect-off\n", r->world.late_duty);
+    over = 1;
+  }
+  if (r->world.flash_driven > 0) {
+    fprintf(stderr, "sil: %u flash writes while the motors were driven\n", (unsigned)r->world.flash_driven);
+    over = 1;
+  }
+  if (lim->rms_tilt_deg > 0 && r->world.rms_tilt_deg > lim->rms_tilt_deg) {
+    fprintf(stderr, "sil: rms_tilt %.3f deg above --max-rms=%g\n", r->world.rms_tilt_deg, lim->rms_tilt_deg);
+    over = 1;
+  }
+  if (lim->max_tilt_deg > 0 && r->world.max_tilt_deg > lim->max_tilt_deg) {
+    fprintf(stderr, "sil: max_tilt %.3f deg above --max-tilt=%g\n", r->world.max_tilt_deg, lim->max_tilt_deg);
+    over = 1;
+  }
+  if (lim->drift_m > 0 && fabs(r->world.drift_m) > lim->drift_m) {
+    fprintf(stderr, "sil: drift %.3f m beyond --max-drift=%g\n", r->world.drift_m, lim->drift_m);
+    over = 1;
+  }
+  return over;
+}
+
+static void usage(const char *argv0) {
+  printf("usage: %s [options]\n"
+         "  --time=S            run time after release (default 10)\n"
+         "  --tilt=DEG          initial tilt, positive = forward (default 3)\n"
+         "  --noise=DEG         pitch noise, 1 sigma (default 0.1)\n"
+         "  --latency=MS        DMP sample to FIFO latency (default 5)\n"
+         "  --raw[=HZ]          raw accel/gyro + MCU filter instead of the DMP (default 500 Hz)\n"
+         "  --raw-latency=MS    raw sample to FIFO latency (default 2)\n"
+         "  --gyro-noise=DPS    rate noise on raw samples, 1 sigma (default 0.5)\n"
+         "  --offset=DEG        pitch the firmware reads upright (default 10)\n"
+         "  --seed=N            noise seed (default 1)\n"
+         "  --int-miss=P        probability a DMP INT edge is lost (default 0)\n"
+         "  --i2c-fault=P       probability a FIFO DMA read hangs with SDA held low (default 0)\n"
+         "  --int-stall=S       the sensor stops raising INT S s after release\n"
+         "  --sag=S:V           S s after release the battery drops to V volts\n"
+         "  --expect-off=S      fail if the motors are driven S s or more after release; a\n"
+         "                      fall is then expected and does not fail the run\n"
+         "  --vbat=V            battery voltage seen by the motors and the ADC (default 7.4)\n"
+         "  --cal-vbat=V        battery voltage while --calibrated/--motor-cal were measured (default: --vbat)\n"
+         "  --warm              boot after an MCU-only reset (DMP image resident)\n"
+         "  --calibrated        boot with an IMU calibration stored by a previous boot\n"
+         "  --motor-cal         boot with a motor friction calibration (wheels lifted) stored by a previous boot\n"
+         "  --dmp-profile=balance|full   DMP feature set (default: firmware's)\n"
+         "  --rate=HZ[:LPF]     switch the sensor/control rate at run time after boot\n"
+         "  --kp= --ki= --kd= --target=   override balance_pid via the parameter registry\n"
+         "  --engine=float|fixed\n"
+         "  --csv=FILE          write a 1 kHz trace (single run only)\n"
+         "  --telemetry=FILE[:HZ]  capture the COBS telemetry stream (default 100 Hz, single run only)\n"
+         "  --baud=N            USART2 baud rate (default 9600)\n"
+         "  --cmd=LINE          send a debug command over USART2, repeatable; one every 200 ms\n"
+         "                      from release, replies printed after the run (single run only)\n"
+         "  --expect=TEXT       fail unless the USART2 output contains TEXT, repeatable\n"
+         "  --max-rms=DEG       fail if rms_tilt exceeds DEG\n"
+         "  --max-tilt=DEG      fail if max_tilt exceeds DEG\n"
+         "  --max-drift=M       fail if |drift_m| exceeds M\n"
+         "  --sweep-kp=LO:HI:N --sweep-kd=LO:HI:N   grid sweep\n"
+         "exit status is 1 if any run fell over, exceeded a --max-* limit or an --expect text is missing\n", argv0);
+}
+
+int main(int argc, char **argv) {
+  Sim_ConfigTypeDef cfg = {
+    .t_end = 10.0, .tilt0_deg = 3.0, .noise_deg = 0.1, .latency_ms = 5.0,
+    .raw_latency_ms = 2.0, .gyro_noise_dps = 0.5,
+    .mount_offset_deg = 10.0, .vbat = 7.4, .seed = 1, .csv = NULL,
+    .telemetry = NULL, .telemetry_hz = 100, .baud = 9600
+  };
+  Sim_GainsTypeDef g = {0};
+  float kp_lo = 0, kp_hi = 0, kd_lo = 0, kd_hi = 0;
+  int kp_n = 0, kd_n = 0;
+  int any_fell = 0;
+  const char *expect[SIM_CMD_MAX];
+  int n_expect = 0;
+  Sim_LimitsTypeDef lim = {0};
+
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = strchr(a, '=');
+    v = v ? v + 1 : "";
+    if (!strncmp(a, "--time=", 7)) cfg.t_end = atof(v);
+    else if (!strncmp(a, "--tilt=", 7)) cfg.tilt0_deg = atof(v);
+    else if (!strncmp(a, "--noise=", 8)) cfg.noise_deg = atof(v);
+    else if (!strncmp(a, "--latency=", 10)) cfg.latency_ms = atof(v);
+    else if (!strncmp(a, "--raw-latency=", 14)) cfg.raw_latency_ms = atof(v);
+    else if (!strncmp(a, "--gyro-noise=", 13)) cfg.gyro_noise_dps = atof(v);
+    else if (!strcmp(a, "--raw")) g.raw_hz = MPU6050_RAW_DEFAULT_HZ;
+    else if (!strncmp(a, "--raw=", 6)) g.raw_hz = atoi(v);
+    else if (!strncmp(a, "--offset=", 9)) cfg.mount_offset_deg = atof(v);
+    else if (!strncmp(a, "--int-miss=", 11)) cfg.int_miss = atof(v);
+    else if (!strncmp(a, "--i2c-fault=", 12)) cfg.i2c_fault = atof(v);
+    else if (!strncmp(a, "--int-stall=", 12)) cfg.int_stall = atof(v);
+    else if (!strncmp(a, "--expect-off=", 13)) cfg.expect_off = atof(v);
+    else if (!strncmp(a, "--sag=", 6)) {
+      if (sscanf(v, "%lf:%lf", &cfg.sag_t, &cfg.sag_vbat) != 2) { usage(argv[0]); return 2; }
+    }
+    else if (!strncmp(a, "--vbat=", 7)) cfg.vbat = atof(v);
+    else if (!strncmp(a, "--cal-vbat=", 11)) cfg.cal_vbat = atof(v);
+    else if (!strcmp(a, "--warm")) cfg.warm_boot = 1;
+    else if (!strcmp(a, "--calibrated")) cfg.calibrated = 1;
+    else if (!strcmp(a, "--motor-cal")) cfg.motor_calib = 1;
+    else if (!strcmp(a, "--dmp-profile=balance")) g.dmp_profile = MPU6050_DMP_PROFILE_BALANCE + 1;
+    else if (!strcmp(a, "--dmp-profile=full")) g.dmp_profile = MPU6050_DMP_PROFILE_FULL + 1;
+    else if (!strncmp(a, "--rate=", 7)) {
+      if (sscanf(v, "%d:%d", &g.rate_hz, &g.lpf_hz) < 1) { usage(argv[0]); return 2; }
+    }
+    else if (!strncmp(a, "--seed=", 7)) cfg.seed = (uint32_t)strtoul(v, NULL, 0);
+    else if (!strncmp(a, "--kp=", 5)) { g.set_kp = 1; g.kp = (float)atof(v); }
+    else if (!strncmp(a, "--ki=", 5)) { g.set_ki = 1; g.ki = (float)atof(v); }
+    else if (!strncmp(a, "--kd=", 5)) { g.set_kd = 1; g.kd = (float)atof(v); }
+    else if (!strncmp(a, "--target=", 9)) { g.set_target = 1; g.target = (float)atof(v); }
+    else if (!strncmp(a, "--engine=", 9)) {
+      g.set_engine = 1;
+      g.engine = strcmp(v, "fixed") == 0 ? PID_ENGINE_FIXED : PID_ENGINE_FLOAT;
+    }
+    else if (!strncmp(a, "--csv=", 6)) cfg.csv = v;
+    else if (!strncmp(a, "--telemetry=", 12)) {
+      static char path[256];
+      char *colon;
+      snprintf(path, sizeof(path), "%s", v);
+      colon = strrchr(path, ':');
+      if (colon) { *colon = '\0'; cfg.telemetry_hz = atoi(colon + 1); }
+      cfg.telemetry = path;
+    }
+    else if (!strncmp(a, "--baud=", 7)) cfg.baud = (uint32_t)strtoul(v, NULL, 0);
+    else if (!strncmp(a, "--cmd=", 6) && cfg.n_cmd < SIM_CMD_MAX) cfg.cmd[cfg.n_cmd++] = v;
+    else if (!strncmp(a, "--expect=", 9) && n_expect < SIM_CMD_MAX) expect[n_expect++] = v;
+    else if (!strncmp(a, "--max-rms=", 10)) lim.rms_tilt_deg = atof(v);
+    else if (!strncmp(a, "--max-tilt=", 11)) lim.max_tilt_deg = atof(v);
+    else if (!strncmp(a, "--max-drift=", 12)) lim.drift_m = atof(v);
+    else if (!strncmp(a, "--sweep-kp=", 11) && parse_range(v, &kp_lo, &kp_hi, &kp_n)) { }
+    else if (!strncmp(a, "--sweep-kd=", 11) && parse_range(v, &kd_lo, &kd_hi, &kd_n)) { }
+    else { usage(argv[0]); return 2; }
+  }
+
+  print_header();
+  if (kp_n == 0 && kd_n == 0) {
+    Sim_RunResultTypeDef r;
+    char *output = NULL;
+    size_t output_len = 0;
+    int missing = 0;
+    if (cfg.n_cmd > 0 || n_expect > 0) cfg.console = open_memstream(&output, &output_len);
+    run_once(&cfg, &g, &r);
+    print_result(&r);
+    if (cfg.console) {
+      fclose(cfg.console);
+      fwrite(output, 1, output_len, stdout);
+      for (int i = 0; i < n_expect; i++) {
+        if (strstr(output, expect[i]) == NULL) {
+          fprintf(stderr, "sil: expected USART2 output '%s' not seen\n", expect[i]);
+          missing = 1;
+        }
+      }
+      free(output);
+    }
+    return (r.world.fell && cfg.expect_off <= 0.0) || over_limits(&r, &lim) || missing ? 1 : 0;
+  }
+
+  cfg.csv = NULL;
+  cfg.telemetry = NULL;
+  cfg.n_cmd = 0;
+  if (kp_n == 0) { kp_n = 1; kp_lo = kp_hi = g.set_kp ? g.kp : 8.0f; }
+  if (kd_n == 0) { kd_n = 1; kd_lo = kd_hi = g.set_kd ? g.kd : 1.0f; }
+  for (int i = 0; i < kp_n; i++) {
+    for (int j = 0; j < kd_n; j++) {
+      Sim_GainsTypeDef gi = g;
+      Sim_RunResultTypeDef r;
+      gi.set_kp = gi.set_kd = 1;
+      gi.kp = kp_n > 1 ? kp_lo + (kp_hi - kp_lo) * i / (kp_n - 1) : kp_lo;
+      gi.kd = kd_n > 1 ? kd_lo + (kd_hi - kd_lo) * j / (kd_n - 1) : kd_lo;
+      if (run_isolated(&cfg, &gi, &r) != 0) {
+        fprintf(stderr, "sil: run kp=%g kd=%g failed\n", gi.kp, gi.kd);
+        return 2;
+      }
+      print_result(&r);
+      any_fell |= (r.world.fell && cfg.expect_off <= 0.0) | over_limits(&r, &lim);
+    }
+  }
+  return any_fell ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+//
+// SIL world: simulated time, event scheduling and run configuration.
+//
+
+#ifndef SIM_SIM_H
+#define SIM_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "stm32f1xx_hal.h"
+
+#define SIM_CMD_MAX     16
+
+typedef struct {
+  double t_end;             // simulated run time after release, s
+  double tilt0_deg;         // initial body tilt, positive = forward
+  double noise_deg;         // pitch noise (1 sigma) on every DMP sample
+  double latency_ms;        // DMP sample-to-FIFO latency
+  double raw_latency_ms;    // raw sample-to-FIFO latency (DLPF group delay)
+  double gyro_noise_dps;    // rate noise (1 sigma) on raw samples
+  double mount_offset_deg;  // pitch the firmware reads when the body is upright
+  double int_miss;          // probability that a DMP INT edge is not serviced
+  double i2c_fault;         // probability that a FIFO DMA read hangs with SDA held low
+  double int_stall;         // s after release from which the sensor stops raising INT, 0 = never
+  double expect_off;        // s after release from which the motors must stay off, 0 = no check
+  double vbat;              // battery voltage, V
+  double cal_vbat;          // battery voltage during the previous (calibrating) boot, 0 = vbat
+  double sag_t, sag_vbat;   // sag_t s after release the pack drops to sag_vbat, 0 = never
+  int warm_boot;            // boot against a chip left running by a previous boot
+  int calibrated;           // boot with an IMU calibration a previous boot stored in flash
+  int motor_calib;          // boot with a motor friction calibration a previous boot stored in flash
+  uint32_t seed;
+  const char *csv;          // optional 1 kHz trace
+  const char *telemetry;    // optional capture of the USART2 telemetry stream
+  int telemetry_hz;
+  uint32_t baud;            // USART2 baud rate
+  const char *cmd[SIM_CMD_MAX];   // debug commands sent over USART2 after release
+  int n_cmd;
+  FILE *console;            // where USART2 output goes when not capturing telemetry
+} Sim_ConfigTypeDef;
+
+typedef struct {
+  int fell;
+  double t_fall;            // s after release
+  double rms_tilt_deg;      // after the first second
+  double max_tilt_deg;
+  double drift_m;
+  double rms_duty;          // mean over both motors, 0..1
+  double late_duty;         // peak motor duty from expect_off on, 0..1
+  uint32_t dmp_packets;     // packets pushed by the sensor model
+  uint32_t fifo_dropped;    // bytes lost to FIFO overflow
+  uint32_t flash_driven;    // flash erase/program operations while a motor was driven
+} Sim_ResultTypeDef;
+
+// time
+uint64_t sim_now_us(void);
+void sim_advance_us(uint64_t us);
+
+// world
+void sim_world_init(const Sim_ConfigTypeDef *cfg);
+void sim_world_release(void);
+void sim_world_lift(int on);
+int sim_world_done(void);
+void sim_world_result(Sim_ResultTypeDef *res);
+void sim_world_close(void);
+int sim_world_i2c_fault(void);
+void sim_world_flash_op(void);
+
+// HAL shim hooks
+extern int sim_in_irq;
+void sim_hal_reset(void);
+int sim_irq_enabled(IRQn_Type irq);
+void sim_gpio_sync(void);
+void sim_adc_set(uint16_t counts);
+void sim_uart_capture(FILE *f);
+void sim_uart_set_baud(uint32_t baud);
+#define SIM_UART_RX_MAX 256         // longest line sim_uart_rx() takes
+int sim_uart_rx(const uint8_t *data, uint16_t len);
+uint64_t sim_hal_next_event(void);
+void sim_hal_run_events(uint64_t now);
+
+#endif //SIM_SIM_H
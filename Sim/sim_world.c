@@ -0,0 +1,363 @@
+//
+// SIL world: advances simulated time, steps the plant, feeds the MPU model
+// and raises the INT (PB14) interrupt when a DMP packet lands in the FIFO.
+//
+#include "sim.h"
+#include "plant.h"
+#include "mpu_model.h"
+#include "pin_definitions.h"
+#include "Balance/balance_control.h"
+#include "Sensor/inv_mpu_dmp_motion_driver.h"
+#include "Sensor/battery.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PHYS_DT_US      100U    // plant integration step
+#define TRACE_DT_US     1000U   // CSV trace period
+#define FALL_TILT_DEG   45.0
+#define LATENCY_QUEUE   64
+#define RAD2DEG         (180.0 / 3.14159265358979)
+#define ENCODER_CPR     1560.0  // 13-line hall encoder x 1:30 gearbox, TI12 mode counts every edge of A and B
+
+static Sim_ConfigTypeDef cfg;
+static Plant_ParamsTypeDef params;
+static Plant_StateTypeDef plant;
+
+static uint64_t now_us;
+static uint64_t next_phys_us;
+static uint64_t next_sample_us;
+static uint64_t next_trace_us;
+static uint64_t next_pwm_us;
+static uint64_t release_us;
+static int released;
+static int lifted;
+static int fell;
+static double t_fall;
+
+// DMP samples waiting for their FIFO write time
+static struct {
+  uint64_t due;
+  MPU_ModelSampleTypeDef s;
+} pending[LATENCY_QUEUE];
+static unsigned pending_head, pending_count;
+
+// metrics
+static double tilt_sq_sum, duty_sq_sum, max_tilt;
+static double late_duty;
+static uint32_t flash_driven;
+static uint64_t tilt_n, duty_n;
+static uint32_t dmp_packets;
+static float last_duty[2];
+
+static FILE *trace;
+static uint32_t rng_state;
+
+static double rand_uniform(void) {
+  // xorshift32, deterministic per seed
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return (rng_state + 1.0) / 4294967297.0;
+}
+
+static double rand_gauss(void) {
+  double u1 = rand_uniform(), u2 = rand_uniform();
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * 3.14159265358979 * u2);
+}
+
+uint64_t sim_now_us(void) {
+  return now_us;
+}
+
+void sim_world_init(const Sim_ConfigTypeDef *c) {
+  cfg = *c;
+  plant_default_params(&params);
+  params.vbat = (float)cfg.vbat;
+  plant_reset(&plant, cfg.tilt0_deg / RAD2DEG);
+  now_us = 0;
+  next_phys_us = PHYS_DT_US;
+  next_sample_us = 0;
+  next_trace_us = 0;
+  next_pwm_us = 0;
+  released = 0;
+  lifted = 0;
+  fell = 0;
+  t_fall = 0.0;
+  pending_head = pending_count = 0;
+  tilt_sq_sum = duty_sq_sum = max_tilt = late_duty = 0.0;
+  tilt_n = duty_n = 0;
+  dmp_packets = 0;
+  flash_driven = 0;
+  rng_state = cfg.seed ? cfg.seed : 1U;
+  trace = NULL;
+  if (cfg.csv) {
+    trace = fopen(cfg.csv, "w");
+    if (trace) fprintf(trace, "t,tilt_deg,pitch_fw_deg,x_m,duty_a,duty_b,torque_nm,pid_out\n");
+  }
+}
+
+void sim_world_release(void) {
+  released = 1;
+  release_us = now_us;
+  next_trace_us = now_us;
+}
+
+// Wheels off the ground before release: the motors spin them freely
+void sim_world_lift(int on) {
+  lifted = on;
+}
+
+int sim_world_done(void) {
+  return fell || (released && (now_us - release_us) >= (uint64_t)(cfg.t_end * 1e6));
+}
+
+void sim_world_close(void) {
+  if (trace) fclose(trace);
+  trace = NULL;
+}
+
+// Decode the TB6612 inputs and the TIM1 compare registers
+static void read_motor_commands(Motor_CommandTypeDef cmd[2]) {
+  const uint16_t in1[2] = { MOTOR_AIN1_PIN, MOTOR_BIN1_PIN };
+  const uint16_t in2[2] = { MOTOR_AIN2_PIN, MOTOR_BIN2_PIN };
+  const uint32_t ccr[2] = { TIM1->CCR1, TIM1->CCR2 };
+  float period = (float)TIM1->ARR + 1.0f;
+
+  sim_gpio_sync();
+
+  for (int k = 0; k < 2; k++) {
+    int a = (MOTOR_AIN1_PORT->ODR & in1[k]) != 0;
+    int b = (MOTOR_AIN2_PORT->ODR & in2[k]) != 0;
+    float duty = (float)ccr[k] / period;
+    if (duty > 1.0f) duty = 1.0f;
+    cmd[k].duty = duty;
+    if (a && !b) cmd[k].mode = MOTOR_DRIVE_FORWARD;
+    else if (!a && b) cmd[k].mode = MOTOR_DRIVE_BACKWARD;
+    else if (a && b) cmd[k].mode = MOTOR_DRIVE_BRAKE;
+    else cmd[k].mode = MOTOR_DRIVE_COAST;
+    last_duty[k] = (cmd[k].mode == MOTOR_DRIVE_FORWARD || cmd[k].mode == MOTOR_DRIVE_BACKWARD) ? duty : 0.0f;
+  }
+}
+
+// TIM2/TIM4 encoder counters: wheel angle relative to the body (the motor
+// housing tilts with it), wrapped to 16 bits like the hardware counter.
+// Phase A is bit 1 of the quadrature count and phase B lags it by one count,
+// so B (PA1 / PB7) is low at a rising A edge while counting up. A's rising
+// edges raise EXTI0 (PA0) / EXTI9_5 (PB6), time-stamped at the physics step
+// (100 us). The EXTI line is unfiltered while the counter sits behind the
+// input filter, so on about half of the edges the handler still reads the
+// count from before the edge.
+static void update_encoders(void) {
+  static int32_t last_count;
+  double rev = (plant.x / params.wheel_radius - plant.phi) / (2.0 * 3.14159265358979);
+  int32_t count = (int32_t)floor(rev * ENCODER_CPR);
+  int rising = (!(last_count & 2) && (count & 2)) || abs(count - last_count) >= 4;
+  int phase_a = (count & 2) != 0;
+  int phase_b = ((count - 1) & 2) != 0;
+  int filter_lag = rising && rand_uniform() < 0.5;
+
+  GPIOA->IDR = (GPIOA->IDR & ~(uint32_t)(GPIO_PIN_0 | GPIO_PIN_1)) |
+               (phase_a ? GPIO_PIN_0 : 0) | (phase_b ? GPIO_PIN_1 : 0);
+  GPIOB->IDR = (GPIOB->IDR & ~(uint32_t)(GPIO_PIN_6 | GPIO_PIN_7)) |
+               (phase_a ? GPIO_PIN_6 : 0) | (phase_b ? GPIO_PIN_7 : 0);
+  if (!filter_lag) {
+    TIM2->CNT = (uint16_t)count;
+    TIM4->CNT = (uint16_t)count;
+  }
+  last_count = count;
+  if (rising) {
+    sim_in_irq++;
+    if (sim_irq_enabled(EXTI0_IRQn)) HAL_GPIO_EXTI_Callback(GPIO_PIN_0);
+    if (sim_irq_enabled(EXTI9_5_IRQn)) HAL_GPIO_EXTI_Callback(GPIO_PIN_6);
+    sim_in_irq--;
+  }
+  TIM2->CNT = (uint16_t)count;
+  TIM4->CNT = (uint16_t)count;
+}
+
+// --int-stall: the sensor stops raising INT (hung chip, broken wire)
+static int int_stalled(void) {
+  return cfg.int_stall > 0.0 && released && now_us - release_us >= (uint64_t)(cfg.int_stall * 1e6);
+}
+
+static double firmware_pitch_deg(void) {
+  return cfg.mount_offset_deg - plant.phi * RAD2DEG;
+}
+
+// PB0 behind the battery divider, 12-bit ADC; --sag drops the pack (motors
+// and divider alike) at a given time after release
+static void update_battery_adc(void) {
+  double vbat = cfg.vbat;
+  double v_adc;
+  if (cfg.sag_t > 0.0 && released && now_us - release_us >= (uint64_t)(cfg.sag_t * 1e6)) vbat = cfg.sag_vbat;
+  params.vbat = (float)vbat;
+  v_adc = vbat * BATTERY_DIV_BOTTOM / (BATTERY_DIV_TOP + BATTERY_DIV_BOTTOM);
+  double counts = v_adc * 4096.0 / (BATTERY_VREF_MV * 1e-3);
+  sim_adc_set((uint16_t)(counts > 4095.0 ? 4095.0 : counts));
+}
+
+static void physics_step(void) {
+  Motor_CommandTypeDef cmd[2];
+  read_motor_commands(cmd);
+  update_battery_adc();
+  if (!released && lifted) {
+    plant_step_lifted(&params, &plant, cmd, PHYS_DT_US * 1e-6);
+    update_encoders();
+    return;
+  }
+  if (!released || fell) return;
+
+  plant_step(&params, &plant, cmd, PHYS_DT_US * 1e-6);
+  update_encoders();
+
+  double tilt = fabs(plant.phi * RAD2DEG);
+  double t = (now_us - release_us) * 1e-6;
+  if (tilt > max_tilt) max_tilt = tilt;
+  if (t >= 1.0) {
+    tilt_sq_sum += tilt * tilt;
+    tilt_n++;
+  }
+  duty_sq_sum += 0.5 * (last_duty[0] * last_duty[0] + last_duty[1] * last_duty[1]);
+  duty_n++;
+  if (cfg.expect_off > 0.0 && t >= cfg.expect_off) {
+    late_duty = fmax(late_duty, fmax(last_duty[0], last_duty[1]));
+  }
+  if (tilt > FALL_TILT_DEG) {
+    fell = 1;
+    t_fall = t;
+  }
+}
+
+static void take_sample(void) {
+  MPU_ModelSampleTypeDef *s;
+  unsigned idx;
+  double pitch = firmware_pitch_deg();
+
+  if (pending_count == LATENCY_QUEUE) return;
+  idx = (pending_head + pending_count) % LATENCY_QUEUE;
+  pending_count++;
+  s = &pending[idx].s;
+  s->pitch_deg = (float)(pitch + cfg.noise_deg * rand_gauss());
+  s->pitch_rate_dps = (float)(-plant.phi_dot * RAD2DEG);
+  if (mpu_model_dmp_enabled()) {
+    pending[idx].due = now_us + (uint64_t)(cfg.latency_ms * 1000.0);
+  } else {
+    pending[idx].due = now_us + (uint64_t)(cfg.raw_latency_ms * 1000.0);
+    s->pitch_rate_dps += (float)(cfg.gyro_noise_dps * rand_gauss());
+  }
+  // accelerometer sees the (noisy) pitch, sensor frame
+  s->accel_g[0] = (float)sin(s->pitch_deg / RAD2DEG);
+  s->accel_g[1] = 0.0f;
+  s->accel_g[2] = (float)cos(s->pitch_deg / RAD2DEG);
+}
+
+static uint64_t sample_period_us(void) {
+  return mpu_model_sample_period_us();
+}
+
+static void write_trace(void) {
+  if (!trace || !released) return;
+  fprintf(trace, "%.4f,%.3f,%.3f,%.4f,%.3f,%.3f,%.4f,%.2f\n",
+          (now_us - release_us) * 1e-6, plant.phi * RAD2DEG, firmware_pitch_deg(),
+          plant.x, last_duty[0], last_duty[1], plant.torque, balance_pid.output);
+}
+
+// TIM1 update event period (one PWM period), whole microseconds
+static uint64_t pwm_period_us(void) {
+  uint64_t ticks = (uint64_t)(TIM1->PSC + 1U) * (TIM1->ARR + 1U);
+  uint64_t us = ticks / (SystemCoreClock / 1000000U);
+  return us ? us : 1;
+}
+
+void sim_advance_us(uint64_t us) {
+  uint64_t end = now_us + us;
+
+  sim_gpio_sync();
+
+  for (;;) {
+    uint64_t next = end;
+    uint64_t hal_next = sim_hal_next_event();
+    // TIM1 update interrupt (motor ramp) is only simulated while it is enabled
+    int pwm_irq = (TIM1->DIER & TIM_IT_UPDATE) && sim_irq_enabled(TIM1_UP_IRQn);
+    if (pwm_irq) {
+      if (next_pwm_us <= now_us) next_pwm_us = now_us + pwm_period_us();
+      if (next_pwm_us < next) next = next_pwm_us;
+    }
+    if (next_phys_us < next) next = next_phys_us;
+    if (next_sample_us < next) next = next_sample_us;
+    if (pending_count && pending[pending_head].due < next) next = pending[pending_head].due;
+    if (hal_next < next) next = hal_next;
+    now_us = next;
+    sim_dwt.CYCCNT = (uint32_t)(now_us * (SystemCoreClock / 1000000U));
+
+    if (pwm_irq && now_us >= next_pwm_us) {
+      TIM1->SR |= TIM_FLAG_UPDATE;
+      sim_in_irq++;
+      TB6612_Ramp_IRQHandler();
+      sim_in_irq--;
+      next_pwm_us += pwm_period_us();
+    }
+    if (now_us >= next_phys_us) {
+      physics_step();
+      next_phys_us += PHYS_DT_US;
+    }
+    if (now_us >= next_trace_us) {
+      write_trace();
+      next_trace_us += TRACE_DT_US;
+    }
+    if (now_us >= next_sample_us) {
+      take_sample();
+      next_sample_us += sample_period_us();
+    }
+    while (pending_count && pending[pending_head].due <= now_us) {
+      MPU_ModelSampleTypeDef s = pending[pending_head].s;
+      pending_head = (pending_head + 1) % LATENCY_QUEUE;
+      pending_count--;
+      if (mpu_model_push_sample(&s)) {
+        dmp_packets++;
+        if (sim_irq_enabled(EXTI15_10_IRQn) && !int_stalled() &&
+            (cfg.int_miss <= 0.0 || rand_uniform() >= cfg.int_miss)) {
+          sim_in_irq++;
+          HAL_GPIO_EXTI_Callback(GPIO_PIN_14);
+          sim_in_irq--;
+        }
+      }
+    }
+    sim_hal_run_events(now_us);
+
+    if (now_us >= end) break;
+  }
+}
+
+// Called for every flash erase/program: the CPU stalls on the bus meanwhile,
+// so the firmware must have stopped the motors before a write that happens
+// while the robot stands on its wheels
+void sim_world_flash_op(void) {
+  Motor_CommandTypeDef cmd[2];
+  if (!released || fell) return;
+  read_motor_commands(cmd);
+  if (last_duty[0] > 0.0f || last_duty[1] > 0.0f) flash_driven++;
+}
+
+// Called for every FIFO DMA read: 0 = clean transfer, otherwise the number
+// of SCL clocks the slave needs before it lets go of SDA
+int sim_world_i2c_fault(void) {
+  if (cfg.i2c_fault <= 0.0 || rand_uniform() >= cfg.i2c_fault) return 0;
+  return 1 + (int)(rand_uniform() * 9.0);
+}
+
+void sim_world_result(Sim_ResultTypeDef *res) {
+  memset(res, 0, sizeof(*res));
+  res->fell = fell;
+  res->t_fall = t_fall;
+  res->rms_tilt_deg = tilt_n ? sqrt(tilt_sq_sum / tilt_n) : 0.0;
+  res->max_tilt_deg = max_tilt;
+  res->drift_m = plant.x;
+  res->rms_duty = duty_n ? sqrt(duty_sq_sum / duty_n) : 0.0;
+  res->late_duty = late_duty;
+  res->dmp_packets = dmp_packets;
+  res->fifo_dropped = mpu_model_fifo_dropped();
+  res->flash_driven = flash_driven;
+}